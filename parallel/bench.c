@@ -0,0 +1,263 @@
+/*=====================================================
+ * bench.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This file runs microbenchmarks of the genetic
+ * operators and of the OneMax fitness function over
+ * a grid of population sizes, genome sizes and rates.
+ *
+ * Each benchmark is repeated several times; the mean
+ * and standard deviation of ns per chromosome and the
+ * mean # of gene bytes processed per second are written
+ * as CSV rows to stdout or to the file given by -o,
+ * a readable table goes to stderr.
+ *=====================================================*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "group.h"
+
+
+#define BENCH_REP_NS 20e6		// target length of one repetition in ns
+
+
+/*============ Type Definition ============*/
+/*
+ * one operator under test, run() is called several
+ * times per repetition on a group made by init_group()
+ */
+typedef struct
+{
+	const char* name;							// name of the operator
+	void (*run)(Group* grp);			// operator under test
+}BenchOp;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * print usage and help info
+ */
+void print_usage(void);
+
+
+/*
+ * time one operator on one point of the grid and
+ * write a result row
+ */
+void bench_op(FILE* out, const BenchOp* op, int num_chrs, int num_genes,
+	double cross_rate, double mutate_rate, int reps);
+
+
+/*
+ * wrappers with the signature of BenchOp.run
+ */
+void run_init_group(Group* grp);
+void run_select_parent(Group* grp);
+void run_crossover(Group* grp);
+void run_mutate(Group* grp);
+void run_update_fitness(Group* grp);
+
+
+/*============== main() =================*/
+int main(int argc, char* argv[])
+{
+	int reps = 9;						// # of repetitions of each benchmark
+	FILE* out = stdout;			// file of CSV results
+
+	int i;
+	for (i = 1; i + 1 < argc; i+=2)
+	{
+		if (0 == strcmp("-r",argv[i]))
+			reps = atoi(argv[i+1]);
+		else if (0 == strcmp("-o",argv[i]))
+			out = fopen(argv[i+1], "w");
+		else
+			break;
+	}
+
+	if (i < argc || reps < 2 || NULL == out)
+	{
+		print_usage();  // print usage and help info
+		exit (1);
+	}
+
+	srand(1);
+
+	BenchOp ops[] =
+	{
+		{"init_group", run_init_group},
+		{"select_parent", run_select_parent},
+		{"crossover", run_crossover},
+		{"mutate", run_mutate},
+		{"update_fitness", run_update_fitness},
+	};
+	int num_ops = sizeof(ops) / sizeof(ops[0]);
+
+	int chrs_grid[] = {64, 512, 4096};
+	int genes_grid[] = {2, 16, 128};
+	double cross_grid[] = {0.6, 0.95};
+	double mutate_grid[] = {0.001, 0.01};
+
+	fprintf(out, "op,num_chrs,num_genes,cross_rate,mutate_rate,reps,"
+		"ns_per_chr_mean,ns_per_chr_stddev,bytes_per_sec\n");
+	fprintf(stderr, "%-14s %7s %6s %6s %6s %14s %10s %12s\n", "op", "chrs", "genes",
+		"cross", "mutate", "ns/chr", "stddev", "MB/s");
+
+	int op, c, g, r, m;
+	for (op = 0; op < num_ops; op++)
+	{
+		for (c = 0; c < 3; c++)
+		{
+			for (g = 0; g < 3; g++)
+			{
+				for (r = 0; r < 2; r++)
+				{
+					for (m = 0; m < 2; m++)
+					{
+						bench_op(out, &ops[op], chrs_grid[c], genes_grid[g],
+							cross_grid[r], mutate_grid[m], reps);
+					}
+				}
+			}
+		}
+	}
+
+	if (stdout != out)
+		fclose(out);
+
+	return 0;
+}
+
+
+/*========== Function Definition ==========*/
+/*
+ * print usage and help info
+ */
+void print_usage(void)
+{
+	printf("=== Usage: ./benchmark [-r 9] [-o bench.csv]\n");
+	printf("    -r  # of repetitions of each benchmark, at least 2\n");
+	printf("    -o  file of CSV results, default stdout\n");
+}
+
+
+/*
+ * read the monotonic clock in ns,
+ * only use this function inside this file
+ */
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/*
+ * time one operator on one point of the grid and
+ * write a result row
+ */
+void bench_op(FILE* out, const BenchOp* op, int num_chrs, int num_genes,
+	double cross_rate, double mutate_rate, int reps)
+{
+	Group* grp = init_group(num_genes, num_chrs, cross_rate, mutate_rate);
+	double* ns_per_chr = (double*)malloc(reps * sizeof(double));
+
+	// give every chromosome some fitness so that the
+	// roulette wheel is well defined
+	int i;
+	for (i = 0; i < num_chrs; i++)
+	{
+		grp->chrs[i]->fitness = 1.0 + rng_below(&grp->rng, 100);
+	}
+	update_fit_rate(grp, NULL);
+
+	// one untimed round warms up the caches and tells
+	// how many calls make a repetition long enough for
+	// the clock resolution not to matter
+	double start = now_ns();
+	op->run(grp);
+	long iters = (long)(BENCH_REP_NS / (now_ns() - start + 1.0));
+	if (iters < 1)
+		iters = 1;
+
+	int r;
+	long k;
+	double mean = 0.0;
+	for (r = 0; r < reps; r++)
+	{
+		start = now_ns();
+		for (k = 0; k < iters; k++)
+		{
+			op->run(grp);
+		}
+		ns_per_chr[r] = (now_ns() - start) / ((double)iters * num_chrs);
+		mean += ns_per_chr[r];
+	}
+	mean /= reps;
+
+	double var = 0.0;
+	for (r = 0; r < reps; r++)
+	{
+		var += (ns_per_chr[r] - mean) * (ns_per_chr[r] - mean);
+	}
+	double stddev = sqrt(var / (reps - 1));
+	double bytes_per_sec = num_genes / mean * 1e9;
+
+	fprintf(out, "%s,%d,%d,%g,%g,%d,%.3f,%.3f,%.0f\n", op->name, num_chrs, num_genes,
+		cross_rate, mutate_rate, reps, mean, stddev, bytes_per_sec);
+	fprintf(stderr, "%-14s %7d %6d %6g %6g %14.2f %10.2f %12.1f\n", op->name, num_chrs,
+		num_genes, cross_rate, mutate_rate, mean, stddev, bytes_per_sec / 1e6);
+
+	free(ns_per_chr);
+	free_group(grp);
+}
+
+
+/*
+ * build and free a group of the same sizes
+ */
+void run_init_group(Group* grp)
+{
+	free_group(init_group(grp->num_genes, grp->num_chrs, grp->cross_rate, grp->mutate_rate));
+}
+
+
+/*
+ * the operators themselves
+ */
+void run_select_parent(Group* grp)
+{
+	select_parent(grp);
+}
+
+
+void run_crossover(Group* grp)
+{
+	crossover(grp);
+}
+
+
+void run_mutate(Group* grp)
+{
+	mutate(grp);
+}
+
+
+/*
+ * evaluate every chromosome of the group
+ */
+void run_update_fitness(Group* grp)
+{
+	int i;
+	for (i = 0; i < grp->num_chrs; i++)
+	{
+		grp->chrs[i]->fitness = update_fitness(grp->num_genes, grp->chrs[i]->genes);
+	}
+}
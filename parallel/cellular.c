@@ -0,0 +1,320 @@
+/*=====================================================
+ * cellular.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the cellular.h header file.
+ *=====================================================*/
+
+
+#include <string.h>
+#include "cellular.h"
+#include "reduce.h"
+#include "prof.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * cut the torus of num_chrs cells, width in a row, into
+ * strips of rows and create the tile of this rank, with
+ * random genes from seed; all ranks must call it with
+ * the same values
+ */
+Cellular* init_cellular(int num_genes, int num_chrs, int width, double cross_rate,
+	double mutate_rate, uint64_t seed, long spin_ns, double spread, Pool* pool)
+{
+	Cellular* cg = (Cellular*)malloc(sizeof(Cellular));
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &cg->rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &cg->size);
+
+	cg->width = width;
+	cg->height = num_chrs / width;
+	cg->first_row = cg->rank * cg->height / cg->size;
+	cg->num_rows = (cg->rank + 1) * cg->height / cg->size - cg->first_row;
+	cg->up = (cg->rank + cg->size - 1) % cg->size;
+	cg->down = (cg->rank + 1) % cg->size;
+	cg->spin_ns = spin_ns;
+	cg->spread = spread;
+	cg->pool = pool;
+	memset(&cg->stats, 0, sizeof(GenStats));
+	memset(&cg->traffic, 0, sizeof(Traffic));
+
+	int num_cells = cg->num_rows * width;
+	cg->tile = alloc_group(num_genes, num_cells, cross_rate, mutate_rate);
+	cg->fitness = (double*)calloc(num_cells, sizeof(double));
+
+	// the doubles of the second row stay aligned
+	cg->row_bytes = (width * sizeof(double) + width * num_genes + 7) / 8 * 8;
+	cg->edge = (unsigned char*)malloc(2 * cg->row_bytes);
+	cg->halo = (unsigned char*)malloc(2 * cg->row_bytes);
+
+	// one stream per rank, so the tiles differ and a run
+	// only depends on the seed and the # of ranks
+	rng_seed(&cg->tile->rng, seed, cg->rank);
+	fill_genes(cg->tile, pool);
+
+	return cg;
+}
+
+
+/*
+ * copy row of the tile, fitness then genes, to the
+ * row buffer out, only use this function inside this file
+ */
+static void pack_row(Cellular* cg, int row, unsigned char* out)
+{
+	int num_genes = cg->tile->num_genes;
+	int first = row * cg->width;
+
+	memcpy(out, cg->fitness + first, cg->width * sizeof(double));
+	memcpy(out + cg->width * sizeof(double), cg->tile->arena + first * num_genes,
+		cg->width * num_genes);
+}
+
+
+/*
+ * evaluate the cells of the tile on the threads of the
+ * pool, then swap the halo rows with the ranks above
+ * and below
+ */
+void cellular_evaluate(Cellular* cg)
+{
+	Group* tile = cg->tile;
+	int n = tile->num_chrs;
+	int i;
+
+	evaluate_batch(cg->pool, tile->num_genes, n, tile->arena, cg->fitness, cg->spin_ns,
+		cg->spread);
+	cg->traffic.evals += n;
+
+	for (i = 0; i < n; i++)
+	{
+		tile->chrs[i]->fitness = cg->fitness[i];
+	}
+
+	pack_row(cg, 0, cg->edge);
+	pack_row(cg, cg->num_rows - 1, cg->edge + cg->row_bytes);
+
+	// the last row of the rank above is the row above the
+	// tile, the first row of the rank below the one below
+	MPI_Request reqs[4];
+	MPI_Irecv(cg->halo, cg->row_bytes, MPI_BYTE, cg->up, TAG_SOUTH, MPI_COMM_WORLD, &reqs[0]);
+	MPI_Irecv(cg->halo + cg->row_bytes, cg->row_bytes, MPI_BYTE, cg->down, TAG_NORTH,
+		MPI_COMM_WORLD, &reqs[1]);
+
+	PROF_BEGIN(PROF_SEND);
+	MPI_Isend(cg->edge, cg->row_bytes, MPI_BYTE, cg->up, TAG_NORTH, MPI_COMM_WORLD, &reqs[2]);
+	MPI_Isend(cg->edge + cg->row_bytes, cg->row_bytes, MPI_BYTE, cg->down, TAG_SOUTH,
+		MPI_COMM_WORLD, &reqs[3]);
+	PROF_END(PROF_SEND);
+
+	PROF_BEGIN(PROF_RECV);
+	double t0 = MPI_Wtime();
+	MPI_Waitall(4, reqs, MPI_STATUSES_IGNORE);
+	cg->traffic.wait += MPI_Wtime() - t0;
+	PROF_END(PROF_RECV);
+
+	cg->traffic.msgs += 4;
+	cg->traffic.bytes += 4L * cg->row_bytes;
+	PROF_COUNT(PROF_MSGS_SENT, 2);
+	PROF_COUNT(PROF_BYTES_SENT, 2 * cg->row_bytes);
+	PROF_COUNT(PROF_MSGS_RECV, 2);
+	PROF_COUNT(PROF_BYTES_RECV, 2 * cg->row_bytes);
+}
+
+
+/*
+ * reduce the statistics of all tiles onto cg->stats of
+ * rank 0, all ranks must call it
+ */
+void cellular_stats(Cellular* cg)
+{
+	Group* tile = cg->tile;
+	int num_bits = tile->diversity_on ? tile->num_genes * CHAR_LENGTH : 0;
+	int i, bit;
+
+	PROF_BEGIN(PROF_FIT_RATE);
+
+	// exact sum and sum of squares of the fitness, so the
+	// statistics do not depend on the # of ranks, then
+	// the # of 1's at each bit position, exact anyway
+	ExactSum total, sum_sq;
+	double* mine = (double*)calloc(num_bits + 1, sizeof(double));
+	double* all = (double*)calloc(num_bits + 1, sizeof(double));
+	double best = cg->fitness[0];
+	double top;
+
+	exact_zero(&total);
+	exact_zero(&sum_sq);
+
+	for (i = 0; i < tile->num_chrs; i++)
+	{
+		double fitness = cg->fitness[i];
+
+		exact_add(&total, fitness);
+		exact_add(&sum_sq, fitness * fitness);
+		if (fitness > best)
+			best = fitness;
+
+		for (bit = 0; bit < num_bits; bit++)
+		{
+			unsigned char gene = tile->chrs[i]->genes[bit / CHAR_LENGTH];
+			mine[bit] += (gene >> (CHAR_LENGTH - bit % CHAR_LENGTH - 1)) & 1;
+		}
+	}
+
+	exact_reduce(&total, 0);
+	exact_reduce(&sum_sq, 0);
+	MPI_Reduce(mine, all, num_bits, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&best, &top, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+	if (0 == cg->rank)
+	{
+		int num_chrs = cg->width * cg->height;
+		double mean = exact_value(&total) / num_chrs;
+		double variance = exact_value(&sum_sq) / num_chrs - mean * mean;
+
+		cg->stats.generation = tile->generation;
+		cg->stats.num_chrs = num_chrs;
+		cg->stats.best = top;
+		cg->stats.mean = mean;
+		cg->stats.variance = variance > 0.0 ? variance : 0.0;
+		cg->stats.diversity = 0.0;
+
+		// 4p(1-p) per bit position, as in update_fit_rate()
+		if (num_bits > 0)
+		{
+			ExactSum diversity;
+			exact_zero(&diversity);
+			for (bit = 0; bit < num_bits; bit++)
+			{
+				double p = all[bit] / num_chrs;
+				exact_add(&diversity, 4.0 * p * (1.0 - p));
+			}
+
+			cg->stats.diversity = exact_value(&diversity) / num_bits;
+		}
+	}
+
+	free(mine);
+	free(all);
+
+	PROF_END(PROF_FIT_RATE);
+}
+
+
+/*
+ * genes and fitness of the cell at col of row, where
+ * row -1 and num_rows are the halo rows, only use this
+ * function inside this file
+ */
+static const unsigned char* cell_genes(Cellular* cg, int row, int col, double* fitness)
+{
+	int num_genes = cg->tile->num_genes;
+
+	if (row < 0 || row >= cg->num_rows)
+	{
+		const unsigned char* halo = cg->halo + (row < 0 ? 0 : cg->row_bytes);
+		const double* halo_fit = (const double*)halo;
+
+		*fitness = halo_fit[col];
+		return halo + cg->width * sizeof(double) + col * num_genes;
+	}
+
+	*fitness = cg->fitness[row * cg->width + col];
+	return cg->tile->scratch + (row * cg->width + col) * num_genes;
+}
+
+
+/*
+ * one of the cells of the neighbourhood of the cell at
+ * col of row, drawn at random, only use this function
+ * inside this file
+ */
+static const unsigned char* draw_neighbour(Cellular* cg, int row, int col, double* fitness)
+{
+	int dir = rng_below(&cg->tile->rng, NUM_NEIGHBOURS);
+
+	// self, north, south, west, east; rows go to the halo,
+	// columns wrap around
+	if (1 == dir)
+		row--;
+	else if (2 == dir)
+		row++;
+	else if (3 == dir)
+		col = (col + cg->width - 1) % cg->width;
+	else if (4 == dir)
+		col = (col + 1) % cg->width;
+
+	return cell_genes(cg, row, col, fitness);
+}
+
+
+/*
+ * select parent process of the tile: each cell gets the
+ * fitter of two cells drawn from its neighbourhood,
+ * only use this function inside this file
+ */
+static void select_local(Cellular* cg)
+{
+	Group* tile = cg->tile;
+	int num_genes = tile->num_genes;
+	int row, col;
+
+	// the scratch arena holds the old generation
+	memcpy(tile->scratch, tile->arena, tile->num_chrs * num_genes * sizeof(unsigned char));
+
+	for (row = 0; row < cg->num_rows; row++)
+	{
+		for (col = 0; col < cg->width; col++)
+		{
+			// binary tournament, the first one drawn wins a tie
+			double fit_a, fit_b;
+			const unsigned char* a = draw_neighbour(cg, row, col, &fit_a);
+			const unsigned char* b = draw_neighbour(cg, row, col, &fit_b);
+
+			memcpy(tile->arena + (row * cg->width + col) * num_genes, fit_b > fit_a ? b : a,
+				num_genes * sizeof(unsigned char));
+		}
+	}
+}
+
+
+/*
+ * breed the next generation of the tile: local
+ * selection, crossover and mutation
+ */
+void cellular_evolve(Cellular* cg)
+{
+	PROF_BEGIN(PROF_SELECT);
+	select_local(cg);
+	PROF_END(PROF_SELECT);
+
+	// pairs of crossover() are neighbours in a row
+	PROF_BEGIN(PROF_CROSSOVER);
+	crossover(cg->tile);
+	PROF_END(PROF_CROSSOVER);
+
+	PROF_BEGIN(PROF_MUTATE);
+	mutate(cg->tile);
+	PROF_END(PROF_MUTATE);
+
+	cg->tile->generation++;
+}
+
+
+/*
+ * copy the traffic out and free memories
+ */
+void free_cellular(Cellular* cg, Traffic* traffic)
+{
+	*traffic = cg->traffic;
+
+	free_group(cg->tile);
+	free(cg->fitness);
+	free(cg->edge);
+	free(cg->halo);
+	free(cg);
+}
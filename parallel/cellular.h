@@ -0,0 +1,106 @@
+/*=====================================================
+ * cellular.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares a cellular GA: the
+ * chromosomes are the cells of a torus grid, row after
+ * row, and a cell only breeds with its neighbourhood,
+ * itself and its N, S, W and E neighbours.
+ *
+ * Every rank owns a strip of whole rows as a group of
+ * its own (the tile) and evolves it on its own stream.
+ * Before a generation is bred a rank swaps its first and
+ * last row, genes and fitness, with the ranks above and
+ * below (the halo), which is all the selection of a
+ * cell needs; crossover() pairs cells i and i+1 of a row,
+ * which are neighbours too, and mutation is per cell.
+ * So there is no master and no global fitness: a rank
+ * only talks to two others, whatever the # of ranks.
+ * The statistics are only reduced onto rank 0 when a
+ * statistics file or a stopping rule needs them.
+ *=====================================================*/
+
+
+#ifndef CELLULAR_H_
+#define CELLULAR_H_
+
+
+#include <mpi.h>
+#include "group.h"
+#include "sched.h"
+#include "pool.h"
+
+
+#define TAG_NORTH 11		// first row of a rank, sent to the rank above
+#define TAG_SOUTH 12		// last row of a rank, sent to the rank below
+#define NUM_NEIGHBOURS 5	// a cell and its N, S, W and E neighbours
+
+
+/*============ Type Definition ============*/
+/*
+ * state of the cellular GA on one rank
+ */
+typedef struct
+{
+	int rank;							// rank of this process
+	int size;							// # of ranks
+	int width;						// # of cells in a row of the torus
+	int height;						// # of rows of the torus
+	int first_row;				// first row of the tile
+	int num_rows;					// # of rows of the tile
+	int up;								// rank with the rows above the tile
+	int down;							// rank with the rows below the tile
+	long spin_ns;					// extra busy work per evaluation
+	double spread;				// spread of the busy work, see evaluate()
+	Pool* pool;						// threads of this rank
+	Group* tile;					// cells of this rank, row after row
+	double* fitness;			// fitness of the cells of the tile
+	int row_bytes;				// size of a row: fitness, then genes
+	unsigned char* edge;	// first and last row of the tile, to send
+	unsigned char* halo;	// rows above and below the tile, received
+	GenStats stats;				// statistics of the whole grid, rank 0 only
+	Traffic traffic;			// traffic of this rank
+}Cellular;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * cut the torus of num_chrs cells, width in a row, into
+ * strips of rows and create the tile of this rank, with
+ * random genes from seed; all ranks must call it with
+ * the same values
+ */
+Cellular* init_cellular(int num_genes, int num_chrs, int width, double cross_rate,
+	double mutate_rate, uint64_t seed, long spin_ns, double spread, Pool* pool);
+
+
+/*
+ * evaluate the cells of the tile on the threads of the
+ * pool, then swap the halo rows with the ranks above
+ * and below
+ */
+void cellular_evaluate(Cellular* cg);
+
+
+/*
+ * reduce the statistics of all tiles onto cg->stats of
+ * rank 0, all ranks must call it
+ */
+void cellular_stats(Cellular* cg);
+
+
+/*
+ * breed the next generation of the tile: local
+ * selection, crossover and mutation
+ */
+void cellular_evolve(Cellular* cg);
+
+
+/*
+ * copy the traffic out and free memories
+ */
+void free_cellular(Cellular* cg, Traffic* traffic);
+
+
+#endif
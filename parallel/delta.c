@@ -0,0 +1,151 @@
+/*=====================================================
+ * delta.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the delta.h header file.
+ *
+ * Packed layout, ints: num_cuts, num_flips, checksum,
+ * select[num_chrs], cuts[2 * num_cuts], then int64s:
+ * flips[num_flips], as the bit index of an arena of
+ * 256 MB or more does not fit an int.
+ *=====================================================*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * alloc an empty script for num_chrs chromosomes
+ */
+EditScript* init_script(int num_chrs)
+{
+	EditScript* script = (EditScript*)malloc(sizeof(EditScript));
+
+	script->num_chrs = num_chrs;
+	script->select = (int*)malloc(num_chrs * sizeof(int));
+	script->cuts = (int*)malloc(num_chrs * sizeof(int));
+	script->max_flips = 64;
+	script->flips = (int64_t*)malloc(script->max_flips * sizeof(int64_t));
+	clear_script(script);
+
+	return script;
+}
+
+
+/*
+ * forget the changes recorded so far
+ */
+void clear_script(EditScript* script)
+{
+	script->num_cuts = 0;
+	script->num_flips = 0;
+	script->checksum = 0;
+}
+
+
+/*
+ * append a mutated bit, growing the script if needed
+ */
+void add_flip(EditScript* script, int64_t bit)
+{
+	if (script->num_flips == script->max_flips)
+	{
+		script->max_flips *= 2;
+		script->flips = (int64_t*)realloc(script->flips, script->max_flips * sizeof(int64_t));
+	}
+
+	script->flips[script->num_flips++] = bit;
+}
+
+
+/*
+ * write the script to *buf, growing it (capacity *cap)
+ * if needed; returns the # of bytes written
+ */
+int pack_script(const EditScript* script, unsigned char** buf, int* cap)
+{
+	int num_ints = 3 + script->num_chrs + 2 * script->num_cuts;
+	int size = num_ints * sizeof(int) + script->num_flips * sizeof(int64_t);
+
+	if (size > *cap)
+	{
+		*cap = size;
+		*buf = (unsigned char*)realloc(*buf, size);
+	}
+
+	int head[3] = {script->num_cuts, script->num_flips, (int)script->checksum};
+	unsigned char* p = *buf;
+
+	memcpy(p, head, sizeof(head));
+	p += sizeof(head);
+	memcpy(p, script->select, script->num_chrs * sizeof(int));
+	p += script->num_chrs * sizeof(int);
+	memcpy(p, script->cuts, 2 * script->num_cuts * sizeof(int));
+	p += 2 * script->num_cuts * sizeof(int);
+	memcpy(p, script->flips, script->num_flips * sizeof(int64_t));
+
+	return size;
+}
+
+
+/*
+ * read a script written by pack_script()
+ */
+void unpack_script(EditScript* script, const unsigned char* buf)
+{
+	int head[3];
+
+	memcpy(head, buf, sizeof(head));
+	buf += sizeof(head);
+
+	script->num_cuts = head[0];
+	script->num_flips = 0;
+	script->checksum = (unsigned int)head[2];
+
+	memcpy(script->select, buf, script->num_chrs * sizeof(int));
+	buf += script->num_chrs * sizeof(int);
+	memcpy(script->cuts, buf, 2 * script->num_cuts * sizeof(int));
+	buf += 2 * script->num_cuts * sizeof(int);
+
+	int i;
+	for (i = 0; i < head[1]; i++)
+	{
+		int64_t bit;
+		memcpy(&bit, buf + i * sizeof(int64_t), sizeof(int64_t));
+		add_flip(script, bit);
+	}
+}
+
+
+/*
+ * FNV-1a hash of size bytes
+ */
+unsigned int genes_checksum(const unsigned char* genes, size_t size)
+{
+	unsigned int h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+	{
+		h = (h ^ genes[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+
+/*
+ * free memories of the script
+ */
+void free_script(EditScript* script)
+{
+	free(script->select);
+	free(script->cuts);
+	free(script->flips);
+	free(script);
+}
@@ -0,0 +1,89 @@
+/*=====================================================
+ * delta.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file defines the edit script of one
+ * generation: the parent chosen for every chromosome by
+ * select_parent(), the (pair, cut) of every crossover
+ * and the position of every mutated bit.
+ *
+ * Ranks that keep a replica of the group replay the
+ * script (see replay_script() in group.h) instead of
+ * receiving every genome again, so the size of an
+ * update grows with the # of changes, not with the size
+ * of the group.
+ *=====================================================*/
+
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*============ Type Definition ============*/
+/*
+ * changes of one generation, filled by the operators of
+ * a group whose script is set
+ */
+typedef struct
+{
+	int num_chrs;						// # of chromosomes
+	int* select;						// parent of each chromosome
+	int num_cuts;						// # of crossovers
+	int* cuts;							// pair and bit index of each crossover
+	int num_flips;					// # of mutated bits
+	int max_flips;					// room in flips
+	int64_t* flips;					// arena bit index of each mutated bit
+	unsigned int checksum;	// FNV-1a of the genes after the changes
+}EditScript;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * alloc an empty script for num_chrs chromosomes
+ */
+EditScript* init_script(int num_chrs);
+
+
+/*
+ * forget the changes recorded so far
+ */
+void clear_script(EditScript* script);
+
+
+/*
+ * append a mutated bit, growing the script if needed
+ */
+void add_flip(EditScript* script, int64_t bit);
+
+
+/*
+ * write the script to *buf, growing it (capacity *cap)
+ * if needed; returns the # of bytes written
+ */
+int pack_script(const EditScript* script, unsigned char** buf, int* cap);
+
+
+/*
+ * read a script written by pack_script()
+ */
+void unpack_script(EditScript* script, const unsigned char* buf);
+
+
+/*
+ * FNV-1a hash of size bytes
+ */
+unsigned int genes_checksum(const unsigned char* genes, size_t size);
+
+
+/*
+ * free memories of the script
+ */
+void free_script(EditScript* script);
+
+
+#endif
@@ -8,37 +8,242 @@
  *=====================================================*/
 
 
+#include <string.h>
 #include "group.h"
+#include "reduce.h"
+#include "prof.h"
 
 
 /*========== Function Definition ==========*/
 /*
- * alloc memories to the group struct and members, and
- * initialise each chromosome in the group
+ * alloc the group struct and members, with the genes in
+ * store if it is not NULL, only use this function inside
+ * this file
  */
-Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate)
+static Group* make_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	Store* store)
 {
 	Group* grp = (Group*)malloc(sizeof(Group));
 
 	grp->num_genes = num_genes;
 	grp->num_chrs = num_chrs;
+	grp->generation = 0;
 	grp->cross_rate = cross_rate;
 	grp->mutate_rate = mutate_rate;
 	grp->fit_total = 0.0;
 	grp->fit_rate = (double*)malloc(num_chrs * sizeof(double));
+	grp->fit_cum = (double*)malloc(num_chrs * sizeof(double));
+	grp->select_mode = SELECT_ROULETTE;
+	grp->select_param = 0.0;
+	grp->ranker = NULL;
+	grp->chr_pool = (Chromo*)malloc(num_chrs * sizeof(Chromo));
 	grp->chrs = (Chromo**)malloc(num_chrs * sizeof(Chromo*));
+	grp->diversity_on = 0;
+	grp->bit_counts = (int*)malloc(num_genes * CHAR_LENGTH * sizeof(int));
+	grp->script = NULL;
+	grp->store = store;
+	grp->copies = NULL;
+	grp->parents = NULL;
+	memset(&grp->stats, 0, sizeof(GenStats));
+
+	if (NULL == store)
+	{
+		grp->arena = (unsigned char*)alloc_big(num_chrs * num_genes * sizeof(unsigned char));
+		grp->arena_owned = 1;
+		grp->scratch = (unsigned char*)alloc_big(num_chrs * num_genes * sizeof(unsigned char));
+	}
+	else
+	{
+		// the genes are paged in and out of the file, only
+		// the selection tables join the fitness in memory
+		grp->arena = store_half(store, 0);
+		grp->arena_owned = 0;
+		grp->scratch = store_half(store, 1);
+		grp->copies = (int*)malloc(num_chrs * sizeof(int));
+		grp->parents = (int*)malloc(num_chrs * sizeof(int));
+	}
+
+	// the group draws from its own stream, seeded from
+	// rand() so that srand() still controls a run
+	rng_seed(&grp->rng, ((uint64_t)rand() << 32) ^ (uint64_t)rand(), 0);
 
 	int i;
 	for (i = 0; i < num_chrs; i++)
 	{
-		// initialise chromosomes
-		grp->chrs[i] = init_chromo(num_genes);
+		// initialise chromosomes over their slot in the arena
+		grp->chrs[i] = &grp->chr_pool[i];
+		bind_chromo(grp->chrs[i], num_genes, grp->arena + (size_t)i * num_genes);
 	}
 
 	return grp;
 }
 
 
+/*
+ * alloc memories to the group struct and members, and
+ * initialise each chromosome in the group
+ */
+Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate)
+{
+	Group* grp = alloc_group(num_genes, num_chrs, cross_rate, mutate_rate);
+
+	fill_genes(grp, NULL);
+
+	return grp;
+}
+
+
+/*
+ * as init_group(), but the genes are left for
+ * fill_genes() or load_genes(), e.g. on a rank that
+ * only receives them
+ */
+Group* alloc_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate)
+{
+	return make_group(num_genes, num_chrs, cross_rate, mutate_rate, NULL);
+}
+
+
+/*
+ * as alloc_group(), but the genes of both generations
+ * live in a file at path mapped into memory, see store.h;
+ * returns NULL if the file cannot be made
+ */
+Group* alloc_group_mapped(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	const char* path)
+{
+	Store* store = init_store(path, num_chrs, num_genes);
+	if (NULL == store)
+		return NULL;
+
+	return make_group(num_genes, num_chrs, cross_rate, mutate_rate, store);
+}
+
+
+/*
+ * blocks of the arena to fill and the seed of their
+ * streams, only use this type inside this file
+ */
+typedef struct
+{
+	unsigned char* arena;
+	size_t size;
+	uint64_t seed;
+	int first;		// block of the first task
+}GeneFill;
+
+
+/*
+ * fill block first + i of the arena from its stream,
+ * only use this function inside this file
+ */
+static void fill_block(void* arg, int i)
+{
+	GeneFill* fill = (GeneFill*)arg;
+	int block = fill->first + i;
+	size_t begin = (size_t)block * GENE_BLOCK;
+	size_t end = begin + GENE_BLOCK < fill->size ? begin + GENE_BLOCK : fill->size;
+	Rng rng;
+
+	rng_seed(&rng, fill->seed, (uint64_t)block + 1);
+
+	for (; begin + sizeof(uint64_t) <= end; begin += sizeof(uint64_t))
+	{
+		uint64_t bits = rng_next(&rng);
+		memcpy(fill->arena + begin, &bits, sizeof(bits));
+	}
+
+	if (begin < end)
+	{
+		uint64_t bits = rng_next(&rng);
+		memcpy(fill->arena + begin, &bits, end - begin);
+	}
+}
+
+
+/*
+ * fill the genes with random values on the threads of
+ * pool, or this thread if pool is NULL: the arena is cut
+ * into blocks of GENE_BLOCK bytes, each drawn 8 bytes at
+ * a time from a stream of its own, so the genes only
+ * depend on the stream of the group, not on the # of
+ * threads
+ */
+void fill_genes(Group* grp, Pool* pool)
+{
+	GeneFill fill;
+	int i;
+
+	fill.arena = grp->arena;
+	fill.size = (size_t)grp->num_chrs * grp->num_genes;
+	fill.seed = rng_next(&grp->rng);
+	fill.first = 0;
+
+	int num_blocks = (int)((fill.size + GENE_BLOCK - 1) / GENE_BLOCK);
+
+	// a store is filled about a block of it at a time,
+	// dropping the pages written so far
+	int step = num_blocks;
+	if (NULL != grp->store)
+		step = (int)(STORE_BLOCK / GENE_BLOCK);
+
+	for (; fill.first < num_blocks; fill.first += step)
+	{
+		int count = fill.first + step < num_blocks ? step : num_blocks - fill.first;
+
+		if (NULL != pool)
+			pool_for_static(pool, count, fill_block, &fill);
+		else
+		{
+			for (i = 0; i < count; i++)
+			{
+				fill_block(&fill, i);
+			}
+		}
+
+		if (NULL != grp->store)
+		{
+			int done = (int)((size_t)(fill.first + count) * GENE_BLOCK / grp->num_genes);
+			store_drop(grp->store, grp->arena, (int)((size_t)fill.first * GENE_BLOCK /
+				grp->num_genes), done < grp->num_chrs ? done : grp->num_chrs);
+		}
+	}
+}
+
+
+/*
+ * read the genes of all chromosomes, one after another,
+ * from the raw bytes of the file at path, which must
+ * hold exactly num_chrs * num_genes bytes; returns 0, or
+ * -1 with a message if it does not
+ */
+int load_genes(Group* grp, const char* path)
+{
+	size_t size = (size_t)grp->num_chrs * grp->num_genes;
+
+	FILE* file = fopen(path, "rb");
+	if (NULL == file)
+	{
+		perror(path);
+		return -1;
+	}
+
+	// one more byte than needed tells a longer file
+	size_t got = fread(grp->arena, 1, size, file);
+	int extra = fgetc(file);
+	fclose(file);
+
+	if (got != size || EOF != extra)
+	{
+		fprintf(stderr, "%s: not %zu bytes of genes, %d chromosomes of %d segments\n", path, size,
+			grp->num_chrs, grp->num_genes);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 /*
  * update fitness of a chromosome, which counts # of 1's
  * in the binary form of the gene segements
@@ -68,25 +273,244 @@ double update_fitness(int num_genes, unsigned char* genes)
 
 
 /*
- * update relative fitness of all chromosomes in the group
+ * read a selection like "roulette", "rank", "rank:1.8",
+ * "truncation" or "truncation:0.2"; returns 0 and sets
+ * mode and param, or -1 if the text is not one
  */
-void update_fit_rate(Group* grp)
+int parse_selection(const char* text, int* mode, double* param)
 {
-	int i;
+	const char* colon = strchr(text, ':');
+	size_t len = NULL != colon ? (size_t)(colon - text) : strlen(text);
 
-	grp->fit_total = 0.0;
+	if (8 == len && 0 == strncmp("roulette", text, len) && NULL == colon)
+	{
+		*mode = SELECT_ROULETTE;
+		*param = 0.0;
+		return 0;
+	}
 
-	// update total fitness of the group
-	for (i = 0; i < grp->num_chrs; i++)
+	if (4 == len && 0 == strncmp("rank", text, len))
+	{
+		*mode = SELECT_RANK;
+		*param = NULL != colon ? atof(colon + 1) : 1.5;
+		return *param >= 1.0 && *param <= 2.0 ? 0 : -1;
+	}
+
+	if (10 == len && 0 == strncmp("truncation", text, len))
+	{
+		*mode = SELECT_TRUNCATION;
+		*param = NULL != colon ? atof(colon + 1) : 0.5;
+		return *param > 0.0 && *param <= 1.0 ? 0 : -1;
+	}
+
+	return -1;
+}
+
+
+/*
+ * select parents with mode from now on: roulette
+ * (the default), linear ranking of pressure param in
+ * [1, 2] where the best gets param / n and the worst
+ * (2 - param) / n, or truncation where every parent is
+ * drawn uniformly from the fittest param share of the
+ * group. The last two only use the order of the fitness,
+ * so it may be 0 or negative, and rank it on the
+ * threads of pool
+ */
+void set_selection(Group* grp, int mode, double param, Pool* pool)
+{
+	grp->select_mode = mode;
+	grp->select_param = param;
+
+	if (NULL != grp->ranker)
+		free_ranker(grp->ranker);
+	grp->ranker = NULL;
+
+	if (SELECT_ROULETTE != mode)
+		grp->ranker = init_ranker(grp->num_chrs, pool);
+}
+
+
+/*
+ * the parts update_fit_rate() cuts the group into and
+ * the sums of each, only use this type inside this file
+ */
+typedef struct
+{
+	Group* grp;
+	int num_parts;
+	ExactSum* totals;			// sum of fitness of each part
+	ExactSum* squares;		// sum of squared fitness of each part
+	double* bests;				// highest fitness of each part
+	int* counts;					// 1's at each bit position of each part
+}FitParts;
+
+
+/*
+ * sum up part p of the group, chromosomes
+ * [p * n / P, (p + 1) * n / P), only use this function
+ * inside this file
+ */
+static void sum_part(void* arg, int p)
+{
+	FitParts* parts = (FitParts*)arg;
+	Group* grp = parts->grp;
+	int num_chrs = grp->num_chrs;
+	int num_bits = grp->num_genes * CHAR_LENGTH;
+	int first = (int)((long)num_chrs * p / parts->num_parts);
+	int last = (int)((long)num_chrs * (p + 1) / parts->num_parts);
+	ExactSum* total = &parts->totals[p];
+	ExactSum* sum_sq = &parts->squares[p];
+	double best = grp->chrs[first]->fitness;
+	int i, j, bit;
+
+	exact_zero(total);
+	exact_zero(sum_sq);
+
+	int* counts = parts->counts + (size_t)p * num_bits;
+	if (grp->diversity_on)
+		memset(counts, 0, num_bits * sizeof(int));
+
+	// collect the statistics while each chromosome is in
+	// the cache
+	for (i = first; i < last; i++)
 	{
-		grp->fit_total += grp->chrs[i]->fitness;
+		double fitness = grp->chrs[i]->fitness;
+
+		exact_add(total, fitness);
+		exact_add(sum_sq, fitness * fitness);
+		if (fitness > best)
+			best = fitness;
+
+		if (grp->diversity_on)
+		{
+			if (NULL != grp->store)
+				store_stream(grp->store, grp->arena, i, num_chrs);
+
+			// count the 1's at each bit position
+			for (j = 0; j < grp->num_genes; j++)
+			{
+				unsigned char gene = grp->chrs[i]->genes[j];
+				int* count = counts + j * CHAR_LENGTH;
+
+				for (bit = 0; bit < CHAR_LENGTH; bit++)
+				{
+					count[bit] += (gene >> (CHAR_LENGTH - bit - 1)) & 1;
+				}
+			}
+		}
 	}
 
+	parts->bests[p] = best;
+}
+
+
+/*
+ * update relative fitness of all chromosomes in the group,
+ * and fill in the statistics of the group in the same pass,
+ * on the threads of pool, or this thread if pool is NULL
+ */
+void update_fit_rate(Group* grp, Pool* pool)
+{
+	int i, part, bit;
+	int num_chrs = grp->num_chrs;
+	int num_bits = grp->num_genes * CHAR_LENGTH;
+	FitParts parts;
+
+	PROF_BEGIN(PROF_FIT_RATE);
+
+	// a part per thread; a store is read front to back in
+	// one pass (see store_stream())
+	parts.grp = grp;
+	parts.num_parts = 1;
+	if (NULL != pool && NULL == grp->store && num_chrs >= pool->num_threads)
+		parts.num_parts = pool->num_threads;
+
+	parts.totals = (ExactSum*)malloc(parts.num_parts * sizeof(ExactSum));
+	parts.squares = (ExactSum*)malloc(parts.num_parts * sizeof(ExactSum));
+	parts.bests = (double*)malloc(parts.num_parts * sizeof(double));
+	parts.counts = grp->bit_counts;
+	if (parts.num_parts > 1 && grp->diversity_on)
+		parts.counts = (int*)malloc((size_t)parts.num_parts * num_bits * sizeof(int));
+
+	if (parts.num_parts > 1)
+		pool_for_static(pool, parts.num_parts, sum_part, &parts);
+	else
+		sum_part(&parts, 0);
+
+	// exact sums, the same bits however the group was cut
+	ExactSum total = parts.totals[0];
+	ExactSum sum_sq = parts.squares[0];
+	double best = parts.bests[0];
+
+	for (part = 1; part < parts.num_parts; part++)
+	{
+		exact_merge(&total, &parts.totals[part]);
+		exact_merge(&sum_sq, &parts.squares[part]);
+		if (parts.bests[part] > best)
+			best = parts.bests[part];
+	}
+
+	if (parts.counts != grp->bit_counts)
+	{
+		memcpy(grp->bit_counts, parts.counts, num_bits * sizeof(int));
+		for (part = 1; part < parts.num_parts; part++)
+		{
+			const int* counts = parts.counts + (size_t)part * num_bits;
+
+			for (bit = 0; bit < num_bits; bit++)
+			{
+				grp->bit_counts[bit] += counts[bit];
+			}
+		}
+
+		free(parts.counts);
+	}
+
+	free(parts.totals);
+	free(parts.squares);
+	free(parts.bests);
+
+	grp->fit_total = exact_value(&total);
+
 	// calculate relative fitness of each chromosome
-	for (i = 0; i < grp->num_chrs; i++)
+	for (i = 0; i < num_chrs; i++)
 	{
-		grp->fit_rate[i] = grp->chrs[i]->fitness / grp->fit_total;
+		// a group of zero fitness leaves every chromosome
+		// the same share instead of dividing by 0
+		if (grp->fit_total > 0.0)
+			grp->fit_rate[i] = grp->chrs[i]->fitness / grp->fit_total;
+		else
+			grp->fit_rate[i] = 1.0 / num_chrs;
 	}
+
+	double mean = grp->fit_total / num_chrs;
+	double variance = exact_value(&sum_sq) / num_chrs - mean * mean;
+
+	grp->stats.generation = grp->generation;
+	grp->stats.num_chrs = num_chrs;
+	grp->stats.best = best;
+	grp->stats.mean = mean;
+	grp->stats.variance = variance > 0.0 ? variance : 0.0;
+	grp->stats.diversity = 0.0;
+
+	if (grp->diversity_on)
+	{
+		// a bit position where a fraction p of the group
+		// has a 1 contributes 4p(1-p), which is 1 when
+		// half of the group has a 1 and 0 when all agree
+		ExactSum diversity;
+		exact_zero(&diversity);
+		for (bit = 0; bit < num_bits; bit++)
+		{
+			double p = (double)grp->bit_counts[bit] / num_chrs;
+			exact_add(&diversity, 4.0 * p * (1.0 - p));
+		}
+
+		grp->stats.diversity = exact_value(&diversity) / num_bits;
+	}
+
+	PROF_END(PROF_FIT_RATE);
 }
 
 
@@ -96,64 +520,216 @@ void update_fit_rate(Group* grp)
  */
 void evolve(Group* grp)
 {
+	PROF_BEGIN(PROF_SELECT);
 	select_parent(grp);
+	PROF_END(PROF_SELECT);
+
+	PROF_BEGIN(PROF_CROSSOVER);
 	crossover(grp);
+	PROF_END(PROF_CROSSOVER);
+
+	PROF_BEGIN(PROF_MUTATE);
 	mutate(grp);
+	PROF_END(PROF_MUTATE);
+
+	grp->generation++;
+}
+
+
+/*
+ * slot of the wheel where rv falls: the first one whose
+ * running sum cum reaches it, else the last one, only
+ * use this function inside this file
+ */
+static int spin_wheel(const double* cum, int n, double rv)
+{
+	int lo = 0, hi = n - 1;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (rv > cum[mid])
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+
+/*
+ * copy the children counted in grp->copies out of the
+ * old generation in the arena into the scratch arena,
+ * reading both front to back, and make it the arena;
+ * the children of each block are shuffled so that
+ * crossover() does not pair the copies of a parent,
+ * only use this function inside this file
+ */
+static void stream_children(Group* grp)
+{
+	Store* st = grp->store;
+	int num_genes = grp->num_genes;
+	int num_chrs = grp->num_chrs;
+	int block = st->block_chrs;
+	unsigned char* old = grp->arena;
+	unsigned char* young = grp->scratch;
+	int i, j, k, read = 0;
+
+	// the parents of the children in the order of the
+	// old generation, a counting sort
+	for (i = 0, k = 0; k < num_chrs; k++)
+	{
+		for (j = 0; j < grp->copies[k]; j++)
+		{
+			grp->parents[i++] = k;
+		}
+	}
+
+	for (i = 0; i < num_chrs; i += block)
+	{
+		int end = i + block < num_chrs ? i + block : num_chrs;
+
+		// the parents of this block come next in the old
+		// generation, from the first one on; the store reads
+		// them ahead and drops the ones no block needs again
+		for (; read <= grp->parents[i]; read++)
+		{
+			store_stream(st, old, read, num_chrs);
+		}
+
+		// Fisher-Yates within the block
+		for (j = end - 1; j > i; j--)
+		{
+			int r = i + rng_below(&grp->rng, j - i + 1);
+			int tmp = grp->parents[j];
+			grp->parents[j] = grp->parents[r];
+			grp->parents[r] = tmp;
+		}
+
+		for (j = i; j < end; j++)
+		{
+			store_stream(st, young, j, num_chrs);
+			memcpy(young + (size_t)j * num_genes, old + (size_t)grp->parents[j] * num_genes,
+				num_genes * sizeof(unsigned char));
+
+			if (NULL != grp->script)
+				grp->script->select[j] = grp->parents[j];
+		}
+	}
+
+	// the children are the new arena, the old generation
+	// is overwritten by the next one
+	grp->arena = young;
+	grp->scratch = old;
+
+	for (i = 0; i < num_chrs; i++)
+	{
+		bind_chromo(grp->chrs[i], num_genes, young + (size_t)i * num_genes);
+	}
 }
 
 
 /*
  * select parent process that chooses new chromosomes
  * based on relative fitness. The chromosomes with
- * higher fitness rate have bigger chances to be chosen
+ * higher fitness rate have bigger chances to be chosen.
+ * With a store the old generation is read front to back
+ * and the children of a block are shuffled among
+ * themselves, so pairs only mate within a block
  */
 void select_parent(Group* grp)
 {
 	int num_genes = grp->num_genes;
 	int num_chrs = grp->num_chrs;
+	Ranker* rk = grp->ranker;
+	int num_top = 0;		// # of chromosomes truncation draws from
 
-	// tmp chromosome list to hold the old generation
-	Chromo* tmp = (Chromo*)malloc(num_chrs * sizeof(Chromo));
+	// the scratch arena holds the old generation; a store
+	// only counts the draws and copies them in one pass
+	if (NULL == grp->store)
+		memcpy(grp->scratch, grp->arena, num_chrs * num_genes * sizeof(unsigned char));
+	else
+		memset(grp->copies, 0, num_chrs * sizeof(int));
 
-	int i, j;
-	for (i = 0; i < num_chrs; i++)
+	// a new generation starts a new script
+	if (NULL != grp->script)
+		clear_script(grp->script);
+
+	int i;
+
+	if (SELECT_ROULETTE == grp->select_mode)
+	{
+		// running sums of the relative fitness, added up in
+		// the order of a linear scan of the wheel
+		grp->fit_cum[0] = grp->fit_rate[0];
+		for (i = 1; i < num_chrs; i++)
+		{
+			grp->fit_cum[i] = grp->fit_cum[i-1] + grp->fit_rate[i];
+		}
+	}
+	else
 	{
-		tmp[i].genes = (unsigned char*)malloc(num_genes * sizeof(unsigned char));
+		for (i = 0; i < num_chrs; i++)
+		{
+			rk->fitness[i] = grp->chrs[i]->fitness;
+		}
+	}
+
+	if (SELECT_RANK == grp->select_mode)
+	{
+		// slot pos of the wheel belongs to the chromosome of
+		// rank pos from the worst, its share grows linearly
+		// from (2 - s) / n to s / n; these are running sums
+		double s = grp->select_param;
+		sort_fitness(rk);
 
-		for (j = 0; j < num_genes; j++)
+		for (i = 0; i < num_chrs; i++)
 		{
-			// copy the genes of the old generation
-			tmp[i].genes[j] = grp->chrs[i]->genes[j];
+			grp->fit_cum[i] = ((2.0 - s) * (i + 1) + (s - 1.0) * i * (i + 1.0) / (num_chrs - 1)) /
+				num_chrs;
 		}
 	}
+	else if (SELECT_TRUNCATION == grp->select_mode)
+	{
+		num_top = (int)(grp->select_param * num_chrs + 0.5);
+		if (num_top < 1)
+			num_top = 1;
+		select_top(rk, num_top);
+	}
 
-	// iterate through all chromosomes and select
-	// new ones using Roulette Wheel Selection
+	// iterate through all chromosomes and select new
+	// ones from the wheel, or from the fittest ones
 	for (i = 0; i < num_chrs; i++)
 	{
-		int k = 0;
-		double fit_rate_sum = grp->fit_rate[k];
-		double rv = (double)rand() / RAND_MAX;
+		int k;
 
-		// check which slot the RV falls
-		while (rv > fit_rate_sum)
+		if (SELECT_TRUNCATION == grp->select_mode)
 		{
-			k++;
-			fit_rate_sum += grp->fit_rate[k];
+			k = rk->order[num_chrs - num_top + rng_below(&grp->rng, num_top)];
+		}
+		else
+		{
+			k = spin_wheel(grp->fit_cum, num_chrs, rng_uniform(&grp->rng));
+			if (SELECT_RANK == grp->select_mode)
+				k = rk->order[k];
 		}
 
-		// select a new chromosomes to replace old generation
-		for (j = 0; j < num_genes; j++)
+		if (NULL != grp->store)
 		{
-			grp->chrs[i]->genes[j] = tmp[k].genes[j];
+			grp->copies[k]++;
+			continue;
 		}
-	}
 
-	for (i = 0; i < num_chrs; i++)
-	{
-		free(tmp[i].genes);
+		// select a new chromosomes to replace old generation
+		memcpy(grp->chrs[i]->genes, grp->scratch + k * num_genes, num_genes * sizeof(unsigned char));
+
+		if (NULL != grp->script)
+			grp->script->select[i] = k;
 	}
-	free(tmp);
+
+	if (NULL != grp->store)
+		stream_children(grp);
 }
 
 
@@ -164,44 +740,75 @@ void select_parent(Group* grp)
  */
 void crossover(Group* grp)
 {
-	int num_chrs = grp->num_chrs;
+	int i;
+
+	// iterate through chromosomes in pairs
+	for (i = 0; i < grp->num_chrs; i += 2)
+	{
+		crossover_pair(grp, i);
+	}
+}
+
+
+/*
+ * exchange the bits of chromosomes i and i+1 after a
+ * bit position, only use this function inside this file
+ */
+static void cut_pair(Group* grp, int i, int gene_pos, int bit_pos)
+{
 	int num_genes = grp->num_genes;
+	int j;
 
-	int i, j;
+	// exchange bits after bit_pos in the same gene segment
+	unsigned char gene1 = grp->chrs[i]->genes[gene_pos];
+	unsigned char gene2 = grp->chrs[i+1]->genes[gene_pos];
 
-	// iterate through chromosomes in pairs
-	for (i = 0; i < num_chrs; i += 2)
+	unsigned char mask1 = CHAR_MAX << (CHAR_LENGTH - bit_pos + 1);
+	unsigned char mask2 = CHAR_MAX >> (bit_pos - 1);
+
+	grp->chrs[i]->genes[gene_pos] = (gene1 & mask1) + (gene2 & mask2);
+	grp->chrs[i+1]->genes[gene_pos] = (gene2 & mask1) + (gene1 & mask2);
+
+	// exchage gene segments after gene_pos
+	for (j = gene_pos + 1; j < num_genes; j++)
 	{
-		double rv = (double)rand() / RAND_MAX;
+		unsigned char tmp = grp->chrs[i]->genes[j];
+		grp->chrs[i]->genes[j] = grp->chrs[i+1]->genes[j];
+		grp->chrs[i+1]->genes[j] = tmp;
+	}
+}
 
-		// if RV is less than crossover rate, do crossover
-		if (rv <= grp->cross_rate)
-		{
-			int gene_pos;		// index of gene segment
-			int bit_pos;		// bit position of gene segment
 
-			// randomly select a gene segment and the bit position
-			select_bit(grp->num_genes, &gene_pos, &bit_pos);
+/*
+ * crossover of chromosomes i and i+1, the step of
+ * crossover() for a single pair
+ */
+void crossover_pair(Group* grp, int i)
+{
+	if (NULL != grp->store)
+		store_stream(grp->store, grp->arena, i, grp->num_chrs);
 
-			// exchange bits after bit_pos in the same gene segment
-			unsigned char gene1 = grp->chrs[i]->genes[gene_pos];
-			unsigned char gene2 = grp->chrs[i+1]->genes[gene_pos];
+	double rv = rng_uniform(&grp->rng);
 
-			unsigned char mask1 = CHAR_MAX << (CHAR_LENGTH - bit_pos + 1);
-			unsigned char mask2 = CHAR_MAX >> (bit_pos - 1);
+	// if RV is less than crossover rate, do crossover
+	if (rv <= grp->cross_rate)
+	{
+		int gene_pos;		// index of gene segment
+		int bit_pos;		// bit position of gene segment
 
-			grp->chrs[i]->genes[gene_pos] = (gene1 & mask1) + (gene2 & mask2);
-			grp->chrs[i+1]->genes[gene_pos] = (gene2 & mask1) + (gene1 & mask2);
-			
-			// exchage gene segments after gene_pos
-			for (j = gene_pos + 1; j < num_genes; j++)
-			{
-				unsigned char tmp = grp->chrs[i]->genes[j];
-				grp->chrs[i]->genes[j] = grp->chrs[i+1]->genes[j];
-				grp->chrs[i+1]->genes[j] = tmp;
-			}
-		}	// end of if()
-	}	// end of i-for()
+		// randomly select a gene segment and the bit position
+		select_bit(&grp->rng, grp->num_genes, &gene_pos, &bit_pos);
+
+		cut_pair(grp, i, gene_pos, bit_pos);
+
+		if (NULL != grp->script)
+		{
+			EditScript* script = grp->script;
+			script->cuts[2 * script->num_cuts] = i;
+			script->cuts[2 * script->num_cuts + 1] = gene_pos * CHAR_LENGTH + bit_pos - 1;
+			script->num_cuts++;
+		}
+	}	// end of if()
 }
 
 
@@ -209,10 +816,10 @@ void crossover(Group* grp)
  * select a bit from a gene segment of a chromosome
  * for the crossover process
  */
-void select_bit(int num_genes, int* gene_pos, int* bit_pos)
+void select_bit(Rng* rng, int num_genes, int* gene_pos, int* bit_pos)
 {
 	int bit_total = num_genes * CHAR_LENGTH;
-	int rv = rand() % bit_total;
+	int rv = rng_below(rng, bit_total);
 
 	*gene_pos = rv / CHAR_LENGTH;			// index of gene segment
 	*bit_pos = rv % CHAR_LENGTH + 1;	// bit position of gene segment
@@ -226,44 +833,131 @@ void select_bit(int num_genes, int* gene_pos, int* bit_pos)
  */
 void mutate(Group* grp)
 {
-	int i, j, bit;
+	int i;
 
 	// iterate through every chromosome
 	for (i = 0; i < grp->num_chrs; i++)
 	{
-		// iterate through every gene segment
-		for (j = 0; j < grp->num_genes; j++)
+		mutate_chromo(grp, i);
+	}
+}
+
+
+/*
+ * mutation of every bit of chromosome i, the step of
+ * mutate() for a single chromosome
+ */
+void mutate_chromo(Group* grp, int i)
+{
+	int j, bit;
+
+	if (NULL != grp->store)
+		store_stream(grp->store, grp->arena, i, grp->num_chrs);
+
+	// iterate through every gene segment
+	for (j = 0; j < grp->num_genes; j++)
+	{
+		// iterate through every bit in the gene segment
+		for (bit = 0; bit < CHAR_LENGTH; bit++)
 		{
-			// iterate through every bit in the gene segment
-			for (bit = 0; bit < CHAR_LENGTH; bit++)
+			double rv = rng_uniform(&grp->rng);
+
+			// if RV is less than mutation rate, execute mutation
+			if (rv < grp->mutate_rate)
 			{
-				double rv = (double)rand() / RAND_MAX;
+				unsigned char mask = 1 << (CHAR_LENGTH - bit - 1);
+				grp->chrs[i]->genes[j] ^= mask;
 
-				// if RV is less than mutation rate, execute mutation
-				if (rv < grp->mutate_rate)
-				{
-					unsigned char mask = 1 << (CHAR_LENGTH - bit - 1);
-					grp->chrs[i]->genes[j] ^= mask;
-				}
-			}	// end bit-for()
-		}	// end j-for()
-	}	// end i-for()
+				if (NULL != grp->script)
+					add_flip(grp->script, ((int64_t)i * grp->num_genes + j) * CHAR_LENGTH + bit);
+			}
+		}	// end bit-for()
+	}	// end j-for()
 }
 
 
 /*
- * free memories of the group and members
+ * apply the changes of one generation recorded by the
+ * operators of another group with the same genes
  */
-void free_group(Group* grp)
+void replay_script(Group* grp, const EditScript* script)
+{
+	int num_genes = grp->num_genes;
+	int num_chrs = grp->num_chrs;
+	int i;
+
+	memcpy(grp->scratch, grp->arena, num_chrs * num_genes * sizeof(unsigned char));
+	for (i = 0; i < num_chrs; i++)
+	{
+		memcpy(grp->chrs[i]->genes, grp->scratch + script->select[i] * num_genes,
+			num_genes * sizeof(unsigned char));
+	}
+
+	for (i = 0; i < script->num_cuts; i++)
+	{
+		int bit = script->cuts[2 * i + 1];
+		cut_pair(grp, script->cuts[2 * i], bit / CHAR_LENGTH, bit % CHAR_LENGTH + 1);
+	}
+
+	for (i = 0; i < script->num_flips; i++)
+	{
+		int64_t bit = script->flips[i];
+		grp->arena[bit / CHAR_LENGTH] ^= 1 << (CHAR_LENGTH - bit % CHAR_LENGTH - 1);
+	}
+
+	grp->generation++;
+}
+
+
+/*
+ * move the genes of the group to arena, which the
+ * caller owns and keeps alive until free_group()
+ */
+void move_arena(Group* grp, unsigned char* arena)
 {
+	size_t size = grp->num_chrs * grp->num_genes * sizeof(unsigned char);
 	int i;
+
+	memcpy(arena, grp->arena, size);
+	if (grp->arena_owned)
+		free_big(grp->arena, size);
+
+	grp->arena = arena;
+	grp->arena_owned = 0;
+
 	for (i = 0; i < grp->num_chrs; i++)
 	{
-		free_chromo(grp->chrs[i]);
+		bind_chromo(grp->chrs[i], grp->num_genes, arena + i * grp->num_genes);
 	}
+}
+
+
+/*
+ * free memories of the group and members
+ */
+void free_group(Group* grp)
+{
+	size_t size = grp->num_chrs * grp->num_genes * sizeof(unsigned char);
 
 	free(grp->chrs);
+	free(grp->chr_pool);
+	if (grp->arena_owned)
+		free_big(grp->arena, size);
+	if (NULL == grp->store)
+		free_big(grp->scratch, size);
+	else
+	{
+		free_store(grp->store);
+		free(grp->copies);
+		free(grp->parents);
+	}
+	free(grp->bit_counts);
 	free(grp->fit_rate);
+	free(grp->fit_cum);
+	if (NULL != grp->ranker)
+		free_ranker(grp->ranker);
+	if (NULL != grp->script)
+		free_script(grp->script);
 	free(grp);
 }
 
@@ -19,10 +19,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "chromo.h"
+#include "rng.h"
+#include "stats.h"
+#include "delta.h"
+#include "alloc.h"
+#include "rank.h"
+#include "store.h"
 
 
 #define CHAR_MAX 255		// max value of unsigned char
 #define CHAR_LENGTH 8		// # of bits of unsigned char
+#define SELECT_ROULETTE 0		// fitness-proportional selection
+#define SELECT_RANK 1				// linear ranking selection
+#define SELECT_TRUNCATION 2	// uniform among the fittest
+#define GENE_BLOCK 65536		// bytes of genes drawn from one stream
 
 
 /*============ Type Definition ============*/
@@ -30,11 +40,28 @@ typedef struct
 {
 	int num_genes;			// # of gene segments
 	int num_chrs;				// # of chromosomes
+	int generation;			// # of generations evolved so far
 	double cross_rate;	// crossover rate
 	double mutate_rate;	// mutation rate
 	double fit_total;		// total fitness of the group
 	double* fit_rate;		// relative fitness of each chromosome
+	double* fit_cum;		// running sums of the selection wheel
+	int select_mode;		// SELECT_ROULETTE, SELECT_RANK or SELECT_TRUNCATION
+	double select_param;	// pressure of SELECT_RANK, share of SELECT_TRUNCATION
+	Ranker* ranker;			// ranks the group, unless SELECT_ROULETTE
+	unsigned char* arena;		// genes of all chromosomes, back to back
+	int arena_owned;				// the arena is freed with the group
+	unsigned char* scratch;	// copy of the arena used by select_parent()
+	Chromo* chr_pool;		// chromosome structs bound to the arena
 	Chromo** chrs;			// a list of chromosomes
+	Rng rng;						// random number stream of the group
+	GenStats stats;			// statistics filled by update_fit_rate()
+	int diversity_on;		// also count bits for the diversity stat
+	int* bit_counts;		// # of 1's at each bit position
+	EditScript* script;	// records the changes of evolve(), or NULL
+	Store* store;				// file holding arena and scratch, or NULL
+	int* copies;				// # of children of each parent, with a store
+	int* parents;				// parent of each child, with a store
 }Group;
 
 
@@ -46,6 +73,43 @@ typedef struct
 Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate);
 
 
+/*
+ * as init_group(), but the genes are left for
+ * fill_genes() or load_genes(), e.g. on a rank that
+ * only receives them
+ */
+Group* alloc_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate);
+
+
+/*
+ * as alloc_group(), but the genes of both generations
+ * live in a file at path mapped into memory, see store.h;
+ * returns NULL if the file cannot be made
+ */
+Group* alloc_group_mapped(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	const char* path);
+
+
+/*
+ * fill the genes with random values on the threads of
+ * pool, or this thread if pool is NULL: the arena is cut
+ * into blocks of GENE_BLOCK bytes, each drawn 8 bytes at
+ * a time from a stream of its own, so the genes only
+ * depend on the stream of the group, not on the # of
+ * threads
+ */
+void fill_genes(Group* grp, Pool* pool);
+
+
+/*
+ * read the genes of all chromosomes, one after another,
+ * from the raw bytes of the file at path, which must
+ * hold exactly num_chrs * num_genes bytes; returns 0, or
+ * -1 with a message if it does not
+ */
+int load_genes(Group* grp, const char* path);
+
+
 /*
  * update fitness of a chromosome, which counts # of 1's
  * in the binary form of the gene segements
@@ -54,9 +118,32 @@ double update_fitness(int num_genes, unsigned char* genes);
 
 
 /*
- * update relative fitness of all chromosomes in the group
+ * read a selection like "roulette", "rank", "rank:1.8",
+ * "truncation" or "truncation:0.2"; returns 0 and sets
+ * mode and param, or -1 if the text is not one
+ */
+int parse_selection(const char* text, int* mode, double* param);
+
+
+/*
+ * select parents with mode from now on: roulette
+ * (the default), linear ranking of pressure param in
+ * [1, 2] where the best gets param / n and the worst
+ * (2 - param) / n, or truncation where every parent is
+ * drawn uniformly from the fittest param share of the
+ * group. The last two only use the order of the fitness,
+ * so it may be 0 or negative, and rank it on the
+ * threads of pool
  */
-void update_fit_rate(Group* grp);
+void set_selection(Group* grp, int mode, double param, Pool* pool);
+
+
+/*
+ * update relative fitness of all chromosomes in the group,
+ * and fill in the statistics of the group in the same pass,
+ * on the threads of pool, or this thread if pool is NULL
+ */
+void update_fit_rate(Group* grp, Pool* pool);
 
 
 /*
@@ -68,8 +155,12 @@ void evolve(Group* grp);
 
 /*
  * select parent process that chooses new chromosomes
- * based on relative fitness. The chromosomes with
- * higher fitness rate have bigger chances to be chosen
+ * based on relative fitness, or on the rank of the
+ * fitness (see set_selection()). The chromosomes with
+ * higher fitness have bigger chances to be chosen.
+ * With a store the old generation is read front to back
+ * and the children of a block are shuffled among
+ * themselves, so pairs only mate within a block
  */
 void select_parent(Group* grp);
 
@@ -82,11 +173,18 @@ void select_parent(Group* grp);
 void crossover(Group* grp);
 
 
+/*
+ * crossover of chromosomes i and i+1, the step of
+ * crossover() for a single pair
+ */
+void crossover_pair(Group* grp, int i);
+
+
 /*
  * select a bit from a gene segment of a chromosome
  * for the crossover process
  */
-void select_bit(int num_genes, int* gene_pos, int* bit_pos);
+void select_bit(Rng* rng, int num_genes, int* gene_pos, int* bit_pos);
 
 
 /*
@@ -97,6 +195,27 @@ void select_bit(int num_genes, int* gene_pos, int* bit_pos);
 void mutate(Group* grp);
 
 
+/*
+ * mutation of every bit of chromosome i, the step of
+ * mutate() for a single chromosome
+ */
+void mutate_chromo(Group* grp, int i);
+
+
+/*
+ * apply the changes of one generation recorded by the
+ * operators of another group with the same genes
+ */
+void replay_script(Group* grp, const EditScript* script);
+
+
+/*
+ * move the genes of the group to arena, which the
+ * caller owns and keeps alive until free_group()
+ */
+void move_arena(Group* grp, unsigned char* arena);
+
+
 /*
  * free memories of the group and members
  */
@@ -5,120 +5,606 @@
  *
  * This file is for testing parallel Genetic Algorithm
  * using Master-Slave model.
+ *
+ * Every generation the master breeds the group and
+ * hands the chromosomes out to the slaves, see sched.h
+ * for the protocol. With a single rank the master
+ * evaluates the group itself.
+ *
+ * With -w the chromosomes are evaluated by all ranks
+ * with work stealing instead, see steal.h.
+ *
+ * With -t every rank evaluates on that many threads
+ * (see pool.h), so one rank per node or per socket is
+ * enough; only the main thread of a rank calls MPI.
+ *
+ * Ranks on the node of the master share its arena
+ * (see shm.h) unless -z 0 is given.
+ *
+ * With -C the chromosomes are the cells of a torus grid
+ * that every rank evolves a strip of, with no master,
+ * see cellular.h.
+ *
+ * -N and -H place the population (see alloc.h); with
+ * -N local the pages are first touched by the threads
+ * of the pool, which are then pinned to the CPUs the
+ * launcher gave the rank, e.g. --bind-to socket.
+ *
+ * With -S the genes of the master live in a file mapped
+ * into memory, for groups larger than memory, see store.h.
+ * A snapshot would copy the group into memory, so -S
+ * runs without -k and -r.
+ *
+ * With -E the ranks publish live metrics to a shared
+ * memory segment that ./monitor reads, see telemetry.h.
  *=====================================================*/
 
 
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "chromo.h"
+#include "alloc.h"
 #include "group.h"
+#include "checkpoint.h"
+#include "stats.h"
+#include "prof.h"
+#include "sched.h"
+#include "steal.h"
+#include "pool.h"
+#include "shm.h"
+#include "stop.h"
+#include "cellular.h"
+#include "telemetry.h"
+
 
+/*========== Function Prototype ==========*/
+/*
+ * print usage and help info
+ */
+void print_usage(void);
 
+
+/*============== main() =================*/
 int main(int argc, char* argv[])
 {
 	srand((unsigned)time(NULL));
 
 	int i, rank, size;
-	int job_id;
 	int num_slaves;             // # of slaves
 	int num_gen = 100;          // # of generations
 	int num_genes = 2;          // # of gene segments
 	int num_chrs = 8;           // # of chromosomes
 	double cross_rate = 0.95;   // crossover rate
 	double mutate_rate = 0.001; // mutation rate
-	double fitness;
-	unsigned char* genes = (unsigned char*)malloc(num_genes * sizeof(unsigned char));
-	Group* grp = init_group(num_genes, num_chrs, cross_rate, mutate_rate);
-	MPI_Status stat;
+	char* ckpt_path = NULL;     // snapshot file to write
+	char* restart_path = NULL;  // snapshot file to restart from
+	char* genes_path = NULL;    // genes of the first generation
+	char* store_path = NULL;    // file of the genes, NULL = in memory
+	int ckpt_every = 10;        // # of generations between snapshots
+	char* stats_path = NULL;    // file of per-generation statistics
+	int stats_format = STATS_CSV; // format of the statistics file
+	char* prof_prefix = NULL;   // prefix of the timing report files
+	long spin_ns = 0;           // extra busy work per evaluation
+	char* bench_label = NULL;   // label of the scaling result line
+	int depth = 2;              // max # of jobs outstanding per slave
+	int chunk = 0;              // chromosomes per stolen chunk, 0 = no stealing
+	double spread = 0.0;        // spread of the busy work per evaluation
+	int report = 0;             // print the utilization of every rank
+	int threads = 1;            // # of evaluation threads per rank
+	int zero_copy = 1;          // share the arena within the master's node
+	int delta = 1;              // send edit scripts to the replicas
+	int numa_policy = NUMA_DEFAULT; // placement of the population
+	int huge_pages = 0;         // back the population with huge pages
+	int grid_width = 0;         // width of the torus of a cellular GA, 0 = off
+	int select_mode = SELECT_ROULETTE; // how parents are selected
+	double select_param = 0.0;  // pressure or share of the selection
+	int select_ok = 1;          // the selection could be read
+	char* worker_cmd = NULL;    // command of the evaluator processes
+	double worker_timeout = 10.0; // seconds a batch of a worker may take
+	char* metrics_name = NULL;  // shared memory segment of live metrics
+	StopRule rule;              // when to end the run early
+	int reason = STOP_NONE;     // why the run ended
+	int provided;               // thread support of the MPI library
+	Traffic traffic = {0, 0, 0, 0, 0.0};
+
+	init_stop_rule(&rule);
 
-	MPI_Init(&argc, &argv);
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-	/* master is here */
-	if (0 == rank)
+	// all arguments are optional, the order is arbitrary
+	if (0 == argc % 2)
 	{
-		num_slaves = size - 1;
-		job_id = 0;
+		if (0 == rank)
+			print_usage();  // print usage and help info
+		MPI_Finalize();
+		exit (1);
+	}
 
-		for (i = 1; i < size; i++)
+	for (i = 1; i < argc; i+=2)
+	{
+		if (0 == strcmp("-s",argv[i]))
+			num_genes = atoi(argv[i+1]);
+		else if (0 == strcmp("-p",argv[i]))
+			num_chrs = atoi(argv[i+1]);
+		else if (0 == strcmp("-g",argv[i]))
+			num_gen = atoi(argv[i+1]);
+		else if (0 == strcmp("-c",argv[i]))
+			cross_rate = atof(argv[i+1]);
+		else if (0 == strcmp("-m",argv[i]))
+			mutate_rate = atof(argv[i+1]);
+		else if (0 == strcmp("-k",argv[i]))
+			ckpt_path = argv[i+1];
+		else if (0 == strcmp("-n",argv[i]))
+			ckpt_every = atoi(argv[i+1]);
+		else if (0 == strcmp("-r",argv[i]))
+			restart_path = argv[i+1];
+		else if (0 == strcmp("-I",argv[i]))
+			genes_path = argv[i+1];
+		else if (0 == strcmp("-S",argv[i]))
+			store_path = argv[i+1];
+		else if (0 == strcmp("-o",argv[i]))
+			stats_path = argv[i+1];
+		else if (0 == strcmp("-f",argv[i]) && 0 == strcmp("csv",argv[i+1]))
+			stats_format = STATS_CSV;
+		else if (0 == strcmp("-f",argv[i]) && 0 == strcmp("bin",argv[i+1]))
+			stats_format = STATS_BINARY;
+		else if (0 == strcmp("-P",argv[i]))
+			prof_prefix = argv[i+1];
+		else if (0 == strcmp("-e",argv[i]))
+			spin_ns = atol(argv[i+1]);
+		else if (0 == strcmp("-B",argv[i]))
+			bench_label = argv[i+1];
+		else if (0 == strcmp("-q",argv[i]))
+			depth = atoi(argv[i+1]);
+		else if (0 == strcmp("-w",argv[i]))
+			chunk = atoi(argv[i+1]);
+		else if (0 == strcmp("-x",argv[i]))
+			spread = atof(argv[i+1]);
+		else if (0 == strcmp("-u",argv[i]))
+			report = atoi(argv[i+1]);
+		else if (0 == strcmp("-t",argv[i]))
+			threads = atoi(argv[i+1]);
+		else if (0 == strcmp("-z",argv[i]))
+			zero_copy = atoi(argv[i+1]);
+		else if (0 == strcmp("-d",argv[i]))
+			delta = atoi(argv[i+1]);
+		else if (0 == strcmp("-N",argv[i]))
+			numa_policy = parse_numa_policy(argv[i+1]);
+		else if (0 == strcmp("-H",argv[i]))
+			huge_pages = atoi(argv[i+1]);
+		else if (0 == strcmp("-L",argv[i]))
+			select_ok = 0 == parse_selection(argv[i+1], &select_mode, &select_param);
+		else if (0 == strcmp("-C",argv[i]))
+			grid_width = atoi(argv[i+1]);
+		else if (0 == strcmp("-X",argv[i]))
+			worker_cmd = argv[i+1];
+		else if (0 == strcmp("-Y",argv[i]))
+			worker_timeout = atof(argv[i+1]);
+		else if (0 == strcmp("-E",argv[i]))
+			metrics_name = argv[i+1];
+		else if (0 == strcmp("-T",argv[i]))
 		{
-			// send next job i, send grp->chrs[i]->genes
-			MPI_Send(grp->chrs[job_id]->genes, num_genes, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD);
-			job_id++;
+			// "opt" is the OneMax optimum, resolved once -s is known
+			rule.use_target = 1;
+			rule.target = 0 == strcmp("opt",argv[i+1]) ? -1.0 : atof(argv[i+1]);
 		}
+		else if (0 == strcmp("-W",argv[i]))
+			rule.stall = atoi(argv[i+1]);
+		else if (0 == strcmp("-D",argv[i]))
+			rule.floor = atof(argv[i+1]);
+		else
+		{
+			if (0 == rank)
+				print_usage();  // print usage and help info
+			MPI_Finalize();
+			exit (2);
+		}
+	}
+
+#ifndef PGA_PROF
+	if (NULL != prof_prefix && 0 == rank)
+		fprintf(stderr, "-P ignored, timers are not compiled in (make PROF=1)\n");
+#endif
+
+	PROF_INIT(rank);
+
+	if (threads > 1 && provided < MPI_THREAD_FUNNELED)
+	{
+		if (0 == rank)
+			fprintf(stderr, "-t ignored, the MPI library has no thread support\n");
+		threads = 1;
+	}
+
+	if (depth < 1 || threads < 1 || chunk < 0 || spread < 0.0 || num_chrs < 2 || 0 != num_chrs % 2 ||
+		numa_policy < 0 || rule.stall < 0 || rule.floor < 0.0 || grid_width < 0 || !select_ok ||
+		worker_timeout <= 0.0 ||
+		(NULL != genes_path && (grid_width > 0 || NULL != restart_path)) ||
+		(NULL != store_path && (grid_width > 0 || chunk > 0 || NULL != ckpt_path ||
+		NULL != restart_path)) ||
+		(grid_width > 0 && (0 != grid_width % 2 || grid_width < 4 || 0 != num_chrs % grid_width ||
+		num_chrs / grid_width < 3 || num_chrs / grid_width < size || chunk > 0 ||
+		SELECT_ROULETTE != select_mode ||
+		NULL != ckpt_path || NULL != restart_path)))
+	{
+		if (0 == rank)
+			print_usage();  // print usage and help info
+		MPI_Finalize();
+		exit (2);
+	}
+
+	if (rule.use_target && rule.target < 0.0)
+		rule.target = num_genes * CHAR_LENGTH;
+
+	// the pool first, its threads touch the population
+	Pool* pool = init_pool(threads, NUMA_DEFAULT != numa_policy);
+	init_alloc(numa_policy, huge_pages);
+	set_first_touch(pool_touch, pool);
+
+	// evaluator processes on every rank that evaluates;
+	// the master of Master-Slave only does with no slaves
+	WorkerPool* workers = NULL;
+	if (NULL != worker_cmd && (0 != rank || 1 == size || chunk > 0 || grid_width > 0))
+	{
+		workers = init_workers(worker_cmd, threads, num_genes, WORKER_BATCH, worker_timeout);
+		if (NULL == workers)
+			MPI_Abort(MPI_COMM_WORLD, 3);
+		set_workers(workers);
+	}
+
+	// a Master-Slave job keeps every thread busy, or with
+	// -X every evaluator process busy on a full slot
+	int job_batch = NULL != worker_cmd ? threads * WORKER_BATCH : threads;
+
+	// a cellular GA has tiles instead of one group; else
+	// only the master breeds the group, and the stealing
+	// ranks keep a replica whose genes they receive
+	Group* grp = NULL;
+	if (0 == grid_width && 0 == rank && NULL != store_path)
+	{
+		grp = alloc_group_mapped(num_genes, num_chrs, cross_rate, mutate_rate, store_path);
+		if (NULL == grp)
+			MPI_Abort(MPI_COMM_WORLD, 3);
+	}
+	else if (0 == grid_width && (0 == rank || chunk > 0))
+		grp = alloc_group(num_genes, num_chrs, cross_rate, mutate_rate);
+
+	if (NULL != grp && 0 == rank)
+	{
+		if (NULL == genes_path)
+			fill_genes(grp, pool);
+		else if (0 != load_genes(grp, genes_path))
+			MPI_Abort(MPI_COMM_WORLD, 3);
+	}
+
+	// only the master selects, on the threads of its pool
+	if (NULL != grp && 0 == rank && SELECT_ROULETTE != select_mode)
+		set_selection(grp, select_mode, select_param, pool);
+	num_slaves = size - 1;
+
+	ShmArena* shm = NULL;
+	// the genes of a store stay in its file, they are sent
+	if (zero_copy && 0 == grid_width && NULL == store_path)
+	{
+		shm = init_shm_arena(num_chrs, num_genes);
+		if (0 == rank)
+			move_arena(grp, shm->genes);
+	}
+
+	Stealer* stealer = NULL;
+	if (chunk > 0)
+		stealer = init_stealer(num_chrs, chunk, spin_ns, spread, pool, shm, delta);
+
+	// rank 0 makes the segment, the ranks on its node join
+	// it, the run id keeps the others off stale segments
+	Telemetry* telemetry = NULL;
+	if (NULL != metrics_name)
+	{
+		uint64_t run_id = 0;
 
-		while (job_id < num_chrs)
+		if (0 == rank)
 		{
-			i = job_id % num_slaves + 1;
+			telemetry = create_telemetry(metrics_name, size);
+			if (NULL == telemetry)
+				MPI_Abort(MPI_COMM_WORLD, 3);
+			run_id = telemetry->block->run_id;
+		}
+
+		MPI_Bcast(&run_id, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+		if (0 != rank)
+			telemetry = join_telemetry(metrics_name, run_id, rank);
+
+		set_telemetry(telemetry);
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	double start = MPI_Wtime();
+	double wall;
+
+	/* Cellular Genetic Algorithm done by all ranks */
+	if (grid_width > 0)
+	{
+		// seeded from rand() of rank 0 like init_group()
+		uint64_t seed = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+		MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
 
-			// get result s, recv grp->chrs[s]->genes
-			MPI_Recv(&(grp->chrs[job_id-num_slaves]->fitness), 1, MPI_DOUBLE, i, 0, MPI_COMM_WORLD, &stat);
+		Cellular* cg = init_cellular(num_genes, num_chrs, grid_width, cross_rate, mutate_rate, seed,
+			spin_ns, spread, pool);
+		StatsSink* sink = NULL;
 
-			// send next job s, send grp->chrs[s]->genes
-			MPI_Send(grp->chrs[job_id]->genes, num_genes, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD);
-			job_id++;
+		// without them no rank waits for more than its two
+		// neighbours in a generation
+		int need_stats = NULL != stats_path || rule.use_target || rule.stall > 0 ||
+			rule.floor > 0.0;
+
+		if (NULL != stats_path && 0 == rank)
+		{
+			sink = init_stats_sink(stats_path, stats_format);
+			if (NULL == sink)
+				MPI_Abort(MPI_COMM_WORLD, 3);
 		}
 
-		int job_left = num_chrs % num_slaves;
-		for (i = 0; i < num_genes; i++)
+		cg->tile->diversity_on = NULL != stats_path || rule.floor > 0.0;
+
+		cellular_evaluate(cg);
+
+		while (cg->tile->generation < num_gen)
 		{
-			genes[i] = 0;
+			if (NULL != telemetry)
+				telemetry_phase(telemetry, TELEM_PHASE_STATS);
+
+			if (need_stats)
+			{
+				cellular_stats(cg);
+
+				if (0 == rank)
+				{
+					if (NULL != sink)
+						push_stats(sink, &cg->stats);
+
+					reason = check_stop(&rule, &cg->stats);
+				}
+
+				MPI_Bcast(&reason, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			}
+
+			if (NULL != telemetry)
+			{
+				telemetry_phase(telemetry, TELEM_PHASE_BREED);
+				publish_traffic(&cg->traffic);
+
+				// the statistics are only gathered if needed
+				if (0 == rank)
+					publish_generation(telemetry, cg->tile->generation, need_stats ? &cg->stats : NULL,
+						(long)num_chrs * (cg->tile->generation + 1));
+			}
+
+			if (STOP_NONE != reason)
+				break;
+
+			cellular_evolve(cg);
+			cellular_evaluate(cg);
 		}
 
-		for (i = 1; i < size; i++)
+		int gens = cg->tile->generation;
+
+		if (NULL != telemetry)
 		{
-			int pid = (i + job_left - 1) % num_slaves + 1;
+			telemetry_phase(telemetry, -1);
+			publish_traffic(&cg->traffic);
 
-			// get result s, recv grp->chrs[s]->fitness
-			MPI_Recv(&(grp->chrs[job_id-num_slaves]->fitness), 1, MPI_DOUBLE, pid, 0, MPI_COMM_WORLD, &stat);
-			job_id++;
+			if (0 == rank)
+				publish_generation(telemetry, gens, NULL, (long)num_chrs * (gens + 1));
+		}
+
+		free_cellular(cg, &traffic);
+
+		wall = MPI_Wtime() - start;
+
+		if (0 == rank)
+		{
+			if (STOP_NONE != reason)
+				fprintf(stderr, "stopped at generation %d: %s\n", gens, stop_name(reason));
 
-			// no more jobs s, send genes with all 0 values to represent no job
-			MPI_Send(genes, num_genes, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD);
+			if (NULL != bench_label)
+			{
+				printf("%s,%d,%d,%d,%d,%ld,%.6f,%.3f,%.1f,%.4f,%ld,%ld\n", bench_label, size,
+					num_chrs, num_genes, gens, spin_ns, wall, gens / wall,
+					(double)gens * num_chrs / wall, 1.0 - traffic.wait / wall,
+					traffic.msgs, traffic.bytes);
+			}
 		}
+
+		if (NULL != sink)
+			free_stats_sink(sink);
 	}
-	else
+	/* Genetic Algorithm Process done by master */
+	else if (0 == rank)
 	{
-		/* slaves are here */
-		while (1)
+		Master* master = NULL;
+		if (NULL == stealer)
+			master = init_master(num_slaves, depth, job_batch, num_genes, spin_ns, spread, pool,
+				shm);
+		Checkpointer* ckpt = NULL;
+		StatsSink* sink = NULL;
+		int first_gen = 0;
+
+		// continue from the generation stored in the snapshot
+		if (NULL != restart_path && 0 != load_checkpoint(restart_path, grp))
+			MPI_Abort(MPI_COMM_WORLD, 3);
+
+		if (NULL != ckpt_path)
+			ckpt = init_checkpointer(ckpt_path, grp);
+
+		if (NULL != stats_path)
+		{
+			sink = init_stats_sink(stats_path, stats_format);
+			if (NULL == sink)
+				MPI_Abort(MPI_COMM_WORLD, 3);
+
+			grp->diversity_on = 1;
+		}
+
+		// the diversity floor needs the bit counts
+		if (rule.floor > 0.0)
+			grp->diversity_on = 1;
+
+		first_gen = grp->generation;
+
+		// fitness of the first generation, later ones are
+		// evaluated while they are bred
+		if (NULL != stealer)
+			steal_evaluate(stealer, grp);
+		else
+			master_evaluate(master, grp);
+
+		// the traffic of this rank, for the metrics segment
+		Traffic* own = NULL != stealer ? &stealer->traffic : &master->traffic;
+
+		while (grp->generation < num_gen)
 		{
-			// get next job s, recv grp->chrs[s]->genes
-			MPI_Recv(genes, num_genes, MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, &stat);
+			if (NULL != telemetry)
+				telemetry_phase(telemetry, TELEM_PHASE_STATS);
 
-			// stop process if no job
-			unsigned char sum = 0;
-			for (i = 0; i < num_genes; i++)
+			update_fit_rate(grp, pool);
+
+			if (NULL != sink)
+				push_stats(sink, &grp->stats);
+
+			// the slaves only learn of it from the stop below
+			reason = check_stop(&rule, &grp->stats);
+
+			if (NULL != telemetry)
 			{
-			sum += genes[i];
+				telemetry_phase(telemetry, TELEM_PHASE_BREED);
+				publish_generation(telemetry, grp->generation, &grp->stats,
+					(long)num_chrs * (grp->generation - first_gen + 1));
+				publish_traffic(own);
 			}
 
-			// if sum of values of all gene segments is 0,
-			// it means no job and should stop
-			if (0 == sum)
-			break;
+			if (STOP_NONE != reason)
+				break;
 
-			// do work
-			fitness = update_fitness(num_genes, genes);
+			if (NULL != stealer)
+			{
+				evolve(grp);
+				steal_evaluate(stealer, grp);
+			}
+			else
+			{
+				master_breed_evaluate(master, grp);
+			}
+
+			if (NULL != ckpt && 0 == grp->generation % ckpt_every)
+			{
+				if (NULL != telemetry)
+					telemetry_phase(telemetry, TELEM_PHASE_CHECKPOINT);
 
-			// send result s, send fitness
-			MPI_Send(&fitness, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+				PROF_BEGIN(PROF_CHECKPOINT);
+				save_checkpoint(ckpt, grp);
+				PROF_END(PROF_CHECKPOINT);
+			}
 		}
-	}
 
-	/* Genetic Algorithm Process done by master */
-	if (0 == rank)
+		if (NULL != telemetry)
+		{
+			telemetry_phase(telemetry, -1);
+			publish_generation(telemetry, grp->generation, NULL,
+				(long)num_chrs * (grp->generation - first_gen + 1));
+			publish_traffic(own);
+		}
+
+		// no more jobs, tell every slave to stop
+		if (NULL != stealer)
+			free_stealer(stealer, &traffic);
+		else
+			free_master(master, &traffic);
+
+		wall = MPI_Wtime() - start;
+
+		if (STOP_NONE != reason)
+			fprintf(stderr, "stopped at generation %d: %s\n", grp->generation, stop_name(reason));
+
+		if (NULL != bench_label)
+		{
+			// one CSV line per run, see scaling.sh for the header
+			int gens = grp->generation - first_gen;
+			printf("%s,%d,%d,%d,%d,%ld,%.6f,%.3f,%.1f,%.4f,%ld,%ld\n", bench_label, size,
+				num_chrs, num_genes, gens, spin_ns, wall, gens / wall,
+				(double)gens * num_chrs / wall, 1.0 - traffic.wait / wall,
+				traffic.msgs, traffic.bytes);
+		}
+
+		if (NULL != ckpt)
+		{
+			// always leave a snapshot of the final generation,
+			// also when its save was skipped while busy
+			if (ckpt->saved_gen != grp->generation)
+			{
+				sync_checkpoint(ckpt);
+				save_checkpoint(ckpt, grp);
+			}
+
+			if (ckpt->num_skipped > 0)
+				fprintf(stderr, "%ld snapshots skipped while the writer was busy\n",
+					ckpt->num_skipped);
+
+			free_checkpointer(ckpt);
+		}
+
+		if (NULL != sink)
+			free_stats_sink(sink);
+	}
+	else
 	{
-		for (i = 0; i < num_gen; i++)
+		/* slaves are here */
+		if (NULL != stealer)
+		{
+			steal_loop(stealer, grp);
+			free_stealer(stealer, &traffic);
+		}
+		else
 		{
-			update_fit_rate(grp);
-			evolve(grp);
+			slave_loop(num_genes, job_batch, spin_ns, spread, pool, shm, &traffic);
 		}
+
+		wall = MPI_Wtime() - start;
+	}
+
+	if (report)
+		report_traffic(&traffic, wall);
+
+#ifdef PGA_PROF
+	if (NULL != prof_prefix)
+	{
+		// one report per rank: <prefix>.<rank>.json
+		char* rank_prefix = (char*)malloc(strlen(prof_prefix) + 16);
+		sprintf(rank_prefix, "%s.%d", prof_prefix, rank);
+		PROF_REPORT(rank_prefix);
+		free(rank_prefix);
+	}
+#endif
+
+	if (NULL != workers)
+	{
+		if (workers->timeouts > 0)
+			fprintf(stderr, "rank %d: %ld workers restarted, %ld batches lost\n", rank,
+				workers->timeouts, workers->lost);
+		free_workers(workers);
 	}
 
-	free(genes);
-	free_group(grp);
+	free_pool(pool);
+	if (NULL != grp)
+		free_group(grp);
+	if (NULL != shm)
+		free_shm_arena(shm);
+	if (NULL != telemetry)
+		free_telemetry(telemetry);
 
 	MPI_Finalize();
 
@@ -126,3 +612,68 @@ int main(int argc, char* argv[])
 
 	return 0;
 }
+
+
+/*========== Function Definition ==========*/
+/*
+ * print usage and help info
+ */
+void print_usage(void)
+{
+	printf("=== Usage: mpirun -np 4 ./main [-s 2 -p 8 -g 100 -c 0.95 -m 0.001]\n");
+	printf("    -s  # of gene segments, default 2\n");
+	printf("    -p  size of population/chromosomes, default 8\n");
+	printf("    -g  # of generations, default 100\n");
+	printf("    -c  crossover rate, very high, default 0.95\n");
+	printf("    -m  mutation rate, very low, default 0.001\n");
+	printf("    -k  snapshot file written during the run\n");
+	printf("    -n  # of generations between snapshots, default 10\n");
+	printf("    -r  snapshot file to restart the run from\n");
+	printf("    -I  file of the genes of the first generation, -p times\n");
+	printf("        -s raw bytes, one chromosome after another\n");
+	printf("    -S  file the master keeps the genes of two generations in,\n");
+	printf("        mapped into memory and read block by block; pairs mate\n");
+	printf("        within blocks of %lu MB; not with -w, -C, -k or -r,\n",
+		STORE_BLOCK >> 20);
+	printf("        implies -z 0\n");
+	printf("    -o  file of per-generation statistics\n");
+	printf("    -f  format of the statistics file, csv or bin\n");
+	printf("    -P  prefix of the per-rank timing reports, needs make PROF=1\n");
+	printf("    -e  ns of extra busy work per evaluation, default 0\n");
+	printf("    -B  label; print one line of scaling results, see scaling.sh\n");
+	printf("    -q  max # of jobs outstanding per slave, default 2\n");
+	printf("    -w  # of chromosomes per chunk; evaluate on all ranks with\n");
+	printf("        work stealing instead of Master-Slave, default 0 (off)\n");
+	printf("    -x  spread of the busy work, a chromosome costs up to\n");
+	printf("        (1 + x) times -e, default 0\n");
+	printf("    -u  1 to print the utilization of every rank, default 0\n");
+	printf("    -t  # of evaluation threads per rank, also the # of\n");
+	printf("        chromosomes per job, %d times that with -X, default 1\n", WORKER_BATCH);
+	printf("    -z  0 to send the genes to ranks on the node of the master\n");
+	printf("        instead of sharing the arena, default 1\n");
+	printf("    -d  0 to broadcast every genome to the stealing ranks instead\n");
+	printf("        of the changes of each generation, default 1\n");
+	printf("    -N  NUMA placement of the population, default, local or\n");
+	printf("        interleave; not default also pins the threads, default default\n");
+	printf("    -H  1 to back the population with 2 MB huge pages, default 0\n");
+	printf("    -L  selection: roulette, rank[:s] of pressure s in [1, 2],\n");
+	printf("        default 1.5, or truncation[:f] from the fittest share f,\n");
+	printf("        default 0.5; default roulette\n");
+	printf("    -C  width of a torus grid of the chromosomes; every rank\n");
+	printf("        evolves a strip of rows, a chromosome only breeds with\n");
+	printf("        its 4 neighbours; even, at least 4, -p a multiple with\n");
+	printf("        3 rows or more and a row per rank; not with -w, -k or -r\n");
+	printf("    -X  shell command of an evaluator process, see worker.h; every\n");
+	printf("        rank that evaluates runs -t of them, fed batches of up to\n");
+	printf("        %d chromosomes, e.g. \"./onemax_worker\"; default off\n", WORKER_BATCH);
+	printf("    -Y  seconds a batch of -X may take before its process is\n");
+	printf("        restarted and the batch scores %g, default 10\n", WORKER_PENALTY);
+	printf("    -E  name of a shared memory segment, e.g. /pga, to publish\n");
+	printf("        live metrics to; watch it with ./monitor, default off\n");
+	printf("    -T  target fitness, or opt for the optimum; stop once the\n");
+	printf("        best fitness reaches it, default off\n");
+	printf("    -W  stall window, stop after that many generations without\n");
+	printf("        a better best fitness, default 0 (off)\n");
+	printf("    -D  diversity floor in [0, 1], stop once the mean per-bit\n");
+	printf("        diversity is below it, default 0 (off)\n");
+}
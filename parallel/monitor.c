@@ -0,0 +1,108 @@
+/*=====================================================
+ * monitor.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * A reader of the live metrics of a run started with
+ * "-E name", see telemetry.h: it maps the segment
+ * read-only and prints the state of the run, and of
+ * every rank that publishes to it, every few seconds
+ * until the run is done.
+ *
+ * Usage: ./monitor name [seconds], seconds between two
+ * reports, default 1; 0 prints one report and exits.
+ *=====================================================*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "telemetry.h"
+
+
+/*========== Function Prototype ==========*/
+/*
+ * print one report of block to stdout; returns 1 if the
+ * run is done, 0 if not, or -1 if the block could not be
+ * read
+ */
+int print_report(const TelemBlock* block);
+
+
+/*============== main() =================*/
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		printf("=== Usage: ./monitor name [seconds]\n");
+		printf("    name     segment given to -E of main, e.g. /pga\n");
+		printf("    seconds  between two reports, 0 for one report, default 1\n");
+		exit (1);
+	}
+
+	double every = argc > 2 ? atof(argv[2]) : 1.0;
+	size_t size;
+
+	const TelemBlock* block = open_telemetry(argv[1], &size);
+	if (NULL == block)
+		exit (2);
+
+	while (1)
+	{
+		int done = print_report(block);
+
+		if (0 != done || every <= 0.0)
+			break;
+
+		struct timespec ts = {(time_t)every, (long)((every - (time_t)every) * 1e9)};
+		nanosleep(&ts, NULL);
+	}
+
+	munmap((void*)block, size);
+
+	return 0;
+}
+
+
+/*========== Function Definition ==========*/
+/*
+ * print one report of block to stdout; returns 1 if the
+ * run is done, 0 if not, or -1 if the block could not be
+ * read
+ */
+int print_report(const TelemBlock* block)
+{
+	TelemBlock head;
+	TelemRank slot;
+	int r;
+
+	if (0 != read_block(block, &head))
+	{
+		fprintf(stderr, "the run is stuck in an update\n");
+		return -1;
+	}
+
+	printf("%8.1fs  generation %d  %ld evals  %.1f evals/s  breed %.3fs  stats %.3fs"
+		"  checkpoint %.3fs%s\n", head.elapsed, head.generation, (long)head.evals,
+		head.evals_per_sec, head.phase_sec[TELEM_PHASE_BREED], head.phase_sec[TELEM_PHASE_STATS],
+		head.phase_sec[TELEM_PHASE_CHECKPOINT], head.done ? "  done" : "");
+
+	if (head.stats.generation >= 0)
+		printf("          generation %d: best %.4f  mean %.4f  diversity %.4f\n",
+			head.stats.generation, head.stats.best, head.stats.mean, head.stats.diversity);
+
+	for (r = 0; r < head.num_ranks; r++)
+	{
+		// a rank off the node of rank 0 never joins
+		if (0 != read_rank(&block->ranks[r], &slot) || !slot.live)
+			continue;
+
+		printf("          rank %d: utilization %.4f  %ld evals  %ld msgs  %ld bytes  at %.1fs\n",
+			r, slot.utilization, (long)slot.evals, (long)slot.msgs, (long)slot.bytes, slot.updated);
+	}
+
+	fflush(stdout);
+
+	return head.done;
+}
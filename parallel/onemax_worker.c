@@ -0,0 +1,75 @@
+/*=====================================================
+ * onemax_worker.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * An evaluator process for -X: it scores a genome by
+ * the # of 1's in its genes, as update_fitness() does,
+ * so a run with "-X ./onemax_worker" evolves the same
+ * way as one without. A real objective replaces
+ * score_batch(), e.g. to write the genomes to a
+ * simulator and read its scores back.
+ *
+ * An optional argument is a # of ms to sleep per batch,
+ * to try the timeouts of the rank.
+ *=====================================================*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "worker.h"
+
+
+#define CHAR_LENGTH 8		// # of bits of unsigned char
+
+
+/*========== Function Prototype ==========*/
+/*
+ * score n genomes by their # of 1's, after a sleep of
+ * *(long*)arg ms
+ */
+void score_batch(int num_genes, int n, const unsigned char* genes, double* fitness, void* arg);
+
+
+/*============== main() =================*/
+int main(int argc, char* argv[])
+{
+	long sleep_ms = argc > 1 ? atol(argv[1]) : 0;
+
+	return 0 == worker_serve(score_batch, &sleep_ms) ? 0 : 1;
+}
+
+
+/*========== Function Definition ==========*/
+/*
+ * score n genomes by their # of 1's, after a sleep of
+ * *(long*)arg ms
+ */
+void score_batch(int num_genes, int n, const unsigned char* genes, double* fitness, void* arg)
+{
+	long sleep_ms = *(long*)arg;
+	int i, j, bit;
+
+	if (sleep_ms > 0)
+	{
+		struct timespec ts = {sleep_ms / 1000, sleep_ms % 1000 * 1000000L};
+		nanosleep(&ts, NULL);
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		const unsigned char* chr = genes + (size_t)i * num_genes;
+		int ones = 0;
+
+		for (j = 0; j < num_genes; j++)
+		{
+			for (bit = 0; bit < CHAR_LENGTH; bit++)
+			{
+				ones += (chr[j] >> bit) & 1;
+			}
+		}
+
+		fitness[i] = ones;
+	}
+}
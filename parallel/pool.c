@@ -0,0 +1,298 @@
+/*=====================================================
+ * pool.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the pool.h header file.
+ *=====================================================*/
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include "pool.h"
+
+
+/*============ Type Definition ============*/
+/*
+ * pages to touch, only use this type inside this file
+ */
+typedef struct
+{
+	unsigned char* p;		// first page
+	size_t page;				// page size
+	size_t size;				// # of bytes
+}TouchRange;
+
+
+/*========== Function Definition ==========*/
+/*
+ * bind the calling thread to the id-th CPU of the rank's
+ * affinity mask, only use this function inside this file
+ */
+static void pin_thread(int id)
+{
+	cpu_set_t allowed;
+	int cpu, count = 0;
+
+	if (0 != sched_getaffinity(0, sizeof(allowed), &allowed))
+		return;
+
+	id %= CPU_COUNT(&allowed);
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (CPU_ISSET(cpu, &allowed) && count++ == id)
+		{
+			cpu_set_t one;
+			CPU_ZERO(&one);
+			CPU_SET(cpu, &one);
+			pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+			return;
+		}
+	}
+}
+
+
+/*
+ * loop body pinning thread i, which runs iteration i of
+ * a static loop of T iterations, only use this function
+ * inside this file
+ */
+static void pin_task(void* arg, int i)
+{
+	(void)arg;
+	pin_thread(i);
+}
+
+
+/*
+ * take iterations of the current loop until none is
+ * left, only use this function inside this file
+ */
+static void run_loop(Pool* pool, int id)
+{
+	if (pool->split)
+	{
+		int i;
+		int first = (int)((long)id * pool->n / pool->num_threads);
+		int last = (int)((long)(id + 1) * pool->n / pool->num_threads);
+
+		for (i = first; i < last; i++)
+		{
+			pool->task(pool->arg, i);
+		}
+		return;
+	}
+
+	while (1)
+	{
+		int i = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed);
+		if (i >= pool->n)
+			break;
+
+		pool->task(pool->arg, i);
+	}
+}
+
+
+/*
+ * body of the other threads, which wait for a loop,
+ * run it and report back, only use this function inside
+ * this file
+ */
+static void* worker_main(void* arg)
+{
+	PoolWorker* worker = (PoolWorker*)arg;
+	Pool* pool = worker->pool;
+	long seen = 0;
+
+	while (1)
+	{
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->stop && pool->round == seen)
+			pthread_cond_wait(&pool->start, &pool->lock);
+
+		if (pool->stop)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+
+		seen = pool->round;
+		pthread_mutex_unlock(&pool->lock);
+
+		run_loop(pool, worker->id);
+
+		pthread_mutex_lock(&pool->lock);
+		if (0 == --pool->num_busy)
+			pthread_cond_signal(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * start a pool of num_threads threads, the caller
+ * included; with 1 the loops run on the caller only.
+ * With pin set, thread t is bound to the t-th CPU this
+ * rank may run on, so its pages stay on its node
+ */
+Pool* init_pool(int num_threads, int pin)
+{
+	Pool* pool = (Pool*)malloc(sizeof(Pool));
+
+	pool->num_threads = num_threads;
+	pool->threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+	pool->workers = (PoolWorker*)malloc(num_threads * sizeof(PoolWorker));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->round = 0;
+	pool->num_busy = 0;
+	pool->stop = 0;
+	pool->task = NULL;
+	pool->arg = NULL;
+	pool->n = 0;
+	pool->split = 0;
+	atomic_init(&pool->next, 0);
+
+	int i;
+	for (i = 1; i < num_threads; i++)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].id = i;
+		pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]);
+	}
+
+	// a rank bound to a socket by the launcher spreads its
+	// threads over the cores of that socket
+	if (pin && num_threads > 1)
+	{
+		pool_for_static(pool, num_threads, pin_task, NULL);
+	}
+
+	return pool;
+}
+
+
+/*
+ * post a loop to all threads and run the caller's part,
+ * only use this function inside this file
+ */
+static void post_loop(Pool* pool, int n, PoolTask task, void* arg, int split)
+{
+	int i;
+
+	if (1 == pool->num_threads || n < 2)
+	{
+		for (i = 0; i < n; i++)
+		{
+			task(arg, i);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->n = n;
+	pool->split = split;
+	atomic_store_explicit(&pool->next, 0, memory_order_relaxed);
+	pool->num_busy = pool->num_threads - 1;
+	pool->round++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_loop(pool, 0);
+
+	// the loop is only over once every thread has left it
+	pthread_mutex_lock(&pool->lock);
+	while (pool->num_busy > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+/*
+ * run task(arg, i) for i in [0, n) on all threads of the
+ * pool and return when every iteration is done
+ */
+void pool_for(Pool* pool, int n, PoolTask task, void* arg)
+{
+	post_loop(pool, n, task, arg, 0);
+}
+
+
+/*
+ * as pool_for(), but thread t runs the iterations
+ * [t * n / T, (t + 1) * n / T) of the T threads
+ */
+void pool_for_static(Pool* pool, int n, PoolTask task, void* arg)
+{
+	post_loop(pool, n, task, arg, 1);
+}
+
+
+/*
+ * zero page i of the range, only use this function
+ * inside this file
+ */
+static void touch_task(void* arg, int i)
+{
+	TouchRange* range = (TouchRange*)arg;
+	size_t offset = (size_t)i * range->page;
+	size_t len = range->size - offset;
+
+	if (len > range->page)
+		len = range->page;
+
+	memset(range->p + offset, 0, len);
+}
+
+
+/*
+ * zero the pages of [p, p + size) split the same way
+ * as pool_for_static(), so each page is placed on the
+ * node of the thread that works on that part of an
+ * array; pool is the Pool, see set_first_touch()
+ */
+void pool_touch(void* pool, unsigned char* p, size_t size)
+{
+	TouchRange range;
+
+	range.p = p;
+	range.page = (size_t)sysconf(_SC_PAGESIZE);
+	range.size = size;
+
+	pool_for_static((Pool*)pool, (int)((size + range.page - 1) / range.page), touch_task, &range);
+}
+
+
+/*
+ * stop the threads and free memories
+ */
+void free_pool(Pool* pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	int i;
+	for (i = 1; i < pool->num_threads; i++)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	free(pool->threads);
+	free(pool->workers);
+	free(pool);
+}
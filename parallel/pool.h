@@ -0,0 +1,110 @@
+/*=====================================================
+ * pool.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares a small thread pool that
+ * runs the iterations of a loop on all threads of a
+ * rank, the calling thread included.
+ *
+ * Iterations are handed out one at a time from a shared
+ * counter, so threads that get cheap iterations simply
+ * take more of them. pool_for_static() instead gives
+ * thread t the same contiguous share of a loop every
+ * time, so the pages a thread first touched are the ones
+ * it works on later. The threads of the pool never call
+ * MPI, which is all that MPI_THREAD_FUNNELED allows.
+ *=====================================================*/
+
+
+#ifndef POOL_H_
+#define POOL_H_
+
+
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+
+/*============ Type Definition ============*/
+/*
+ * body of a loop, called once per iteration i
+ */
+typedef void (*PoolTask)(void* arg, int i);
+
+
+struct Pool;
+
+
+/*
+ * a thread of the pool and its index, 0 is the caller
+ */
+typedef struct
+{
+	struct Pool* pool;			// pool of the thread
+	int id;									// index of the thread
+}PoolWorker;
+
+
+/*
+ * state of the pool
+ */
+typedef struct Pool
+{
+	int num_threads;				// # of threads, the caller included
+	pthread_t* threads;			// the other threads
+	PoolWorker* workers;		// index of each thread
+	pthread_mutex_t lock;		// guards the fields below it
+	pthread_cond_t start;		// signalled when a loop is posted
+	pthread_cond_t done;		// signalled when a thread leaves a loop
+	long round;							// # of loops posted so far
+	int num_busy;						// # of other threads still in the loop
+	int stop;								// set when the pool is freed
+	PoolTask task;					// body of the current loop
+	void* arg;							// argument of the current loop
+	int n;									// # of iterations of the current loop
+	int split;							// the current loop is split statically
+	atomic_int next;				// next iteration to hand out
+}Pool;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * start a pool of num_threads threads, the caller
+ * included; with 1 the loops run on the caller only.
+ * With pin set, thread t is bound to the t-th CPU this
+ * rank may run on, so its pages stay on its node
+ */
+Pool* init_pool(int num_threads, int pin);
+
+
+/*
+ * run task(arg, i) for i in [0, n) on all threads of the
+ * pool and return when every iteration is done
+ */
+void pool_for(Pool* pool, int n, PoolTask task, void* arg);
+
+
+/*
+ * as pool_for(), but thread t runs the iterations
+ * [t * n / T, (t + 1) * n / T) of the T threads
+ */
+void pool_for_static(Pool* pool, int n, PoolTask task, void* arg);
+
+
+/*
+ * zero the pages of [p, p + size) split the same way
+ * as pool_for_static(), so each page is placed on the
+ * node of the thread that works on that part of an
+ * array; pool is the Pool, see set_first_touch()
+ */
+void pool_touch(void* pool, unsigned char* p, size_t size);
+
+
+/*
+ * stop the threads and free memories
+ */
+void free_pool(Pool* pool);
+
+
+#endif
@@ -0,0 +1,226 @@
+/*=====================================================
+ * prof.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the prof.h header file. It compiles to an empty
+ * object unless PGA_PROF is defined.
+ *=====================================================*/
+
+
+#include "prof.h"
+
+
+#ifdef PGA_PROF
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+
+#define PROF_MAX_EVENTS (1 << 20)	// # of trace events kept
+
+
+/*============ Type Definition ============*/
+/*
+ * one closed interval of a phase
+ */
+typedef struct
+{
+	int phase;					// phase of the interval
+	int64_t start;			// start time in ns since prof_init()
+	int64_t dur;				// length in ns
+}ProfEvent;
+
+
+/*========== Global Variable ==========*/
+static const char* phase_names[PROF_NUM_PHASES] =
+{
+	"select_parent", "crossover", "mutate", "update_fit_rate",
+	"update_fitness", "play_game", "mpi_send", "mpi_recv",
+	"worker_idle", "checkpoint"
+};
+
+static const char* counter_names[PROF_NUM_COUNTERS] =
+{
+	"evaluations", "cache_hits", "messages_sent", "bytes_sent",
+	"messages_recv", "bytes_recv"
+};
+
+static int prof_rank;											// process id in the trace
+static pthread_t prof_thread;							// the thread that is timed
+static int64_t prof_epoch;								// clock at prof_init()
+static int64_t open_at[PROF_NUM_PHASES];	// start of the open interval
+static int64_t total_ns[PROF_NUM_PHASES];	// time spent in each phase
+static long num_calls[PROF_NUM_PHASES];		// # of intervals of each phase
+static long counters[PROF_NUM_COUNTERS];	// event counters
+static ProfEvent* events;									// trace events
+static long num_events;										// # of trace events kept
+static long num_lost;											// # of trace events not kept
+
+
+/*========== Function Definition ==========*/
+/*
+ * read the monotonic clock in ns,
+ * only use this function inside this file
+ */
+static int64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/*
+ * reset all timers and counters and start the run
+ * clock, rank is written as the process id of the trace
+ */
+void prof_init(int rank)
+{
+	int i;
+	for (i = 0; i < PROF_NUM_PHASES; i++)
+	{
+		total_ns[i] = 0;
+		num_calls[i] = 0;
+	}
+
+	for (i = 0; i < PROF_NUM_COUNTERS; i++)
+	{
+		counters[i] = 0;
+	}
+
+	if (NULL == events)
+		events = (ProfEvent*)malloc(PROF_MAX_EVENTS * sizeof(ProfEvent));
+
+	prof_rank = rank;
+	prof_thread = pthread_self();
+	num_events = 0;
+	num_lost = 0;
+	prof_epoch = now_ns();
+}
+
+
+/*
+ * open an interval of a phase
+ */
+void prof_begin(int phase)
+{
+	if (!pthread_equal(pthread_self(), prof_thread))
+		return;
+
+	open_at[phase] = now_ns();
+}
+
+
+/*
+ * close the open interval of a phase
+ */
+void prof_end(int phase)
+{
+	if (!pthread_equal(pthread_self(), prof_thread))
+		return;
+
+	int64_t start = open_at[phase];
+	int64_t dur = now_ns() - start;
+
+	total_ns[phase] += dur;
+	num_calls[phase]++;
+
+	// keep the event for the trace while there is room
+	if (NULL != events && num_events < PROF_MAX_EVENTS)
+	{
+		events[num_events].phase = phase;
+		events[num_events].start = start - prof_epoch;
+		events[num_events].dur = dur;
+		num_events++;
+	}
+	else
+	{
+		num_lost++;
+	}
+}
+
+
+/*
+ * add n to an event counter
+ */
+void prof_count(int counter, long n)
+{
+	if (!pthread_equal(pthread_self(), prof_thread))
+		return;
+
+	counters[counter] += n;
+}
+
+
+/*
+ * write the summary and the trace of the run
+ */
+void prof_report(const char* prefix)
+{
+	char* path = (char*)malloc(strlen(prefix) + 16);
+	int64_t wall = now_ns() - prof_epoch;
+	int i;
+
+	/* summary of the run */
+	sprintf(path, "%s.json", prefix);
+	FILE* out = fopen(path, "w");
+	if (NULL == out)
+	{
+		perror(path);
+		free(path);
+		return;
+	}
+
+	fprintf(out, "{\n  \"rank\": %d,\n  \"wall_ns\": %lld,\n  \"phases\": {\n",
+		prof_rank, (long long)wall);
+	for (i = 0; i < PROF_NUM_PHASES; i++)
+	{
+		fprintf(out, "    \"%s\": {\"calls\": %ld, \"total_ns\": %lld, \"share\": %.6f}%s\n",
+			phase_names[i], num_calls[i], (long long)total_ns[i],
+			wall > 0 ? (double)total_ns[i] / wall : 0.0, i + 1 < PROF_NUM_PHASES ? "," : "");
+	}
+
+	fprintf(out, "  },\n  \"counters\": {\n");
+	for (i = 0; i < PROF_NUM_COUNTERS; i++)
+	{
+		fprintf(out, "    \"%s\": %ld%s\n", counter_names[i], counters[i],
+			i + 1 < PROF_NUM_COUNTERS ? "," : "");
+	}
+
+	fprintf(out, "  },\n  \"trace_events_lost\": %ld\n}\n", num_lost);
+	fclose(out);
+
+	/* Chrome trace events, times in microseconds */
+	sprintf(path, "%s.trace.json", prefix);
+	out = fopen(path, "w");
+	if (NULL == out)
+	{
+		perror(path);
+		free(path);
+		return;
+	}
+
+	fprintf(out, "{\"traceEvents\": [\n");
+	long k;
+	for (k = 0; k < num_events; k++)
+	{
+		fprintf(out, "{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": 0}%s\n",
+			phase_names[events[k].phase], events[k].start / 1000.0, events[k].dur / 1000.0,
+			prof_rank, k + 1 < num_events ? "," : "");
+	}
+	fprintf(out, "]}\n");
+	fclose(out);
+
+	free(path);
+}
+
+
+#endif
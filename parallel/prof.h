@@ -0,0 +1,116 @@
+/*=====================================================
+ * prof.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the hot-path
+ * instrumentation: monotonic-clock timers for each
+ * phase of a generation, and event counters.
+ *
+ * The instrumentation is only compiled in when
+ * PGA_PROF is defined ("make PROF=1"). Otherwise
+ * every PROF_* macro expands to nothing, so the
+ * calls can stay in the hot paths.
+ *
+ * At the end of a run PROF_REPORT(prefix) writes
+ * 1) <prefix>.json, a summary of the phases and
+ *    counters of the run
+ * 2) <prefix>.trace.json, every timed phase as a
+ *    Chrome trace event (chrome://tracing, Perfetto)
+ *
+ * The timers keep one open interval per phase, so a
+ * phase must not be nested inside itself. Only the
+ * thread that called PROF_INIT() is timed, calls from
+ * other threads are ignored, e.g. those of the pool
+ * (see pool.h) under MPI_THREAD_FUNNELED.
+ *=====================================================*/
+
+
+#ifndef PROF_H_
+#define PROF_H_
+
+
+/*
+ * phases of a generation
+ */
+#define PROF_SELECT 0				// select_parent()
+#define PROF_CROSSOVER 1		// crossover()
+#define PROF_MUTATE 2				// mutate()
+#define PROF_FIT_RATE 3			// update_fit_rate()
+#define PROF_FITNESS 4			// update_fitness() of one chromosome
+#define PROF_GAME 5					// play_game()
+#define PROF_SEND 6					// MPI send of a message
+#define PROF_RECV 7					// MPI receive of a result by the master
+#define PROF_IDLE 8					// worker waiting for a job
+#define PROF_CHECKPOINT 9		// save_checkpoint()
+#define PROF_NUM_PHASES 10
+
+
+/*
+ * event counters
+ */
+#define PROF_EVALS 0				// # of fitness evaluations or games
+#define PROF_CACHE_HITS 1		// # of fitness values reused without evaluation
+#define PROF_MSGS_SENT 2		// # of MPI messages sent
+#define PROF_BYTES_SENT 3		// # of bytes in MPI messages sent
+#define PROF_MSGS_RECV 4		// # of MPI messages received
+#define PROF_BYTES_RECV 5		// # of bytes in MPI messages received
+#define PROF_NUM_COUNTERS 6
+
+
+#ifdef PGA_PROF
+
+
+#define PROF_INIT(rank) prof_init(rank)
+#define PROF_BEGIN(phase) prof_begin(phase)
+#define PROF_END(phase) prof_end(phase)
+#define PROF_COUNT(counter, n) prof_count(counter, n)
+#define PROF_REPORT(prefix) prof_report(prefix)
+
+
+/*========== Function Prototype ==========*/
+/*
+ * reset all timers and counters and start the run
+ * clock, rank is written as the process id of the trace
+ */
+void prof_init(int rank);
+
+
+/*
+ * open an interval of a phase
+ */
+void prof_begin(int phase);
+
+
+/*
+ * close the open interval of a phase
+ */
+void prof_end(int phase);
+
+
+/*
+ * add n to an event counter
+ */
+void prof_count(int counter, long n);
+
+
+/*
+ * write the summary and the trace of the run
+ */
+void prof_report(const char* prefix);
+
+
+#else
+
+
+#define PROF_INIT(rank) ((void)0)
+#define PROF_BEGIN(phase) ((void)0)
+#define PROF_END(phase) ((void)0)
+#define PROF_COUNT(counter, n) ((void)0)
+#define PROF_REPORT(prefix) ((void)0)
+
+
+#endif
+
+
+#endif
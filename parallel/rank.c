@@ -0,0 +1,298 @@
+/*=====================================================
+ * rank.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the rank.h header file.
+ *=====================================================*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "rank.h"
+
+
+#define DIGIT(key, shift) ((int)(((key) >> (shift)) & (RADIX_SIZE - 1)))
+
+
+/*========== Function Definition ==========*/
+/*
+ * alloc buffers to rank n values on the threads of pool
+ */
+Ranker* init_ranker(int n, Pool* pool)
+{
+	Ranker* rk = (Ranker*)malloc(sizeof(Ranker));
+
+	rk->n = n;
+	rk->pool = pool;
+	rk->num_parts = pool->num_threads;
+	rk->fitness = (double*)malloc(n * sizeof(double));
+	rk->keys = (uint64_t*)malloc(n * sizeof(uint64_t));
+	rk->keys_tmp = (uint64_t*)malloc(n * sizeof(uint64_t));
+	rk->order = (int*)malloc(n * sizeof(int));
+	rk->order_tmp = (int*)malloc(n * sizeof(int));
+	rk->counts = (size_t*)malloc(rk->num_parts * RADIX_PASSES * RADIX_SIZE * sizeof(size_t));
+	rk->shift = 0;
+
+	return rk;
+}
+
+
+/*
+ * key of a fitness value: the bits of the double, with
+ * the sign bit flipped for positive values and all bits
+ * flipped for negative ones, so the keys compare as
+ * unsigned integers like the values, only use this
+ * function inside this file
+ */
+static uint64_t fitness_key(double fitness)
+{
+	uint64_t bits;
+	memcpy(&bits, &fitness, sizeof(bits));
+
+	return (bits >> 63) ? ~bits : bits | (1ULL << 63);
+}
+
+
+/*
+ * first index of a part, only use this function inside
+ * this file
+ */
+static int part_begin(const Ranker* rk, int part)
+{
+	return (int)((long)part * rk->n / rk->num_parts);
+}
+
+
+/*
+ * fill the keys and indices of a part and count the
+ * digits of every pass, only use this function inside
+ * this file
+ */
+static void key_part(void* arg, int part)
+{
+	Ranker* rk = (Ranker*)arg;
+	size_t* counts = rk->counts + (size_t)part * RADIX_PASSES * RADIX_SIZE;
+	int i, pass;
+
+	memset(counts, 0, RADIX_PASSES * RADIX_SIZE * sizeof(size_t));
+
+	for (i = part_begin(rk, part); i < part_begin(rk, part + 1); i++)
+	{
+		uint64_t key = fitness_key(rk->fitness[i]);
+
+		rk->keys[i] = key;
+		rk->order[i] = i;
+
+		for (pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			counts[pass * RADIX_SIZE + DIGIT(key, pass * RADIX_BITS)]++;
+		}
+	}
+}
+
+
+/*
+ * count the digits of the current pass in a part, only
+ * use this function inside this file
+ */
+static void count_part(void* arg, int part)
+{
+	Ranker* rk = (Ranker*)arg;
+	size_t* counts = rk->counts + (size_t)part * RADIX_SIZE;
+	int i;
+
+	memset(counts, 0, RADIX_SIZE * sizeof(size_t));
+
+	for (i = part_begin(rk, part); i < part_begin(rk, part + 1); i++)
+	{
+		counts[DIGIT(rk->keys[i], rk->shift)]++;
+	}
+}
+
+
+/*
+ * move the keys of a part to the offsets of their
+ * digits, in order, so the sort is stable, only use
+ * this function inside this file
+ */
+static void move_part(void* arg, int part)
+{
+	Ranker* rk = (Ranker*)arg;
+	size_t* offsets = rk->counts + (size_t)part * RADIX_SIZE;
+	int i;
+
+	for (i = part_begin(rk, part); i < part_begin(rk, part + 1); i++)
+	{
+		uint64_t key = rk->keys[i];
+		size_t dst = offsets[DIGIT(key, rk->shift)]++;
+
+		rk->keys_tmp[dst] = key;
+		rk->order_tmp[dst] = rk->order[i];
+	}
+}
+
+
+/*
+ * fill the keys and indices, and add up the digit
+ * counts of all parts, only use this function inside
+ * this file
+ */
+static void fill_keys(Ranker* rk)
+{
+	int part, pass, digit;
+
+	pool_for_static(rk->pool, rk->num_parts, key_part, rk);
+
+	memset(rk->totals, 0, sizeof(rk->totals));
+	for (part = 0; part < rk->num_parts; part++)
+	{
+		const size_t* counts = rk->counts + (size_t)part * RADIX_PASSES * RADIX_SIZE;
+
+		for (pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			for (digit = 0; digit < RADIX_SIZE; digit++)
+			{
+				rk->totals[pass][digit] += counts[pass * RADIX_SIZE + digit];
+			}
+		}
+	}
+}
+
+
+/*
+ * sort rk->fitness, afterwards rk->order holds the
+ * indices from the lowest to the highest fitness, ties
+ * in the order of their indices
+ */
+void sort_fitness(Ranker* rk)
+{
+	int pass, part, digit;
+
+	fill_keys(rk);
+
+	for (pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		const size_t* totals = rk->totals[pass];
+
+		// nothing moves if every key has the same digit
+		for (digit = 0; digit < RADIX_SIZE; digit++)
+		{
+			if (0 != totals[digit])
+				break;
+		}
+		if ((size_t)rk->n == totals[digit])
+			continue;
+
+		rk->shift = pass * RADIX_BITS;
+		pool_for_static(rk->pool, rk->num_parts, count_part, rk);
+
+		// digit by digit, part by part: where the first key
+		// of a part with that digit goes
+		size_t offset = 0;
+		for (digit = 0; digit < RADIX_SIZE; digit++)
+		{
+			for (part = 0; part < rk->num_parts; part++)
+			{
+				size_t* count = rk->counts + (size_t)part * RADIX_SIZE + digit;
+				size_t c = *count;
+
+				*count = offset;
+				offset += c;
+			}
+		}
+
+		pool_for_static(rk->pool, rk->num_parts, move_part, rk);
+
+		uint64_t* keys = rk->keys;
+		int* order = rk->order;
+		rk->keys = rk->keys_tmp;
+		rk->order = rk->order_tmp;
+		rk->keys_tmp = keys;
+		rk->order_tmp = order;
+	}
+}
+
+
+/*
+ * swap entries i and j of the keys and indices, only
+ * use this function inside this file
+ */
+static void swap_entries(Ranker* rk, int i, int j)
+{
+	uint64_t key = rk->keys[i];
+	int index = rk->order[i];
+
+	rk->keys[i] = rk->keys[j];
+	rk->order[i] = rk->order[j];
+	rk->keys[j] = key;
+	rk->order[j] = index;
+}
+
+
+/*
+ * afterwards the last m of rk->order are the indices of
+ * the m highest values of rk->fitness, in no order
+ */
+void select_top(Ranker* rk, int m)
+{
+	int lo = 0, hi = rk->n - 1;
+	int target = rk->n - m;		// first index of the top m
+
+	fill_keys(rk);
+
+	// quickselect: keep the part of [lo, hi] that holds
+	// target until it is a single entry
+	while (lo < hi)
+	{
+		// median of three as the pivot
+		int mid = lo + (hi - lo) / 2;
+		if (rk->keys[mid] < rk->keys[lo])
+			swap_entries(rk, mid, lo);
+		if (rk->keys[hi] < rk->keys[lo])
+			swap_entries(rk, hi, lo);
+		if (rk->keys[hi] < rk->keys[mid])
+			swap_entries(rk, hi, mid);
+
+		uint64_t pivot = rk->keys[mid];
+		int i = lo, j = hi;
+
+		// Hoare partition: [lo, j] <= pivot <= [i, hi]
+		while (i <= j)
+		{
+			while (rk->keys[i] < pivot)
+				i++;
+			while (rk->keys[j] > pivot)
+				j--;
+			if (i <= j)
+			{
+				swap_entries(rk, i, j);
+				i++;
+				j--;
+			}
+		}
+
+		if (target <= j)
+			hi = j;
+		else if (target >= i)
+			lo = i;
+		else
+			break;
+	}
+}
+
+
+/*
+ * free memories of the ranker
+ */
+void free_ranker(Ranker* rk)
+{
+	free(rk->fitness);
+	free(rk->keys);
+	free(rk->keys_tmp);
+	free(rk->order);
+	free(rk->order_tmp);
+	free(rk->counts);
+	free(rk);
+}
@@ -0,0 +1,88 @@
+/*=====================================================
+ * rank.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the ranking of a group by
+ * fitness, used by rank-based and truncation selection
+ * (see set_selection()).
+ *
+ * The fitness values are mapped to 64-bit keys that
+ * compare like the doubles (negative ones included), and
+ * then
+ * 1) sort_fitness() sorts them with an LSD radix sort of
+ *    8-bit digits: each pass counts the digits of every
+ *    part of the array, turns the counts into offsets
+ *    and moves the parts to their offsets, all parts at
+ *    the same time on the threads of the pool. A pass
+ *    whose digit is the same for all keys is skipped,
+ *    e.g. the low bytes of integer payoffs.
+ * 2) select_top() only moves the m highest to the end by
+ *    partial selection (quickselect).
+ * Both are O(n).
+ *=====================================================*/
+
+
+#ifndef RANK_H_
+#define RANK_H_
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pool.h"
+
+
+#define RADIX_BITS 8						// bits of a digit
+#define RADIX_SIZE 256					// # of values of a digit
+#define RADIX_PASSES 8					// # of digits of a key
+
+
+/*============ Type Definition ============*/
+/*
+ * buffers to rank n fitness values
+ */
+typedef struct
+{
+	int n;								// # of values
+	double* fitness;			// values to rank, filled by the caller
+	uint64_t* keys;				// keys in the current order
+	uint64_t* keys_tmp;		// keys moved by a pass
+	int* order;						// indices in the current order
+	int* order_tmp;				// indices moved by a pass
+	int num_parts;				// # of parts sorted at the same time
+	size_t* counts;				// digit counts, then offsets, of each part
+	size_t totals[RADIX_PASSES][RADIX_SIZE];	// counts of each digit of all keys
+	int shift;						// first bit of the digit of the current pass
+	Pool* pool;						// threads that sort the parts
+}Ranker;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * alloc buffers to rank n values on the threads of pool
+ */
+Ranker* init_ranker(int n, Pool* pool);
+
+
+/*
+ * sort rk->fitness, afterwards rk->order holds the
+ * indices from the lowest to the highest fitness, ties
+ * in the order of their indices
+ */
+void sort_fitness(Ranker* rk);
+
+
+/*
+ * afterwards the last m of rk->order are the indices of
+ * the m highest values of rk->fitness, in no order
+ */
+void select_top(Ranker* rk, int m);
+
+
+/*
+ * free memories of the ranker
+ */
+void free_ranker(Ranker* rk);
+
+
+#endif
@@ -0,0 +1,90 @@
+/*=====================================================
+ * reduce.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares exact sums of doubles, so a
+ * sum does not depend on the order of its terms: not on
+ * the order of a loop, the # of threads that share it
+ * or the # of ranks it is reduced over.
+ *
+ * Every finite double is an integer multiple of 2^-1074
+ * below 2^1024, so an accumulator keeps the sum as one
+ * fixed-point integer of 32-bit limbs from 2^-1074 up.
+ * A term is added to the 3 limbs it covers; the limbs
+ * are int64_t and only carried into each other every
+ * 2^30 terms (carry-save). Accumulators are merged by
+ * adding their limbs, and the sum is rounded to the
+ * nearest double once, at the end. Infinities and NaNs
+ * are summed apart and win over the finite part.
+ * exact_reduce() adds the accumulators of all ranks
+ * limb by limb as integers, so the sum of a reduction
+ * does not depend on the # of ranks either.
+ *=====================================================*/
+
+
+#ifndef REDUCE_H_
+#define REDUCE_H_
+
+
+#include <stdint.h>
+#include <mpi.h>
+
+
+#define EXACT_LIMBS 68				// 32-bit limbs of an accumulator
+#define EXACT_CARRY_EVERY (1 << 30)	// # of terms between carries
+
+
+/*============ Type Definition ============*/
+/*
+ * an exact sum of doubles
+ */
+typedef struct
+{
+	int64_t limbs[EXACT_LIMBS];		// limb i is worth 2^(32i - 1074)
+	int num_terms;								// # of terms since the last carry
+	double special;								// sum of infinities and NaNs, else 0
+}ExactSum;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * set the sum to 0
+ */
+void exact_zero(ExactSum* acc);
+
+
+/*
+ * add x to the sum
+ */
+void exact_add(ExactSum* acc, double x);
+
+
+/*
+ * add the sum other to the sum acc, e.g. the sums of
+ * the parts of an array
+ */
+void exact_merge(ExactSum* acc, const ExactSum* other);
+
+
+/*
+ * carry every limb into the next one, so all but the
+ * last limb are in [0, 2^32)
+ */
+void exact_carry(ExactSum* acc);
+
+
+/*
+ * the sum rounded to the nearest double
+ */
+double exact_value(const ExactSum* acc);
+
+
+/*
+ * add the sums acc of all ranks onto acc of root, all
+ * ranks must call it
+ */
+void exact_reduce(ExactSum* acc, int root);
+
+
+#endif
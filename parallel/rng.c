@@ -0,0 +1,97 @@
+/*=====================================================
+ * rng.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the rng.h header file.
+ *=====================================================*/
+
+
+#include "rng.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * rotate a 64-bit word left by k bits,
+ * only use this function inside this file
+ */
+static inline uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+
+/*
+ * splitmix64 step used to expand a seed into state
+ * words, only use this function inside this file
+ */
+static uint64_t splitmix64(uint64_t* x)
+{
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+
+/*
+ * seed the stream from a seed value and a stream id,
+ * different stream ids give independent sequences
+ */
+void rng_seed(Rng* rng, uint64_t seed, uint64_t stream)
+{
+	// mix the stream id into the seed so that streams
+	// with the same seed do not overlap
+	uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+
+	int i;
+	for (i = 0; i < 4; i++)
+	{
+		rng->s[i] = splitmix64(&x);
+	}
+}
+
+
+/*
+ * draw the next 64 random bits from the stream
+ */
+uint64_t rng_next(Rng* rng)
+{
+	uint64_t* s = rng->s;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return result;
+}
+
+
+/*
+ * draw a random double in the range [0, 1]
+ */
+double rng_uniform(Rng* rng)
+{
+	// use the top 53 bits as the mantissa
+	return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740991.0);
+}
+
+
+/*
+ * draw a random integer in the range [0, n)
+ */
+int rng_below(Rng* rng, int n)
+{
+	// multiply-shift maps 32 random bits onto [0, n)
+	uint64_t r = rng_next(rng) >> 32;
+
+	return (int)((r * (uint64_t)n) >> 32);
+}
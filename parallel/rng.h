@@ -0,0 +1,60 @@
+/*=====================================================
+ * rng.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file defines a small random number
+ * stream (xoshiro256**) whose whole state lives in
+ * a plain struct, so it can be saved to and restored
+ * from a checkpoint, and so independent streams can
+ * be handed to different groups or threads.
+ *
+ * It also declares function prototypes to seed the
+ * stream and to draw numbers from it.
+ *=====================================================*/
+
+
+#ifndef RNG_H_
+#define RNG_H_
+
+
+#include <stdint.h>
+
+
+/*============ Type Definition ============*/
+/*
+ * state of one random number stream
+ */
+typedef struct
+{
+	uint64_t s[4];			// xoshiro256** state words
+}Rng;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * seed the stream from a seed value and a stream id,
+ * different stream ids give independent sequences
+ */
+void rng_seed(Rng* rng, uint64_t seed, uint64_t stream);
+
+
+/*
+ * draw the next 64 random bits from the stream
+ */
+uint64_t rng_next(Rng* rng);
+
+
+/*
+ * draw a random double in the range [0, 1]
+ */
+double rng_uniform(Rng* rng);
+
+
+/*
+ * draw a random integer in the range [0, n)
+ */
+int rng_below(Rng* rng, int n);
+
+
+#endif
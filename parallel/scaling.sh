@@ -0,0 +1,49 @@
+#!/bin/sh
+#===========================================================
+# scaling.sh
+#
+# @Author: Wenchong Chen
+#
+# This script runs the Master-Slave program over 1..N local
+# MPI ranks (oversubscribed if needed) and collects one CSV
+# line per run:
+# 1) strong scaling, a fixed population for every N
+# 2) weak scaling, a fixed # of chromosomes per rank
+#
+# Usage: ./scaling.sh [max_ranks] [results.csv]
+# Settings come from the environment:
+#   POP       population of the strong runs, default 512
+#   PER_RANK  chromosomes per rank of the weak runs, default 64
+#   GENS      # of generations, default 50
+#   GENES     # of gene segments, default 16
+#   SPIN_NS   extra busy work per evaluation in ns, default 20000
+#   ARGS      extra flags of main, e.g. "-w 4 -x 8" for work stealing
+#   MPIRUN    MPI launcher, default "mpirun --oversubscribe"
+#===========================================================
+
+MAX_RANKS=${1:-4}
+OUT=${2:-scaling.csv}
+POP=${POP:-512}
+PER_RANK=${PER_RANK:-64}
+GENS=${GENS:-50}
+GENES=${GENES:-16}
+SPIN_NS=${SPIN_NS:-20000}
+
+if [ -z "$MPIRUN" ]; then
+	MPIRUN="mpirun --oversubscribe"
+	# Open MPI refuses to start as root unless told to
+	if [ "$(id -u)" = "0" ]; then
+		MPIRUN="$MPIRUN --allow-run-as-root"
+	fi
+fi
+
+echo "mode,ranks,num_chrs,num_genes,gens,spin_ns,wall_s,gens_per_s,evals_per_s,master_util,msgs,bytes" > "$OUT"
+
+N=1
+while [ "$N" -le "$MAX_RANKS" ]; do
+	$MPIRUN -np "$N" ./main -B strong -p "$POP" -s "$GENES" -g "$GENS" -e "$SPIN_NS" $ARGS >> "$OUT" || exit 1
+	$MPIRUN -np "$N" ./main -B weak -p $((PER_RANK * N)) -s "$GENES" -g "$GENS" -e "$SPIN_NS" $ARGS >> "$OUT" || exit 1
+	N=$((N + 1))
+done
+
+cat "$OUT"
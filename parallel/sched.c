@@ -0,0 +1,632 @@
+/*=====================================================
+ * sched.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the sched.h header file.
+ *=====================================================*/
+
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "sched.h"
+#include "prof.h"
+
+
+/*============ Type Definition ============*/
+/*
+ * arguments of eval_task()
+ */
+typedef struct
+{
+	int num_genes;					// # of gene segments
+	unsigned char* genes;		// genes of the batch, back to back
+	double* fitness;				// fitness of the batch
+	long spin_ns;						// extra busy work per evaluation
+	double spread;					// spread of the busy work
+}EvalBatch;
+
+
+/*========== Global Variable ==========*/
+static WorkerPool* workers = NULL;	// evaluate_batch() uses them, unless NULL
+static Telemetry* telemetry = NULL;	// publish_traffic() writes to it, unless NULL
+
+
+/*========== Function Definition ==========*/
+/*
+ * read the monotonic clock in seconds,
+ * only use this function inside this file
+ */
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*
+ * evaluate chromosome i of a batch, runs on the threads
+ * of a pool, only use this function inside this file
+ */
+static void eval_task(void* arg, int i)
+{
+	EvalBatch* b = (EvalBatch*)arg;
+
+	b->fitness[i] = evaluate(b->num_genes, b->genes + (size_t)i * b->num_genes,
+		b->spin_ns, b->spread);
+}
+
+
+/*
+ * send count chromosomes starting at first to a slave
+ * (0-based) without waiting, only use this function
+ * inside this file
+ */
+static void send_job(Master* m, Group* grp, int slave, int first, int count)
+{
+	int b = slave * m->depth + m->next_buf[slave];
+	unsigned char* buf = m->send_bufs + (size_t)b * m->job_size;
+	JobHead head = {first, count};
+	int local = NULL != m->shm && m->shm->local_ranks[slave + 1];
+	int size = sizeof(JobHead) + (local ? 0 : count * m->num_genes);
+
+	m->next_buf[slave] = (m->next_buf[slave] + 1) % m->depth;
+
+	// the buffer was handed to MPI depth jobs ago, make
+	// sure it has gone out before it is overwritten
+	MPI_Wait(&m->send_reqs[b], MPI_STATUS_IGNORE);
+
+	// the chromosomes of a batch lie back to back in the
+	// arena; a slave on this node reads them in place
+	memcpy(buf, &head, sizeof(JobHead));
+	if (local)
+		shm_sync(m->shm);
+	else
+		memcpy(buf + sizeof(JobHead), grp->chrs[first]->genes, count * m->num_genes);
+
+	PROF_BEGIN(PROF_SEND);
+	MPI_Isend(buf, size, MPI_BYTE, slave + 1, TAG_JOB, MPI_COMM_WORLD, &m->send_reqs[b]);
+	PROF_END(PROF_SEND);
+	PROF_COUNT(PROF_MSGS_SENT, 1);
+	PROF_COUNT(PROF_BYTES_SENT, size);
+
+	m->in_flight[slave]++;
+	m->num_pending++;
+	m->traffic.msgs++;
+	m->traffic.bytes += size;
+}
+
+
+/*
+ * hand ready chromosomes in batches to the least busy
+ * slaves until every slave has depth jobs outstanding,
+ * only use this function inside this file
+ */
+static void dispatch(Master* m, Group* grp)
+{
+	while (m->next_ready < m->num_ready)
+	{
+		int count = m->num_ready - m->next_ready;
+
+		// wait for a full batch unless the group is done
+		if (count < m->batch && m->num_ready < grp->num_chrs)
+			break;
+
+		if (count > m->batch)
+			count = m->batch;
+
+		int slave = -1;
+		int s;
+		for (s = 0; s < m->num_slaves; s++)
+		{
+			if (m->in_flight[s] < m->depth && (slave < 0 || m->in_flight[s] < m->in_flight[slave]))
+				slave = s;
+		}
+
+		// every slave is busy
+		if (slave < 0)
+			break;
+
+		send_job(m, grp, slave, m->next_ready, count);
+		m->next_ready += count;
+	}
+}
+
+
+/*
+ * store the results that a slave (0-based) sent and post
+ * the receive of its next results, only use this
+ * function inside this file
+ */
+static void take_result(Master* m, Group* grp, int slave)
+{
+	unsigned char* buf = m->results + (size_t)slave * m->result_size;
+	JobHead head;
+	double fitness;
+	int i;
+
+	int local = NULL != m->shm && m->shm->local_ranks[slave + 1];
+
+	memcpy(&head, buf, sizeof(JobHead));
+	if (local)
+		shm_sync(m->shm);
+
+	for (i = 0; i < head.count; i++)
+	{
+		// a slave on this node wrote the fitness in place
+		if (local)
+			fitness = m->shm->fitness[head.first + i];
+		else
+			memcpy(&fitness, buf + sizeof(JobHead) + i * sizeof(double), sizeof(double));
+
+		grp->chrs[head.first + i]->fitness = fitness;
+	}
+
+	int size = sizeof(JobHead) + (local ? 0 : head.count * sizeof(double));
+	m->in_flight[slave]--;
+	m->num_pending--;
+	m->traffic.msgs++;
+	m->traffic.bytes += size;
+	PROF_COUNT(PROF_MSGS_RECV, 1);
+	PROF_COUNT(PROF_BYTES_RECV, size);
+
+	MPI_Irecv(buf, m->result_size, MPI_BYTE, slave + 1, TAG_RESULT, MPI_COMM_WORLD,
+		&m->recv_reqs[slave]);
+}
+
+
+/*
+ * take every result that has arrived; if block is set,
+ * first wait until at least one has arrived, only use
+ * this function inside this file
+ */
+static void poll_results(Master* m, Group* grp, int block)
+{
+	int slave, flag;
+	MPI_Status stat;
+
+	if (block)
+	{
+		double wait_from = MPI_Wtime();
+		PROF_BEGIN(PROF_RECV);
+		MPI_Waitany(m->num_slaves, m->recv_reqs, &slave, &stat);
+		PROF_END(PROF_RECV);
+		m->traffic.wait += MPI_Wtime() - wait_from;
+
+		take_result(m, grp, slave);
+	}
+
+	while (1)
+	{
+		MPI_Testany(m->num_slaves, m->recv_reqs, &slave, &flag, &stat);
+		if (!flag || MPI_UNDEFINED == slave)
+			break;
+
+		take_result(m, grp, slave);
+	}
+}
+
+
+/*
+ * evaluate the whole group on the threads of the master,
+ * used when there are no slaves, only use this function
+ * inside this file
+ */
+static void evaluate_group(Master* m, Group* grp)
+{
+	int i;
+
+	// genes in a store are evaluated a block at a time,
+	// so the pages of one block are dropped as the next
+	// one is read ahead
+	int step = NULL != grp->store ? grp->store->block_chrs : grp->num_chrs;
+
+	m->fitness = (double*)realloc(m->fitness, grp->num_chrs * sizeof(double));
+
+	PROF_BEGIN(PROF_FITNESS);
+	for (i = 0; i < grp->num_chrs; i += step)
+	{
+		int count = i + step < grp->num_chrs ? step : grp->num_chrs - i;
+
+		if (NULL != grp->store)
+			store_stream(grp->store, grp->arena, i, grp->num_chrs);
+
+		evaluate_batch(m->pool, grp->num_genes, count, grp->arena + (size_t)i * grp->num_genes,
+			m->fitness + i, m->spin_ns, m->spread);
+	}
+	PROF_END(PROF_FITNESS);
+
+	for (i = 0; i < grp->num_chrs; i++)
+	{
+		grp->chrs[i]->fitness = m->fitness[i];
+	}
+
+	m->traffic.evals += grp->num_chrs;
+}
+
+
+/*
+ * allocate the master state and post one result receive
+ * per slave
+ */
+Master* init_master(int num_slaves, int depth, int batch, int num_genes, long spin_ns,
+	double spread, Pool* pool, ShmArena* shm)
+{
+	Master* m = (Master*)malloc(sizeof(Master));
+	int num_bufs = num_slaves * depth;
+
+	m->num_slaves = num_slaves;
+	m->depth = depth;
+	m->batch = batch;
+	m->num_genes = num_genes;
+	m->job_size = sizeof(JobHead) + batch * num_genes;
+	m->result_size = sizeof(JobHead) + batch * sizeof(double);
+	m->spin_ns = spin_ns;
+	m->spread = spread;
+	m->pool = pool;
+	m->shm = shm;
+	m->send_bufs = (unsigned char*)malloc((size_t)num_bufs * m->job_size + 1);
+	m->send_reqs = (MPI_Request*)malloc((num_bufs + 1) * sizeof(MPI_Request));
+	m->next_buf = (int*)calloc(num_slaves + 1, sizeof(int));
+	m->results = (unsigned char*)malloc((size_t)num_slaves * m->result_size + 1);
+	m->recv_reqs = (MPI_Request*)malloc((num_slaves + 1) * sizeof(MPI_Request));
+	m->in_flight = (int*)calloc(num_slaves + 1, sizeof(int));
+	m->fitness = NULL;
+	m->num_ready = 0;
+	m->next_ready = 0;
+	m->num_pending = 0;
+	memset(&m->traffic, 0, sizeof(Traffic));
+
+	int i;
+	for (i = 0; i < num_bufs; i++)
+	{
+		m->send_reqs[i] = MPI_REQUEST_NULL;
+	}
+
+	for (i = 0; i < num_slaves; i++)
+	{
+		MPI_Irecv(m->results + (size_t)i * m->result_size, m->result_size, MPI_BYTE, i + 1,
+			TAG_RESULT, MPI_COMM_WORLD, &m->recv_reqs[i]);
+	}
+
+	return m;
+}
+
+
+/*
+ * evaluate the fitness of every chromosome of the group
+ */
+void master_evaluate(Master* m, Group* grp)
+{
+	// without slaves the master does the work itself
+	if (0 == m->num_slaves)
+	{
+		evaluate_group(m, grp);
+		return;
+	}
+
+	m->num_ready = grp->num_chrs;
+	m->next_ready = 0;
+
+	dispatch(m, grp);
+	while (m->num_pending > 0 || m->next_ready < m->num_ready)
+	{
+		poll_results(m, grp, 1);
+		dispatch(m, grp);
+	}
+}
+
+
+/*
+ * select parents, then breed the group pair by pair and
+ * hand each bred batch out for evaluation right away;
+ * returns when the whole new generation is evaluated
+ */
+void master_breed_evaluate(Master* m, Group* grp)
+{
+	int i;
+
+	PROF_BEGIN(PROF_SELECT);
+	select_parent(grp);
+	PROF_END(PROF_SELECT);
+
+	m->num_ready = 0;
+	m->next_ready = 0;
+
+	for (i = 0; i < grp->num_chrs; i += 2)
+	{
+		PROF_BEGIN(PROF_CROSSOVER);
+		crossover_pair(grp, i);
+		PROF_END(PROF_CROSSOVER);
+
+		PROF_BEGIN(PROF_MUTATE);
+		mutate_chromo(grp, i);
+		mutate_chromo(grp, i + 1);
+		PROF_END(PROF_MUTATE);
+
+		if (0 == m->num_slaves)
+			continue;
+
+		// the pair is final, hand it out while the rest
+		// of the group is still being bred
+		m->num_ready = i + 2;
+
+		poll_results(m, grp, 0);
+		dispatch(m, grp);
+	}
+
+	// without slaves the master does the work itself
+	if (0 == m->num_slaves)
+		evaluate_group(m, grp);
+
+	while (m->num_pending > 0 || m->next_ready < m->num_ready)
+	{
+		poll_results(m, grp, 1);
+		dispatch(m, grp);
+	}
+
+	grp->generation++;
+}
+
+
+/*
+ * cancel the posted receives, tell every slave to stop,
+ * copy the traffic of the master out and free memories
+ */
+void free_master(Master* m, Traffic* traffic)
+{
+	int i;
+	for (i = 0; i < m->num_slaves; i++)
+	{
+		MPI_Cancel(&m->recv_reqs[i]);
+		MPI_Wait(&m->recv_reqs[i], MPI_STATUS_IGNORE);
+	}
+
+	MPI_Waitall(m->num_slaves * m->depth, m->send_reqs, MPI_STATUSES_IGNORE);
+
+	// no more jobs, tell every slave to stop
+	for (i = 0; i < m->num_slaves; i++)
+	{
+		MPI_Send(NULL, 0, MPI_BYTE, i + 1, TAG_STOP, MPI_COMM_WORLD);
+		m->traffic.msgs++;
+	}
+
+	*traffic = m->traffic;
+
+	free(m->send_bufs);
+	free(m->send_reqs);
+	free(m->next_buf);
+	free(m->results);
+	free(m->recv_reqs);
+	free(m->in_flight);
+	free(m->fitness);
+	free(m);
+}
+
+
+/*
+ * evaluate batches sent by the master on the threads of
+ * the pool until the master sends TAG_STOP
+ */
+void slave_loop(int num_genes, int batch, long spin_ns, double spread, Pool* pool,
+	ShmArena* shm, Traffic* traffic)
+{
+	int job_size = sizeof(JobHead) + batch * num_genes;
+	int result_size = sizeof(JobHead) + batch * sizeof(double);
+	unsigned char* bufs = (unsigned char*)malloc(2 * job_size);
+	unsigned char* results = (unsigned char*)malloc(2 * result_size);
+	MPI_Request recv_reqs[2];
+	MPI_Request send_reqs[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+	MPI_Status stat;
+	int cur = 0;
+	int local = NULL != shm && shm->local;
+
+	MPI_Irecv(bufs, job_size, MPI_BYTE, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &recv_reqs[0]);
+
+	while (1)
+	{
+		// get next job s
+		double wait_from = MPI_Wtime();
+		PROF_BEGIN(PROF_IDLE);
+		MPI_Wait(&recv_reqs[cur], &stat);
+		PROF_END(PROF_IDLE);
+		traffic->wait += MPI_Wtime() - wait_from;
+		traffic->msgs++;
+
+		// stop process if no job
+		if (TAG_STOP == stat.MPI_TAG)
+			break;
+
+		unsigned char* job = bufs + cur * job_size;
+		JobHead head;
+		memcpy(&head, job, sizeof(JobHead));
+
+		int size = sizeof(JobHead) + (local ? 0 : head.count * num_genes);
+		PROF_COUNT(PROF_MSGS_RECV, 1);
+		PROF_COUNT(PROF_BYTES_RECV, size);
+		traffic->bytes += size;
+
+		// let the next job arrive while this one is evaluated
+		MPI_Irecv(bufs + (1 - cur) * job_size, job_size, MPI_BYTE, 0, MPI_ANY_TAG,
+			MPI_COMM_WORLD, &recv_reqs[1 - cur]);
+
+		// do work
+		unsigned char* res = results + cur * result_size;
+		MPI_Wait(&send_reqs[cur], MPI_STATUS_IGNORE);
+		memcpy(res, &head, sizeof(JobHead));
+
+		// on the node of the master, work in the shared arena
+		unsigned char* genes = job + sizeof(JobHead);
+		double* fitness = (double*)(res + sizeof(JobHead));
+		if (local)
+		{
+			shm_sync(shm);
+			genes = shm->genes + (size_t)head.first * num_genes;
+			fitness = shm->fitness + head.first;
+		}
+
+		PROF_BEGIN(PROF_FITNESS);
+		evaluate_batch(pool, num_genes, head.count, genes, fitness, spin_ns, spread);
+		PROF_END(PROF_FITNESS);
+		PROF_COUNT(PROF_EVALS, head.count);
+		traffic->evals += head.count;
+
+		if (local)
+			shm_sync(shm);
+
+		// send result s, send fitness
+		size = sizeof(JobHead) + (local ? 0 : head.count * sizeof(double));
+		PROF_BEGIN(PROF_SEND);
+		MPI_Isend(res, size, MPI_BYTE, 0, TAG_RESULT, MPI_COMM_WORLD, &send_reqs[cur]);
+		PROF_END(PROF_SEND);
+		PROF_COUNT(PROF_MSGS_SENT, 1);
+		PROF_COUNT(PROF_BYTES_SENT, size);
+		traffic->msgs++;
+		traffic->bytes += size;
+		publish_traffic(traffic);
+
+		cur = 1 - cur;
+	}
+
+	MPI_Waitall(2, send_reqs, MPI_STATUSES_IGNORE);
+	free(bufs);
+	free(results);
+}
+
+
+/*
+ * evaluate_batch() hands its chromosomes to the worker
+ * processes of wp from now on, or to the threads of its
+ * pool again if wp is NULL
+ */
+void set_workers(WorkerPool* wp)
+{
+	workers = wp;
+}
+
+
+/*
+ * publish_traffic() writes to the slot of this rank in
+ * tm from now on, or nowhere if tm is NULL
+ */
+void set_telemetry(Telemetry* tm)
+{
+	telemetry = tm;
+}
+
+
+/*
+ * publish the traffic of this rank to the metrics
+ * segment (see set_telemetry()), if any
+ */
+void publish_traffic(const Traffic* traffic)
+{
+	if (NULL != telemetry)
+		publish_rank(telemetry, traffic->evals, traffic->msgs, traffic->bytes, traffic->wait);
+}
+
+
+/*
+ * evaluate n chromosomes, whose genes lie back to back,
+ * on the threads of the pool, or on the worker
+ * processes (see set_workers())
+ */
+void evaluate_batch(Pool* pool, int num_genes, int n, unsigned char* genes, double* fitness,
+	long spin_ns, double spread)
+{
+	EvalBatch b = {num_genes, genes, fitness, spin_ns, spread};
+
+	// the workers have an objective of their own, so no
+	// busy work is added
+	if (NULL != workers)
+	{
+		evaluate_workers(workers, n, genes, fitness);
+		return;
+	}
+
+	pool_for(pool, n, eval_task, &b);
+}
+
+
+/*
+ * gather the traffic of every rank on rank 0 and print
+ * one line of utilization per rank to stderr, all ranks
+ * must call it
+ */
+void report_traffic(const Traffic* traffic, double wall)
+{
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	// utilization is the share of the run not spent
+	// blocked waiting for work or for results
+	double mine[5] = {1.0 - traffic->wait / wall, (double)traffic->evals,
+		(double)traffic->steals, (double)traffic->msgs, (double)traffic->bytes};
+	double* all = NULL;
+
+	if (0 == rank)
+		all = (double*)malloc(5 * size * sizeof(double));
+
+	MPI_Gather(mine, 5, MPI_DOUBLE, all, 5, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+	if (0 == rank)
+	{
+		fprintf(stderr, "%5s %8s %10s %10s %10s %12s\n", "rank", "util", "evals",
+			"steals", "msgs", "bytes");
+
+		int r;
+		for (r = 0; r < size; r++)
+		{
+			double* t = all + 5 * r;
+			fprintf(stderr, "%5d %7.1f%% %10.0f %10.0f %10.0f %12.0f\n", r, 100.0 * t[0],
+				t[1], t[2], t[3], t[4]);
+		}
+
+		free(all);
+	}
+}
+
+
+/*
+ * fitness of one chromosome, plus busy work that stands
+ * in for an expensive objective: spin_ns * (1 + spread * u^3)
+ * where u in [0,1) is a hash of the genes, so most
+ * chromosomes are cheap, a few cost up to 1 + spread
+ * times more, and every rank agrees on the cost
+ */
+double evaluate(int num_genes, unsigned char* genes, long spin_ns, double spread)
+{
+	double fitness = update_fitness(num_genes, genes);
+
+	if (spin_ns > 0)
+	{
+		double cost = spin_ns * 1e-9;
+
+		if (spread > 0.0)
+		{
+			// FNV-1a hash of the genes
+			uint32_t h = 2166136261u;
+			int i;
+			for (i = 0; i < num_genes; i++)
+			{
+				h = (h ^ genes[i]) * 16777619u;
+			}
+
+			double u = h / 4294967296.0;
+			cost *= 1.0 + spread * u * u * u;
+		}
+
+		// runs on pool threads, which must not call MPI,
+		// so read the clock directly
+		double until = now_sec() + cost;
+		while (now_sec() < until)
+			;
+	}
+
+	return fitness;
+}
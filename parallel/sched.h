@@ -0,0 +1,196 @@
+/*=====================================================
+ * sched.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the Master-Slave protocol
+ * that evaluates the chromosomes of a group on the
+ * slave ranks.
+ *
+ * The master is event driven: it keeps up to `depth`
+ * jobs outstanding on every slave with MPI_Isend, has
+ * one MPI_Irecv posted per slave for results, and
+ * serves whichever slave answers first (MPI_Waitany),
+ * so a slow slave does not hold up the others.
+ *
+ * Breeding overlaps with evaluation: after selection,
+ * each pair of chromosomes is crossed over, mutated and
+ * handed out at once, so the slaves evaluate the first
+ * pairs of a generation while the master breeds the
+ * rest.
+ *
+ * A slave keeps a receive for its next job posted while
+ * it evaluates the current one.
+ *
+ * A job is a batch of consecutive chromosomes, as many
+ * as a rank has threads, so one message keeps every
+ * thread of the slave busy (hybrid MPI + threads, see
+ * pool.h); with evaluator processes (see worker.h) it
+ * is WORKER_BATCH per process, a full slot each.
+ *
+ * Slaves on the node of the master read the genes from
+ * and write the fitness to the node-shared arena (see
+ * shm.h), their messages carry only the JobHead.
+ *=====================================================*/
+
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+
+#include <mpi.h>
+#include "group.h"
+#include "pool.h"
+#include "shm.h"
+#include "worker.h"
+#include "telemetry.h"
+
+
+#define TAG_JOB 1		// message with the genes of a batch
+#define TAG_RESULT 2	// message with the fitness of a batch
+#define TAG_STOP 3		// message that tells a slave to stop
+
+
+/*============ Type Definition ============*/
+/*
+ * message traffic and waiting time of one rank,
+ * always counted because the scaling runs report it
+ */
+typedef struct
+{
+	long msgs;					// # of messages sent and received
+	long bytes;					// # of bytes sent and received
+	long evals;					// # of fitness evaluations
+	long steals;				// # of chromosomes taken from other ranks
+	double wait;				// seconds spent blocked in a receive
+}Traffic;
+
+
+/*
+ * head of job and result messages; a job goes on with
+ * the genes of the batch, a result with its fitness
+ */
+typedef struct
+{
+	int first;					// index of the first chromosome
+	int count;					// # of chromosomes of the batch
+}JobHead;
+
+
+/*
+ * state of the master side of the protocol
+ */
+typedef struct
+{
+	int num_slaves;					// # of slaves
+	int depth;							// max # of jobs outstanding per slave
+	int batch;							// max # of chromosomes per job
+	int num_genes;					// # of gene segments
+	int job_size;						// max bytes of one job message
+	int result_size;				// max bytes of one result message
+	long spin_ns;						// extra busy work per evaluation
+	double spread;					// spread of the busy work, see evaluate()
+	Pool* pool;							// threads of the master
+	ShmArena* shm;					// node-shared arena, NULL if not used
+	unsigned char* send_bufs;	// depth job buffers per slave
+	MPI_Request* send_reqs;	// request of each job buffer
+	int* next_buf;					// next job buffer of each slave
+	unsigned char* results;	// result buffer of each slave
+	MPI_Request* recv_reqs;	// posted result receive of each slave
+	int* in_flight;					// # of jobs outstanding per slave
+	double* fitness;				// fitness evaluated by the master itself
+	int num_ready;					// # of chromosomes ready to be sent
+	int next_ready;					// next chromosome to send
+	int num_pending;				// # of jobs sent but not answered
+	Traffic traffic;				// traffic of the master
+}Master;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * allocate the master state and post one result receive
+ * per slave
+ */
+Master* init_master(int num_slaves, int depth, int batch, int num_genes, long spin_ns,
+	double spread, Pool* pool, ShmArena* shm);
+
+
+/*
+ * evaluate the fitness of every chromosome of the group
+ */
+void master_evaluate(Master* m, Group* grp);
+
+
+/*
+ * select parents, then breed the group pair by pair and
+ * hand each bred pair out for evaluation right away;
+ * returns when the whole new generation is evaluated
+ */
+void master_breed_evaluate(Master* m, Group* grp);
+
+
+/*
+ * cancel the posted receives, tell every slave to stop,
+ * copy the traffic of the master out and free memories
+ */
+void free_master(Master* m, Traffic* traffic);
+
+
+/*
+ * evaluate batches sent by the master on the threads of
+ * the pool until the master sends TAG_STOP
+ */
+void slave_loop(int num_genes, int batch, long spin_ns, double spread, Pool* pool,
+	ShmArena* shm, Traffic* traffic);
+
+
+/*
+ * gather the traffic of every rank on rank 0 and print
+ * one line of utilization per rank to stderr, all ranks
+ * must call it
+ */
+void report_traffic(const Traffic* traffic, double wall);
+
+
+/*
+ * evaluate_batch() hands its chromosomes to the worker
+ * processes of wp from now on, or to the threads of its
+ * pool again if wp is NULL
+ */
+void set_workers(WorkerPool* wp);
+
+
+/*
+ * publish_traffic() writes to the slot of this rank in
+ * tm from now on, or nowhere if tm is NULL
+ */
+void set_telemetry(Telemetry* tm);
+
+
+/*
+ * publish the traffic of this rank to the metrics
+ * segment (see set_telemetry()), if any
+ */
+void publish_traffic(const Traffic* traffic);
+
+
+/*
+ * evaluate n chromosomes, whose genes lie back to back,
+ * on the threads of the pool, or on the worker
+ * processes (see set_workers())
+ */
+void evaluate_batch(Pool* pool, int num_genes, int n, unsigned char* genes, double* fitness,
+	long spin_ns, double spread);
+
+
+/*
+ * fitness of one chromosome, plus busy work that stands
+ * in for an expensive objective: spin_ns * (1 + spread * u^3)
+ * where u in [0,1) is a hash of the genes, so most
+ * chromosomes are cheap, a few cost up to 1 + spread
+ * times more, and every rank agrees on the cost
+ */
+double evaluate(int num_genes, unsigned char* genes, long spin_ns, double spread);
+
+
+#endif
@@ -0,0 +1,90 @@
+/*=====================================================
+ * shm.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the shm.h header file.
+ *=====================================================*/
+
+
+#include <stdlib.h>
+#include "shm.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * allocate the shared window of every node, the one of
+ * the master's node holds num_chrs chromosomes; all
+ * ranks must call it
+ */
+ShmArena* init_shm_arena(int num_chrs, int num_genes)
+{
+	ShmArena* shm = (ShmArena*)malloc(sizeof(ShmArena));
+	int rank, size;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	// keyed by world rank, so the master is rank 0 of its node
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &shm->node);
+
+	int root = rank;
+	MPI_Bcast(&root, 1, MPI_INT, 0, shm->node);
+	shm->local = (0 == root);
+	MPI_Allreduce(&shm->local, &shm->all_local, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+	shm->local_ranks = NULL;
+	if (0 == rank)
+		shm->local_ranks = (int*)malloc(size * sizeof(int));
+	MPI_Gather(&shm->local, 1, MPI_INT, shm->local_ranks, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	// genes first, the fitness values 8-byte aligned after them
+	MPI_Aint genes_size = ((MPI_Aint)num_chrs * num_genes + 7) / 8 * 8;
+	MPI_Aint win_size = 0;
+	if (0 == rank)
+		win_size = genes_size + (MPI_Aint)num_chrs * sizeof(double);
+
+	unsigned char* base;
+	MPI_Win_allocate_shared(win_size, 1, MPI_INFO_NULL, shm->node, &base, &shm->win);
+
+	// every rank of a node sees the segment of its node rank 0
+	int disp_unit;
+	MPI_Win_shared_query(shm->win, 0, &win_size, &disp_unit, &base);
+
+	shm->genes = NULL;
+	shm->fitness = NULL;
+	if (shm->local)
+	{
+		shm->genes = base;
+		shm->fitness = (double*)(base + genes_size);
+	}
+
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, shm->win);
+
+	return shm;
+}
+
+
+/*
+ * make the writes of this rank to the window visible
+ * and the writes of other ranks readable
+ */
+void shm_sync(ShmArena* shm)
+{
+	MPI_Win_sync(shm->win);
+}
+
+
+/*
+ * free the windows and memories, all ranks must call it
+ */
+void free_shm_arena(ShmArena* shm)
+{
+	MPI_Win_unlock_all(shm->win);
+	MPI_Win_free(&shm->win);
+	MPI_Comm_free(&shm->node);
+
+	free(shm->local_ranks);
+	free(shm);
+}
@@ -0,0 +1,68 @@
+/*=====================================================
+ * shm.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the node-shared arena: the
+ * genes and the fitness values of the group live in an
+ * MPI-3 shared-memory window (MPI_Win_allocate_shared)
+ * on the node of the master.
+ *
+ * Ranks on that node read the genes and write the
+ * fitness values in place, so their messages shrink to
+ * a JobHead that says which batch to evaluate or which
+ * one is done. Ranks on other nodes still get the genes
+ * in their messages.
+ *
+ * Accesses are ordered by the messages: the writer
+ * calls shm_sync() before it sends, the reader calls
+ * shm_sync() after it receives.
+ *=====================================================*/
+
+
+#ifndef SHM_H_
+#define SHM_H_
+
+
+#include <mpi.h>
+
+
+/*============ Type Definition ============*/
+/*
+ * state of the node-shared arena on one rank
+ */
+typedef struct
+{
+	MPI_Comm node;					// ranks on the node of this rank
+	MPI_Win win;						// shared window of the node
+	int local;							// this rank is on the node of the master
+	int all_local;					// every rank is on the node of the master
+	int* local_ranks;				// local flag of every rank, master only
+	unsigned char* genes;		// genes of the group, on the master's node
+	double* fitness;				// fitness of the group, on the master's node
+}ShmArena;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * allocate the shared window of every node, the one of
+ * the master's node holds num_chrs chromosomes; all
+ * ranks must call it
+ */
+ShmArena* init_shm_arena(int num_chrs, int num_genes);
+
+
+/*
+ * make the writes of this rank to the window visible
+ * and the writes of other ranks readable
+ */
+void shm_sync(ShmArena* shm);
+
+
+/*
+ * free the windows and memories, all ranks must call it
+ */
+void free_shm_arena(ShmArena* shm);
+
+
+#endif
@@ -0,0 +1,161 @@
+/*=====================================================
+ * stats.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the stats.h header file.
+ *=====================================================*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * write one record in the format of the sink,
+ * only use this function inside this file
+ */
+static void write_record(StatsSink* sink, const GenStats* rec)
+{
+	if (STATS_CSV == sink->format)
+	{
+		fprintf(sink->out, "%d,%d,%.17g,%.17g,%.17g,%.17g\n", rec->generation,
+			rec->num_chrs, rec->best, rec->mean, rec->variance, rec->diversity);
+	}
+	else
+	{
+		fwrite(rec, sizeof(GenStats), 1, sink->out);
+	}
+}
+
+
+/*
+ * body of the writer thread, which drains the ring
+ * and sleeps for a while when it is empty,
+ * only use this function inside this file
+ */
+static void* writer_main(void* arg)
+{
+	StatsSink* sink = (StatsSink*)arg;
+	struct timespec nap = {0, 1000000};
+
+	while (1)
+	{
+		// read stop before head, so that records pushed
+		// before stop was set are still drained
+		int stop = atomic_load_explicit(&sink->stop, memory_order_acquire);
+		uint64_t head = atomic_load_explicit(&sink->head, memory_order_acquire);
+		uint64_t tail = atomic_load_explicit(&sink->tail, memory_order_relaxed);
+
+		if (tail == head)
+		{
+			if (stop)
+				break;
+
+			fflush(sink->out);
+			nanosleep(&nap, NULL);
+			continue;
+		}
+
+		while (tail != head)
+		{
+			write_record(sink, &sink->ring[tail & (STATS_RING_SIZE - 1)]);
+			tail++;
+		}
+
+		// hand the slots back to the producer
+		atomic_store_explicit(&sink->tail, tail, memory_order_release);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * open the output file and start the background writer,
+ * return NULL if the file cannot be opened
+ */
+StatsSink* init_stats_sink(const char* path, int format)
+{
+	FILE* out = fopen(path, STATS_CSV == format ? "w" : "wb");
+	if (NULL == out)
+	{
+		perror(path);
+		return NULL;
+	}
+
+	StatsSink* sink = (StatsSink*)malloc(sizeof(StatsSink));
+
+	atomic_init(&sink->head, 0);
+	atomic_init(&sink->tail, 0);
+	atomic_init(&sink->stop, 0);
+	sink->num_dropped = 0;
+	sink->format = format;
+	sink->out = out;
+
+	if (STATS_CSV == format)
+	{
+		fprintf(out, "generation,num_chrs,best,mean,variance,diversity\n");
+	}
+	else
+	{
+		// magic, version and record size, then raw records
+		char magic[8] = STATS_MAGIC;
+		uint32_t version = STATS_VERSION;
+		uint32_t rec_size = sizeof(GenStats);
+
+		fwrite(magic, sizeof(magic), 1, out);
+		fwrite(&version, sizeof(version), 1, out);
+		fwrite(&rec_size, sizeof(rec_size), 1, out);
+	}
+
+	pthread_create(&sink->thread, NULL, writer_main, sink);
+
+	return sink;
+}
+
+
+/*
+ * push a record into the ring without blocking,
+ * return 0 if pushed and 1 if dropped
+ */
+int push_stats(StatsSink* sink, const GenStats* rec)
+{
+	uint64_t head = atomic_load_explicit(&sink->head, memory_order_relaxed);
+	uint64_t tail = atomic_load_explicit(&sink->tail, memory_order_acquire);
+
+	// the writer is a whole ring behind, drop the record
+	if (head - tail >= STATS_RING_SIZE)
+	{
+		sink->num_dropped++;
+		return 1;
+	}
+
+	sink->ring[head & (STATS_RING_SIZE - 1)] = *rec;
+
+	// publish the slot to the writer
+	atomic_store_explicit(&sink->head, head + 1, memory_order_release);
+
+	return 0;
+}
+
+
+/*
+ * drain the ring, stop the writer, close the output
+ * file and free memories
+ */
+void free_stats_sink(StatsSink* sink)
+{
+	atomic_store_explicit(&sink->stop, 1, memory_order_release);
+	pthread_join(sink->thread, NULL);
+
+	if (sink->num_dropped > 0)
+		fprintf(stderr, "stats: %ld records dropped\n", sink->num_dropped);
+
+	fclose(sink->out);
+	free(sink);
+}
@@ -0,0 +1,386 @@
+/*=====================================================
+ * steal.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the steal.h header file.
+ *=====================================================*/
+
+
+#include <string.h>
+#include "steal.h"
+#include "prof.h"
+
+
+#define GO_STOP 0			// the master is done
+#define GO_GENES 1		// the genes of the group follow
+#define GO_SCRIPT 2		// the edit script of a generation follows
+
+
+#define QUEUE(next, end) (((int64_t)(next) << 32) | (int64_t)(end))
+#define NEXT(word) ((int)((word) >> 32))
+#define END(word) ((int)((word) & 0xffffffff))
+
+
+/*========== Function Definition ==========*/
+/*
+ * apply op with value to the queue word of a rank
+ * atomically and return the word it held before,
+ * only use this function inside this file
+ */
+static int64_t update_queue(Stealer* st, int target, int64_t value, MPI_Op op)
+{
+	int64_t word;
+
+	MPI_Fetch_and_op(&value, &word, MPI_INT64_T, target, 0, op, st->win);
+	MPI_Win_flush(target, st->win);
+	st->traffic.msgs++;
+	st->traffic.bytes += sizeof(int64_t);
+
+	return word;
+}
+
+
+/*
+ * claim up to n chunks at the front of a rank's queue;
+ * returns the first claimed chunk and sets last, or
+ * returns -1 if the queue was empty, only use this
+ * function inside this file
+ */
+static int claim_chunks(Stealer* st, int target, int n, int* last)
+{
+	int64_t word = update_queue(st, target, QUEUE(n, 0), MPI_SUM);
+
+	if (NEXT(word) >= END(word))
+		return -1;
+
+	*last = NEXT(word) + n < END(word) ? NEXT(word) + n : END(word);
+
+	return NEXT(word);
+}
+
+
+/*
+ * move half of the chunks left in another rank's queue
+ * to the own (empty) queue; returns 0 once every other
+ * queue was seen empty, only use this function inside
+ * this file
+ */
+static int steal_chunks(Stealer* st)
+{
+	int first = rng_below(&st->rng, st->size);
+	int k;
+
+	for (k = 0; k < st->size; k++)
+	{
+		int victim = (first + k) % st->size;
+		if (victim == st->rank)
+			continue;
+
+		// look first, so that empty queues are not
+		// pushed further past their end
+		int64_t word = update_queue(st, victim, 0, MPI_NO_OP);
+		if (NEXT(word) >= END(word))
+			continue;
+
+		int last;
+		int from = claim_chunks(st, victim, (END(word) - NEXT(word) + 1) / 2, &last);
+		if (from < 0)
+			continue;
+
+		// the own queue is empty, a thief that adds to it
+		// before this store claims nothing
+		update_queue(st, st->rank, QUEUE(from, last), MPI_REPLACE);
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * evaluate the chunks of the own queue, then steal until
+ * no rank has chunks left, only use this function inside
+ * this file
+ */
+static void run_chunks(Stealer* st, Group* grp)
+{
+	int per_rank = st->num_chunks / st->size;
+	int extra = st->num_chunks % st->size;
+	int next = st->rank * per_rank + (st->rank < extra ? st->rank : extra);
+	int end = next + per_rank + (st->rank < extra ? 1 : 0);
+	int own = 1;
+	unsigned char* genes = grp->arena;
+	double* fitness = st->fitness;
+
+	if (NULL != st->shm)
+	{
+		genes = st->shm->genes;
+		fitness = st->shm->fitness;
+	}
+	else
+	{
+		memset(st->fitness, 0, grp->num_chrs * sizeof(double));
+	}
+
+	update_queue(st, st->rank, QUEUE(next, end), MPI_REPLACE);
+
+	while (1)
+	{
+		int last;
+		int c = claim_chunks(st, st->rank, 1, &last);
+		if (c < 0)
+		{
+			double wait_from = MPI_Wtime();
+			PROF_BEGIN(PROF_IDLE);
+			int found = steal_chunks(st);
+			PROF_END(PROF_IDLE);
+			st->traffic.wait += MPI_Wtime() - wait_from;
+
+			if (!found)
+				break;
+
+			own = 0;
+			continue;
+		}
+
+		int lo = c * st->chunk;
+		int hi = lo + st->chunk < grp->num_chrs ? lo + st->chunk : grp->num_chrs;
+
+		PROF_BEGIN(PROF_FITNESS);
+		evaluate_batch(st->pool, grp->num_genes, hi - lo, genes + (size_t)lo * grp->num_genes,
+			fitness + lo, st->spin_ns, st->spread);
+		PROF_END(PROF_FITNESS);
+
+		PROF_COUNT(PROF_EVALS, hi - lo);
+		st->traffic.evals += hi - lo;
+		if (!own)
+			st->traffic.steals += hi - lo;
+	}
+}
+
+
+/*
+ * create the scheduler, all ranks must call it
+ */
+Stealer* init_stealer(int num_chrs, int chunk, long spin_ns, double spread, Pool* pool,
+	ShmArena* shm, int delta)
+{
+	Stealer* st = (Stealer*)malloc(sizeof(Stealer));
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &st->rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &st->size);
+	st->chunk = chunk;
+	st->num_chunks = (num_chrs + chunk - 1) / chunk;
+	st->spin_ns = spin_ns;
+	st->spread = spread;
+	st->pool = pool;
+
+	// the arena is only of use if every rank can reach it
+	st->shm = NULL != shm && shm->all_local ? shm : NULL;
+	st->delta = delta && NULL == st->shm;
+	st->synced = 0;
+	st->script = st->delta ? init_script(num_chrs) : NULL;
+	st->delta_buf = NULL;
+	st->delta_cap = 0;
+	st->fitness = (double*)malloc(num_chrs * sizeof(double));
+	st->total = (double*)malloc(num_chrs * sizeof(double));
+	rng_seed(&st->rng, (uint64_t)rand(), (uint64_t)st->rank);
+	memset(&st->traffic, 0, sizeof(Traffic));
+
+	MPI_Win_allocate(sizeof(int64_t), sizeof(int64_t), MPI_INFO_NULL, MPI_COMM_WORLD,
+		&st->queue, &st->win);
+	*st->queue = QUEUE(0, 0);
+
+	// every queue is empty before any rank looks at it
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, st->win);
+
+	return st;
+}
+
+
+/*
+ * evaluate the fitness of every chromosome of the group
+ * together with the other ranks, master only
+ */
+void steal_evaluate(Stealer* st, Group* grp)
+{
+	int go = GO_GENES;
+	int size = grp->num_chrs * grp->num_genes;
+	int i;
+
+	// from now on record the changes of every generation
+	if (st->delta && NULL == grp->script)
+		grp->script = init_script(grp->num_chrs);
+
+	// the script replaces the genes once the replicas
+	// are in step and it is the smaller of the two
+	int script_size = 0;
+	if (st->delta && st->synced)
+	{
+		grp->script->checksum = genes_checksum(grp->arena, size);
+		script_size = pack_script(grp->script, &st->delta_buf, &st->delta_cap);
+		if (script_size < size)
+			go = GO_SCRIPT;
+	}
+
+	PROF_BEGIN(PROF_SEND);
+	if (NULL != st->shm)
+		shm_sync(st->shm);
+	MPI_Bcast(&go, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	st->traffic.msgs += st->size - 1;
+	st->traffic.bytes += (long)sizeof(int) * (st->size - 1);
+
+	if (GO_SCRIPT == go)
+	{
+		MPI_Bcast(&script_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		MPI_Bcast(st->delta_buf, script_size, MPI_BYTE, 0, MPI_COMM_WORLD);
+		st->traffic.msgs += 2 * (st->size - 1);
+		st->traffic.bytes += (long)(sizeof(int) + script_size) * (st->size - 1);
+	}
+	else if (NULL == st->shm)
+	{
+		MPI_Bcast(grp->arena, size, MPI_BYTE, 0, MPI_COMM_WORLD);
+		st->traffic.msgs += st->size - 1;
+		st->traffic.bytes += (long)size * (st->size - 1);
+	}
+	PROF_END(PROF_SEND);
+	st->synced = 1;
+
+	run_chunks(st, grp);
+
+	double wait_from = MPI_Wtime();
+	PROF_BEGIN(PROF_RECV);
+	if (NULL != st->shm)
+	{
+		// every rank wrote its fitness values in place
+		MPI_Barrier(MPI_COMM_WORLD);
+		shm_sync(st->shm);
+		memcpy(st->total, st->shm->fitness, grp->num_chrs * sizeof(double));
+	}
+	else
+	{
+		// one rank evaluated each chromosome and the others
+		// hold 0, so this sum is exact in any order
+		MPI_Reduce(st->fitness, st->total, grp->num_chrs, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+		st->traffic.msgs += st->size - 1;
+		st->traffic.bytes += (long)grp->num_chrs * sizeof(double) * (st->size - 1);
+	}
+	PROF_END(PROF_RECV);
+	st->traffic.wait += MPI_Wtime() - wait_from;
+
+	for (i = 0; i < grp->num_chrs; i++)
+	{
+		grp->chrs[i]->fitness = st->total[i];
+	}
+}
+
+
+/*
+ * take part in steal_evaluate() of the master until the
+ * master calls free_stealer(), ranks other than the
+ * master only
+ */
+void steal_loop(Stealer* st, Group* grp)
+{
+	int size = grp->num_chrs * grp->num_genes;
+
+	while (1)
+	{
+		int go;
+
+		// the master breeds the next generation meanwhile
+		double wait_from = MPI_Wtime();
+		PROF_BEGIN(PROF_IDLE);
+		MPI_Bcast(&go, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		PROF_END(PROF_IDLE);
+		st->traffic.wait += MPI_Wtime() - wait_from;
+		st->traffic.msgs++;
+		st->traffic.bytes += sizeof(int);
+
+		if (GO_STOP == go)
+			break;
+
+		if (NULL != st->shm)
+		{
+			shm_sync(st->shm);
+		}
+		else if (GO_SCRIPT == go)
+		{
+			int script_size;
+			MPI_Bcast(&script_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			if (script_size > st->delta_cap)
+			{
+				st->delta_cap = script_size;
+				st->delta_buf = (unsigned char*)realloc(st->delta_buf, script_size);
+			}
+			MPI_Bcast(st->delta_buf, script_size, MPI_BYTE, 0, MPI_COMM_WORLD);
+			st->traffic.msgs += 2;
+			st->traffic.bytes += sizeof(int) + script_size;
+
+			// bring the replica up to the generation of the master
+			unpack_script(st->script, st->delta_buf);
+			replay_script(grp, st->script);
+			PROF_COUNT(PROF_CACHE_HITS, grp->num_chrs);
+
+			if (genes_checksum(grp->arena, size) != st->script->checksum)
+			{
+				fprintf(stderr, "rank %d: replica out of step with the master\n", st->rank);
+				MPI_Abort(MPI_COMM_WORLD, 4);
+			}
+		}
+		else
+		{
+			MPI_Bcast(grp->arena, size, MPI_BYTE, 0, MPI_COMM_WORLD);
+			st->traffic.msgs++;
+			st->traffic.bytes += size;
+		}
+
+		run_chunks(st, grp);
+
+		if (NULL != st->shm)
+		{
+			shm_sync(st->shm);
+			MPI_Barrier(MPI_COMM_WORLD);
+		}
+		else
+		{
+			MPI_Reduce(st->fitness, NULL, grp->num_chrs, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+			st->traffic.msgs++;
+			st->traffic.bytes += grp->num_chrs * sizeof(double);
+		}
+
+		publish_traffic(&st->traffic);
+	}
+}
+
+
+/*
+ * tell the other ranks to leave steal_loop() (master
+ * only), copy the traffic out and free memories, all
+ * ranks must call it
+ */
+void free_stealer(Stealer* st, Traffic* traffic)
+{
+	if (0 == st->rank)
+	{
+		int go = GO_STOP;
+		MPI_Bcast(&go, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		st->traffic.msgs += st->size - 1;
+	}
+
+	MPI_Win_unlock_all(st->win);
+	MPI_Win_free(&st->win);
+
+	*traffic = st->traffic;
+
+	if (NULL != st->script)
+		free_script(st->script);
+
+	free(st->delta_buf);
+	free(st->fitness);
+	free(st->total);
+	free(st);
+}
@@ -0,0 +1,98 @@
+/*=====================================================
+ * steal.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares a work-stealing scheduler
+ * that evaluates the chromosomes of a group on all
+ * ranks, the master included.
+ *
+ * Every generation the master broadcasts the genes, the
+ * group is cut into chunks of chromosomes and each rank
+ * gets a block of chunks as its own queue. A rank takes
+ * chunks one at a time from its own queue; once it is
+ * empty, the rank steals half of the chunks left in
+ * another rank's queue and they become its own queue.
+ * The fitness values are summed onto the master, each
+ * chromosome is evaluated by exactly one rank.
+ *
+ * A queue is the range [next, end) of chunk indices,
+ * packed into one 64-bit word of an MPI window. Owner
+ * and thieves both claim chunks by adding to next with
+ * MPI_Fetch_and_op, so no rank has to answer requests
+ * while it evaluates. (MPI_Compare_and_swap would allow
+ * a true deque but crashes in some Open MPI builds.)
+ *=====================================================*/
+
+
+#ifndef STEAL_H_
+#define STEAL_H_
+
+
+#include <stdint.h>
+#include <mpi.h>
+#include "group.h"
+#include "sched.h"
+#include "shm.h"
+
+
+/*============ Type Definition ============*/
+/*
+ * state of the scheduler on one rank
+ */
+typedef struct
+{
+	int rank;							// rank of this process
+	int size;							// # of ranks
+	int chunk;						// # of chromosomes per chunk
+	int num_chunks;				// # of chunks of the group
+	long spin_ns;					// extra busy work per evaluation
+	double spread;				// spread of the busy work, see evaluate()
+	Pool* pool;						// threads of this rank
+	ShmArena* shm;				// node-shared arena, NULL if not used
+	int delta;						// send edit scripts to the replicas
+	int synced;						// the replicas hold the genes of the master
+	EditScript* script;		// script received by a replica
+	unsigned char* delta_buf;	// packed script
+	int delta_cap;				// size of delta_buf
+	MPI_Win win;					// window of the queue words of all ranks
+	int64_t* queue;				// queue word of this rank, in the window
+	double* fitness;			// fitness evaluated here, 0 elsewhere
+	double* total;				// fitness summed over the ranks, master only
+	Rng rng;							// picks the first victim of a steal
+	Traffic traffic;			// traffic of this rank
+}Stealer;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * create the scheduler, all ranks must call it
+ */
+Stealer* init_stealer(int num_chrs, int chunk, long spin_ns, double spread, Pool* pool,
+	ShmArena* shm, int delta);
+
+
+/*
+ * evaluate the fitness of every chromosome of the group
+ * together with the other ranks, master only
+ */
+void steal_evaluate(Stealer* st, Group* grp);
+
+
+/*
+ * take part in steal_evaluate() of the master until the
+ * master calls free_stealer(), ranks other than the
+ * master only
+ */
+void steal_loop(Stealer* st, Group* grp);
+
+
+/*
+ * tell the other ranks to leave steal_loop() (master
+ * only), copy the traffic out and free memories, all
+ * ranks must call it
+ */
+void free_stealer(Stealer* st, Traffic* traffic);
+
+
+#endif
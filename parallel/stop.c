@@ -0,0 +1,72 @@
+/*=====================================================
+ * stop.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the stop.h header file.
+ *=====================================================*/
+
+
+#include "stop.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * set up the rules, all off
+ */
+void init_stop_rule(StopRule* rule)
+{
+	rule->use_target = 0;
+	rule->target = 0.0;
+	rule->stall = 0;
+	rule->floor = 0.0;
+	rule->seen = 0;
+	rule->best = 0.0;
+	rule->best_gen = 0;
+}
+
+
+/*
+ * check the record of a generation, return STOP_NONE or
+ * the rule that ends the run
+ */
+int check_stop(StopRule* rule, const GenStats* stats)
+{
+	if (!rule->seen || stats->best > rule->best)
+	{
+		rule->seen = 1;
+		rule->best = stats->best;
+		rule->best_gen = stats->generation;
+	}
+
+	if (rule->use_target && stats->best >= rule->target)
+		return STOP_TARGET;
+
+	if (rule->stall > 0 && stats->generation - rule->best_gen >= rule->stall)
+		return STOP_STALL;
+
+	if (rule->floor > 0.0 && stats->diversity < rule->floor)
+		return STOP_DIVERSITY;
+
+	return STOP_NONE;
+}
+
+
+/*
+ * name of a STOP_* value, for the end-of-run message
+ */
+const char* stop_name(int reason)
+{
+	switch (reason)
+	{
+		case STOP_TARGET:
+			return "target fitness reached";
+		case STOP_STALL:
+			return "no improvement within the stall window";
+		case STOP_DIVERSITY:
+			return "diversity below the floor";
+		default:
+			return "all generations done";
+	}
+}
@@ -0,0 +1,68 @@
+/*=====================================================
+ * stop.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the stopping rules of a
+ * run, checked once per generation against the record
+ * that update_fit_rate() fills in, so they cost nothing
+ * beyond the pass it already makes:
+ * 1) target     the best fitness reached a value
+ * 2) stall      the best fitness has not improved for a
+ *               # of generations
+ * 3) diversity  the mean per-bit diversity fell below a
+ *               floor, i.e. the group has converged
+ * A run without any rule runs all of its generations.
+ *=====================================================*/
+
+
+#ifndef STOP_H_
+#define STOP_H_
+
+
+#include "stats.h"
+
+
+#define STOP_NONE 0				// keep evolving
+#define STOP_TARGET 1			// the target fitness was reached
+#define STOP_STALL 2			// no improvement within the window
+#define STOP_DIVERSITY 3	// diversity fell below the floor
+
+
+/*============ Type Definition ============*/
+/*
+ * stopping rules and what they have seen so far
+ */
+typedef struct
+{
+	int use_target;				// stop at the target fitness
+	double target;				// target fitness
+	int stall;						// window in generations, 0 = off
+	double floor;					// diversity floor, 0 = off
+	int seen;							// a record has been checked
+	double best;					// best fitness seen so far
+	int best_gen;					// generation it was first seen
+}StopRule;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * set up the rules, all off
+ */
+void init_stop_rule(StopRule* rule);
+
+
+/*
+ * check the record of a generation, return STOP_NONE or
+ * the rule that ends the run
+ */
+int check_stop(StopRule* rule, const GenStats* stats);
+
+
+/*
+ * name of a STOP_* value, for the end-of-run message
+ */
+const char* stop_name(int reason);
+
+
+#endif
@@ -0,0 +1,148 @@
+/*=====================================================
+ * store.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the store.h header file.
+ *=====================================================*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "store.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * create the file at path, or truncate it, for two
+ * generations of num_chrs chromosomes and map it;
+ * returns NULL with a message if it cannot
+ */
+Store* init_store(const char* path, int num_chrs, int num_genes)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t gen_bytes = (size_t)num_chrs * num_genes;
+
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		perror(path);
+		return NULL;
+	}
+
+	Store* st = (Store*)malloc(sizeof(Store));
+
+	st->fd = fd;
+	st->num_genes = num_genes;
+	st->half_bytes = (gen_bytes + page - 1) / page * page;
+
+	// even, so the pairs of crossover() never span blocks
+	st->block_chrs = (int)(STORE_BLOCK / num_genes) & ~1;
+	if (st->block_chrs < 2)
+		st->block_chrs = 2;
+
+	// a sparse file, the blocks get disk space when they
+	// are first written
+	if (0 != ftruncate(fd, 2 * st->half_bytes))
+	{
+		perror(path);
+		close(fd);
+		free(st);
+		return NULL;
+	}
+
+	st->map = (unsigned char*)mmap(NULL, 2 * st->half_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+		fd, 0);
+	if (MAP_FAILED == st->map)
+	{
+		perror(path);
+		close(fd);
+		free(st);
+		return NULL;
+	}
+
+	// the kernel reads ahead further and drops pages it
+	// has passed sooner
+	madvise(st->map, 2 * st->half_bytes, MADV_SEQUENTIAL);
+
+	return st;
+}
+
+
+/*
+ * first byte of half 0 or 1 of the store
+ */
+unsigned char* store_half(Store* st, int half)
+{
+	return st->map + half * st->half_bytes;
+}
+
+
+/*
+ * give advice on the pages of chromosomes [first, last)
+ * of the generation at genes, shrunk to whole pages,
+ * only use this function inside this file
+ */
+static void advise_chrs(Store* st, unsigned char* genes, long first, long last, int advice)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	uintptr_t begin = (uintptr_t)(genes + first * st->num_genes);
+	uintptr_t end = (uintptr_t)(genes + last * st->num_genes);
+
+	begin = (begin + page - 1) / page * page;
+	end = end / page * page;
+
+	if (begin < end)
+		madvise((void*)begin, end - begin, advice);
+}
+
+
+/*
+ * a pass over the generation at genes reaches
+ * chromosome i: at the start of a block read the next
+ * one ahead and drop the one before
+ */
+void store_stream(Store* st, unsigned char* genes, int i, int num_chrs)
+{
+	long block = st->block_chrs;
+
+	if (0 != i % block)
+		return;
+
+	long next = i + block < num_chrs ? i + block : num_chrs;
+	long ahead = next + block < num_chrs ? next + block : num_chrs;
+
+	advise_chrs(st, genes, next, ahead, MADV_WILLNEED);
+
+	if (i >= block)
+		store_drop(st, genes, i - block, i);
+}
+
+
+/*
+ * drop the pages of chromosomes [first, last) of the
+ * generation at genes, once a pass is done with them
+ */
+void store_drop(Store* st, unsigned char* genes, int first, int last)
+{
+	// written pages stay in the page cache until the
+	// kernel writes them back, dropping them is safe
+	advise_chrs(st, genes, first, last, MADV_DONTNEED);
+}
+
+
+/*
+ * unmap the store and close its file, which is left on
+ * disk
+ */
+void free_store(Store* st)
+{
+	munmap(st->map, 2 * st->half_bytes);
+	close(st->fd);
+	free(st);
+}
@@ -0,0 +1,86 @@
+/*=====================================================
+ * store.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares a file-backed store of the
+ * genes, for groups larger than memory: the arena and
+ * the scratch arena of the group are the two halves of
+ * one file mapped with mmap, so the kernel pages genes
+ * in and out and only the fitness values, chromosome
+ * structs and selection tables stay in memory.
+ *
+ * Each half is cut into blocks of STORE_BLOCK bytes
+ * rounded to an even # of chromosomes. The operators
+ * walk the genes front to back; at the start of each
+ * block store_stream() asks the kernel to read the next
+ * block ahead and to drop the one before, so however
+ * large the group is only a few blocks of it are in
+ * memory: select_parent() reads the old generation and
+ * writes the new one, the other operators and the
+ * evaluation of the master pass over one of them.
+ *=====================================================*/
+
+
+#ifndef STORE_H_
+#define STORE_H_
+
+
+#include <stddef.h>
+
+
+#define STORE_BLOCK (64UL << 20)	// bytes of genes in a block
+
+
+/*============ Type Definition ============*/
+/*
+ * a file holding two generations of genes
+ */
+typedef struct
+{
+	int fd;									// the file
+	unsigned char* map;			// both halves, mapped
+	size_t half_bytes;			// bytes of one generation, page aligned
+	int num_genes;					// # of gene segments of a chromosome
+	int block_chrs;					// # of chromosomes of a block, even
+}Store;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * create the file at path, or truncate it, for two
+ * generations of num_chrs chromosomes and map it;
+ * returns NULL with a message if it cannot
+ */
+Store* init_store(const char* path, int num_chrs, int num_genes);
+
+
+/*
+ * first byte of half 0 or 1 of the store
+ */
+unsigned char* store_half(Store* st, int half);
+
+
+/*
+ * a pass over the generation at genes reaches
+ * chromosome i: at the start of a block read the next
+ * one ahead and drop the one before
+ */
+void store_stream(Store* st, unsigned char* genes, int i, int num_chrs);
+
+
+/*
+ * drop the pages of chromosomes [first, last) of the
+ * generation at genes, once a pass is done with them
+ */
+void store_drop(Store* st, unsigned char* genes, int first, int last);
+
+
+/*
+ * unmap the store and close its file, which is left on
+ * disk
+ */
+void free_store(Store* st);
+
+
+#endif
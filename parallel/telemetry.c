@@ -0,0 +1,376 @@
+/*=====================================================
+ * telemetry.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the telemetry.h header file.
+ *=====================================================*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "telemetry.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * seconds on the monotonic clock, read through the vDSO,
+ * only use this function inside this file
+ */
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*
+ * make seq odd before the fields it guards are written,
+ * only use this function inside this file
+ */
+static void write_begin(_Atomic uint64_t* seq)
+{
+	uint64_t s = atomic_load_explicit(seq, memory_order_relaxed);
+
+	atomic_store_explicit(seq, s + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+
+/*
+ * make seq even once the fields it guards are written,
+ * only use this function inside this file
+ */
+static void write_end(_Atomic uint64_t* seq)
+{
+	uint64_t s = atomic_load_explicit(seq, memory_order_relaxed);
+
+	atomic_store_explicit(seq, s + 1, memory_order_release);
+}
+
+
+/*
+ * copy bytes bytes guarded by seq from src to dst; returns
+ * 0, or -1 if a writer stayed in the middle of an update,
+ * only use this function inside this file
+ */
+static int read_seq(const _Atomic uint64_t* seq, const void* src, void* dst, size_t bytes)
+{
+	int i;
+
+	for (i = 0; i < TELEM_READ_TRIES; i++)
+	{
+		uint64_t before = atomic_load_explicit(seq, memory_order_acquire);
+
+		if (before & 1)
+			continue;
+
+		memcpy(dst, src, bytes);
+		atomic_thread_fence(memory_order_acquire);
+
+		if (atomic_load_explicit(seq, memory_order_relaxed) == before)
+			return 0;
+	}
+
+	return -1;
+}
+
+
+/*
+ * bytes of a block with num_ranks slots, only use this
+ * function inside this file
+ */
+static size_t block_size(int num_ranks)
+{
+	return sizeof(TelemBlock) + (size_t)num_ranks * sizeof(TelemRank);
+}
+
+
+/*
+ * wrap the block mapped at block for rank and mark its
+ * slot live, only use this function inside this file
+ */
+static Telemetry* make_telemetry(TelemBlock* block, size_t size, const char* name, int rank,
+	int owner)
+{
+	Telemetry* tm = (Telemetry*)malloc(sizeof(Telemetry));
+	TelemRank* slot = &block->ranks[rank];
+	int p;
+
+	tm->block = block;
+	tm->size = size;
+	tm->name = strdup(name);
+	tm->rank = rank;
+	tm->owner = owner;
+	tm->start = now_sec();
+	tm->mark = tm->start;
+	tm->phase = -1;
+
+	for (p = 0; p < TELEM_NUM_PHASES; p++)
+	{
+		tm->phase_sec[p] = 0.0;
+	}
+
+	write_begin(&slot->seq);
+	slot->live = 1;
+	write_end(&slot->seq);
+
+	return tm;
+}
+
+
+/*
+ * make the segment name (e.g. "/pga") for num_ranks
+ * ranks, replacing a stale one, and join it as rank 0;
+ * returns NULL with a message if it cannot
+ */
+Telemetry* create_telemetry(const char* name, int num_ranks)
+{
+	size_t size = block_size(num_ranks);
+
+	// a reader still mapping a stale segment keeps it, this
+	// run gets a new one under the name
+	shm_unlink(name);
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		perror(name);
+		return NULL;
+	}
+
+	if (0 != ftruncate(fd, size))
+	{
+		perror(name);
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	TelemBlock* block = (TelemBlock*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == block)
+	{
+		perror(name);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	// ftruncate() zeroed the block, slots included
+	block->version = TELEM_VERSION;
+	block->size = (uint32_t)size;
+	block->num_ranks = num_ranks;
+	block->run_id = ((uint64_t)getpid() << 32) ^ (uint64_t)(now_sec() * 1e9);
+	block->stats.generation = -1;
+
+	// a reader that sees the magic sees the fields above
+	atomic_thread_fence(memory_order_release);
+	block->magic = TELEM_MAGIC;
+
+	return make_telemetry(block, size, name, 0, 1);
+}
+
+
+/*
+ * join the segment name made by rank 0 of the run
+ * run_id as rank; returns NULL if this rank cannot reach
+ * it, e.g. on another node
+ */
+Telemetry* join_telemetry(const char* name, uint64_t run_id, int rank)
+{
+	struct stat st;
+
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return NULL;
+
+	if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(TelemBlock))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	size_t size = (size_t)st.st_size;
+	TelemBlock* block = (TelemBlock*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == block)
+		return NULL;
+
+	// a segment of the same name left on this node by
+	// another run
+	if (TELEM_MAGIC != block->magic || TELEM_VERSION != block->version ||
+		run_id != block->run_id || size != block->size || rank >= block->num_ranks)
+	{
+		munmap(block, size);
+		return NULL;
+	}
+
+	return make_telemetry(block, size, name, rank, 0);
+}
+
+
+/*
+ * from now on the clock counts to phase, one of
+ * TELEM_PHASE_*, or to none if phase is -1
+ */
+void telemetry_phase(Telemetry* tm, int phase)
+{
+	double now = now_sec();
+
+	if (tm->phase >= 0)
+		tm->phase_sec[tm->phase] += now - tm->mark;
+
+	tm->phase = phase;
+	tm->mark = now;
+}
+
+
+/*
+ * publish generation, and stats unless NULL, with evals
+ * evaluations so far; rank 0 only
+ */
+void publish_generation(Telemetry* tm, int generation, const GenStats* stats, long evals)
+{
+	TelemBlock* block = tm->block;
+	double elapsed = now_sec() - tm->start;
+	int p;
+
+	write_begin(&block->seq);
+
+	block->generation = generation;
+
+	if (NULL != stats)
+		block->stats = *stats;
+
+	block->evals = evals;
+	block->evals_per_sec = elapsed > 0.0 ? evals / elapsed : 0.0;
+	block->elapsed = elapsed;
+
+	for (p = 0; p < TELEM_NUM_PHASES; p++)
+	{
+		block->phase_sec[p] = tm->phase_sec[p];
+	}
+
+	write_end(&block->seq);
+}
+
+
+/*
+ * publish the counters of this rank: evaluations,
+ * messages, bytes and seconds spent waiting
+ */
+void publish_rank(Telemetry* tm, long evals, long msgs, long bytes, double wait)
+{
+	TelemRank* slot = &tm->block->ranks[tm->rank];
+	double elapsed = now_sec() - tm->start;
+
+	write_begin(&slot->seq);
+
+	slot->evals = evals;
+	slot->msgs = msgs;
+	slot->bytes = bytes;
+	slot->utilization = elapsed > 0.0 ? 1.0 - wait / elapsed : 0.0;
+	slot->updated = elapsed;
+
+	write_end(&slot->seq);
+}
+
+
+/*
+ * leave the segment; rank 0 marks the run done and
+ * removes the name, readers keep their mapping
+ */
+void free_telemetry(Telemetry* tm)
+{
+	if (tm->owner)
+	{
+		write_begin(&tm->block->seq);
+		tm->block->done = 1;
+		write_end(&tm->block->seq);
+
+		shm_unlink(tm->name);
+	}
+
+	munmap(tm->block, tm->size);
+	free(tm->name);
+	free(tm);
+}
+
+
+/*
+ * map the segment name read-only for a reader; returns
+ * NULL with a message if it is not a block of this
+ * version
+ */
+const TelemBlock* open_telemetry(const char* name, size_t* size)
+{
+	struct stat st;
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		perror(name);
+		return NULL;
+	}
+
+	if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(TelemBlock))
+	{
+		fprintf(stderr, "%s: not a metrics segment\n", name);
+		close(fd);
+		return NULL;
+	}
+
+	*size = (size_t)st.st_size;
+	const TelemBlock* block = (const TelemBlock*)mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == block)
+	{
+		perror(name);
+		return NULL;
+	}
+
+	uint32_t magic = block->magic;
+	atomic_thread_fence(memory_order_acquire);
+
+	if (TELEM_MAGIC != magic || TELEM_VERSION != block->version || *size != block->size)
+	{
+		fprintf(stderr, "%s: not a metrics segment of version %d\n", name, TELEM_VERSION);
+		munmap((void*)block, *size);
+		return NULL;
+	}
+
+	return block;
+}
+
+
+/*
+ * copy the head of block into copy, slots excluded;
+ * returns 0, or -1 if rank 0 stayed in the middle of an
+ * update for TELEM_READ_TRIES tries
+ */
+int read_block(const TelemBlock* block, TelemBlock* copy)
+{
+	return read_seq(&block->seq, block, copy, sizeof(TelemBlock));
+}
+
+
+/*
+ * copy a slot into copy; returns 0, or -1 as read_block()
+ */
+int read_rank(const TelemRank* slot, TelemRank* copy)
+{
+	return read_seq(&slot->seq, slot, copy, sizeof(TelemRank));
+}
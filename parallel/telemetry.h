@@ -0,0 +1,174 @@
+/*=====================================================
+ * telemetry.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the live metrics of a run:
+ * a small versioned block in POSIX shared memory that
+ * the ranks update while they evolve and that a reader
+ * (see monitor.c) maps to watch the run.
+ *
+ * The block starts with a TelemBlock written by rank 0:
+ * the generation, the statistics of the group, the # of
+ * evaluations and their rate, and the seconds spent in
+ * each TELEM_PHASE_* of the main loop. A TelemRank slot
+ * per rank follows, each written by its own rank: its
+ * # of evaluations and messages and its utilization,
+ * i.e. the share of the run it was not blocked waiting.
+ * Only ranks on the node of rank 0 can reach the block,
+ * the slots of the others stay empty.
+ *
+ * The header and every slot have one writer each and a
+ * seqlock: the writer makes seq odd, writes, and makes
+ * it even again; a reader copies the fields and keeps
+ * the copy only if seq was even and did not change. So
+ * updating is a few plain stores, with no lock, I/O or
+ * system call in the loop (the clock is read through
+ * the vDSO), and a reader never holds the run up.
+ *=====================================================*/
+
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "stats.h"
+
+
+#define TELEM_MAGIC 0x5047414d	// "PGAM", first word of the block
+#define TELEM_VERSION 1					// version of the layout below
+#define TELEM_PHASE_BREED 0			// breeding and evaluation of a generation
+#define TELEM_PHASE_STATS 1			// statistics and stopping rules
+#define TELEM_PHASE_CHECKPOINT 2	// snapshots
+#define TELEM_NUM_PHASES 3
+#define TELEM_READ_TRIES 1000		// reads of a seqlock before giving up
+
+
+/*============ Type Definition ============*/
+/*
+ * the slot of one rank, 64 bytes
+ */
+typedef struct
+{
+	_Atomic uint64_t seq;		// seqlock, odd while the rank writes
+	int32_t live;						// the rank has joined
+	int32_t reserved;
+	int64_t evals;					// # of fitness evaluations
+	int64_t msgs;						// # of messages sent and received
+	int64_t bytes;					// # of bytes sent and received
+	double utilization;			// share of the run not spent waiting
+	double updated;					// seconds into the run of the update
+	double reserved2;
+}TelemRank;
+
+
+/*
+ * head of the block, followed by num_ranks TelemRank
+ */
+typedef struct
+{
+	uint32_t magic;					// TELEM_MAGIC, set last
+	uint32_t version;				// TELEM_VERSION
+	uint32_t size;					// bytes of the block, slots included
+	int32_t num_ranks;			// # of slots
+	uint64_t run_id;				// tells the block of this run from stale ones
+	_Atomic uint64_t seq;		// seqlock, odd while rank 0 writes
+	int32_t generation;			// generation reached
+	int32_t done;						// the run has ended
+	GenStats stats;					// latest statistics, generation -1 if none yet
+	int64_t evals;					// # of fitness evaluations of the run
+	double evals_per_sec;		// evals over the seconds of the run
+	double elapsed;					// seconds into the run of the update
+	double phase_sec[TELEM_NUM_PHASES];	// seconds of each phase so far
+	TelemRank ranks[];			// slot of each rank
+}TelemBlock;
+
+
+/*
+ * the block as mapped by one rank
+ */
+typedef struct
+{
+	TelemBlock* block;			// the mapped block
+	size_t size;						// bytes mapped
+	char* name;							// name of the segment
+	int rank;								// slot of this rank
+	int owner;							// rank 0, which made the segment
+	double start;						// clock at the start of the run
+	double mark;						// clock when the current phase began
+	int phase;							// current phase, or -1
+	double phase_sec[TELEM_NUM_PHASES];	// seconds of each phase so far
+}Telemetry;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * make the segment name (e.g. "/pga") for num_ranks
+ * ranks, replacing a stale one, and join it as rank 0;
+ * returns NULL with a message if it cannot
+ */
+Telemetry* create_telemetry(const char* name, int num_ranks);
+
+
+/*
+ * join the segment name made by rank 0 of the run
+ * run_id as rank; returns NULL if this rank cannot reach
+ * it, e.g. on another node
+ */
+Telemetry* join_telemetry(const char* name, uint64_t run_id, int rank);
+
+
+/*
+ * from now on the clock counts to phase, one of
+ * TELEM_PHASE_*, or to none if phase is -1
+ */
+void telemetry_phase(Telemetry* tm, int phase);
+
+
+/*
+ * publish generation, and stats unless NULL, with evals
+ * evaluations so far; rank 0 only
+ */
+void publish_generation(Telemetry* tm, int generation, const GenStats* stats, long evals);
+
+
+/*
+ * publish the counters of this rank: evaluations,
+ * messages, bytes and seconds spent waiting
+ */
+void publish_rank(Telemetry* tm, long evals, long msgs, long bytes, double wait);
+
+
+/*
+ * leave the segment; rank 0 marks the run done and
+ * removes the name, readers keep their mapping
+ */
+void free_telemetry(Telemetry* tm);
+
+
+/*
+ * map the segment name read-only for a reader; returns
+ * NULL with a message if it is not a block of this
+ * version
+ */
+const TelemBlock* open_telemetry(const char* name, size_t* size);
+
+
+/*
+ * copy the head of block into copy, slots excluded;
+ * returns 0, or -1 if rank 0 stayed in the middle of an
+ * update for TELEM_READ_TRIES tries
+ */
+int read_block(const TelemBlock* block, TelemBlock* copy);
+
+
+/*
+ * copy a slot into copy; returns 0, or -1 as read_block()
+ */
+int read_rank(const TelemRank* slot, TelemRank* copy);
+
+
+#endif
@@ -0,0 +1,495 @@
+/*=====================================================
+ * worker.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the worker.h header file.
+ *=====================================================*/
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include "worker.h"
+
+
+#define RING_HEAD 64			// bytes before the first slot, a cache line
+#define HIGH_FD 16				// lowest descriptor of the copies made by a child
+#define CHECK_EVERY 0.1		// seconds between checks that the workers live
+
+
+/*========== Function Definition ==========*/
+/*
+ * seconds on the monotonic clock, only use this
+ * function inside this file
+ */
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*
+ * slot index of the ring, counted from the first batch
+ * ever posted, only use this function inside this file
+ */
+static WorkerSlot* ring_slot(WorkerRing* ring, uint64_t index)
+{
+	return (WorkerSlot*)((unsigned char*)ring + RING_HEAD +
+		(index & (WORKER_SLOTS - 1)) * ring->slot_bytes);
+}
+
+
+/*
+ * genes of a slot, only use this function inside this
+ * file
+ */
+static unsigned char* slot_genes(WorkerSlot* slot)
+{
+	return (unsigned char*)slot + sizeof(WorkerSlot);
+}
+
+
+/*
+ * fitness values of a slot, after the genes rounded up
+ * to 8 bytes, only use this function inside this file
+ */
+static double* slot_fitness(WorkerRing* ring, WorkerSlot* slot)
+{
+	size_t genes = ((size_t)ring->batch_cap * ring->num_genes + 7) / 8 * 8;
+
+	return (double*)(slot_genes(slot) + genes);
+}
+
+
+/*
+ * add 1 to an eventfd, only use this function inside
+ * this file
+ */
+static void signal_fd(int fd)
+{
+	uint64_t one = 1;
+
+	if (write(fd, &one, sizeof(one)) < 0)
+		perror("worker eventfd");
+}
+
+
+/*
+ * create the ring and eventfds of a worker and start its
+ * process, in a process group of its own so a kill also
+ * reaches what the shell started; returns 0, or -1 if it
+ * cannot, only use this function inside this file
+ */
+static int start_worker(WorkerPool* wp, Worker* w)
+{
+	w->ring_fd = memfd_create("pga-worker", MFD_CLOEXEC);
+	w->work_fd = eventfd(0, EFD_CLOEXEC);
+	w->done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	w->ring = MAP_FAILED;
+
+	if (w->ring_fd >= 0 && 0 == ftruncate(w->ring_fd, wp->ring_bytes))
+		w->ring = (WorkerRing*)mmap(NULL, wp->ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+			w->ring_fd, 0);
+
+	if (w->work_fd < 0 || w->done_fd < 0 || MAP_FAILED == w->ring)
+	{
+		perror("worker ring");
+		return -1;
+	}
+
+	w->ring->magic = WORKER_MAGIC;
+	w->ring->num_genes = wp->num_genes;
+	w->ring->batch_cap = wp->batch_cap;
+	w->ring->slot_bytes = (int32_t)((wp->ring_bytes - RING_HEAD) / WORKER_SLOTS);
+	atomic_init(&w->ring->head, 0);
+	atomic_init(&w->ring->tail, 0);
+	atomic_init(&w->ring->stop, 0);
+	w->collected = 0;
+
+	w->pid = fork();
+	if (w->pid < 0)
+	{
+		perror("fork");
+		return -1;
+	}
+
+	if (0 == w->pid)
+	{
+		// die with the rank; move the descriptors out of the
+		// way first, so one cannot overwrite another
+		setpgid(0, 0);
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+		int ring_fd = fcntl(w->ring_fd, F_DUPFD, HIGH_FD);
+		int work_fd = fcntl(w->work_fd, F_DUPFD, HIGH_FD);
+		int done_fd = fcntl(w->done_fd, F_DUPFD, HIGH_FD);
+
+		if (dup2(ring_fd, WORKER_FD_RING) < 0 || dup2(work_fd, WORKER_FD_WORK) < 0 ||
+			dup2(done_fd, WORKER_FD_DONE) < 0)
+			_exit(127);
+
+		// the shell replaces itself with the command, which
+		// keeps the death signal
+		execl("/bin/sh", "sh", "-c", wp->exec_line, (char*)NULL);
+		_exit(127);
+	}
+
+	setpgid(w->pid, w->pid);
+
+	return 0;
+}
+
+
+/*
+ * stop the process of a worker, killed at once or after
+ * it had a second to exit, and free its ring, only use
+ * this function inside this file
+ */
+static void stop_worker(WorkerPool* wp, Worker* w, int kill_now)
+{
+	int status;
+
+	if (!kill_now)
+	{
+		atomic_store(&w->ring->stop, 1);
+		signal_fd(w->work_fd);
+
+		double until = now_sec() + 1.0;
+		while (0 == waitpid(w->pid, &status, WNOHANG) && now_sec() < until)
+			usleep(1000);
+	}
+
+	// a no-op for a process that has exited
+	kill(-w->pid, SIGKILL);
+	waitpid(w->pid, &status, 0);
+
+	munmap(w->ring, wp->ring_bytes);
+	close(w->ring_fd);
+	close(w->work_fd);
+	close(w->done_fd);
+}
+
+
+/*
+ * start num_workers processes of command, each with a
+ * ring of batch_cap genomes of num_genes segments per
+ * slot; a slot that takes longer than timeout seconds
+ * kills its worker. Returns NULL if a worker cannot be
+ * started
+ */
+WorkerPool* init_workers(const char* command, int num_workers, int num_genes, int batch_cap,
+	double timeout)
+{
+	WorkerPool* wp = (WorkerPool*)malloc(sizeof(WorkerPool));
+	int i;
+
+	wp->command = strdup(command);
+	wp->exec_line = (char*)malloc(strlen(command) + 6);
+	sprintf(wp->exec_line, "exec %s", command);
+	wp->num_workers = num_workers;
+	wp->num_genes = num_genes;
+	wp->batch_cap = batch_cap;
+	wp->timeout = timeout;
+	wp->batches = 0;
+	wp->timeouts = 0;
+	wp->lost = 0;
+	wp->workers = (Worker*)calloc(num_workers, sizeof(Worker));
+
+	// slots of whole cache lines, the genes then the
+	// fitness values on 8 bytes
+	size_t slot = sizeof(WorkerSlot) + ((size_t)batch_cap * num_genes + 7) / 8 * 8 +
+		batch_cap * sizeof(double);
+	slot = (slot + RING_HEAD - 1) / RING_HEAD * RING_HEAD;
+	wp->ring_bytes = RING_HEAD + WORKER_SLOTS * slot;
+
+	for (i = 0; i < num_workers; i++)
+	{
+		if (0 != start_worker(wp, &wp->workers[i]))
+		{
+			wp->num_workers = i;
+			free_workers(wp);
+			return NULL;
+		}
+	}
+
+	return wp;
+}
+
+
+/*
+ * copy the fitness values of the slots a worker has
+ * scored out of its ring; returns the # of batches, only
+ * use this function inside this file
+ */
+static int collect(WorkerPool* wp, Worker* w, double* fitness)
+{
+	uint64_t drained;
+	int count = 0;
+
+	// the count of the eventfd is not needed, tail is
+	if (read(w->done_fd, &drained, sizeof(drained)) < 0)
+		drained = 0;
+
+	uint64_t tail = atomic_load_explicit(&w->ring->tail, memory_order_acquire);
+	uint64_t head = atomic_load_explicit(&w->ring->head, memory_order_relaxed);
+
+	for (; w->collected < tail; w->collected++, count++)
+	{
+		WorkerSlot* slot = ring_slot(w->ring, w->collected);
+		int first = w->first[w->collected & (WORKER_SLOTS - 1)];
+
+		memcpy(fitness + first, slot_fitness(w->ring, slot), slot->count * sizeof(double));
+	}
+
+	// the clock of the next slot starts once the worker
+	// could start it
+	if (count > 0 && w->collected < head)
+	{
+		double now = now_sec();
+		double* posted = &w->posted[w->collected & (WORKER_SLOTS - 1)];
+
+		if (*posted < now)
+			*posted = now;
+	}
+
+	wp->batches += count;
+
+	return count;
+}
+
+
+/*
+ * score n genomes, back to back, into fitness on the
+ * worker processes; returns once all are scored
+ */
+void evaluate_workers(WorkerPool* wp, int n, const unsigned char* genes, double* fitness)
+{
+	struct pollfd* fds = (struct pollfd*)malloc(wp->num_workers * sizeof(struct pollfd));
+	int* fresh = (int*)calloc(wp->num_workers, sizeof(int));	// slots just posted per worker
+	int next = 0;
+	int in_flight = 0;
+	int more;
+	int i, j;
+
+	while (1)
+	{
+		// keep every ring full, one slot per worker in turn,
+		// so a batch of a few slots is spread over all of them
+		for (more = 1; more && next < n; )
+		{
+			more = 0;
+
+			for (i = 0; i < wp->num_workers && next < n; i++)
+			{
+				Worker* w = &wp->workers[i];
+				uint64_t head = atomic_load_explicit(&w->ring->head, memory_order_relaxed);
+
+				if (head - w->collected >= WORKER_SLOTS)
+					continue;
+
+				WorkerSlot* slot = ring_slot(w->ring, head);
+				int count = n - next < wp->batch_cap ? n - next : wp->batch_cap;
+
+				slot->count = count;
+				memcpy(slot_genes(slot), genes + (size_t)next * wp->num_genes,
+					(size_t)count * wp->num_genes);
+				w->first[head & (WORKER_SLOTS - 1)] = next;
+				w->posted[head & (WORKER_SLOTS - 1)] = now_sec();
+
+				atomic_store_explicit(&w->ring->head, head + 1, memory_order_release);
+				next += count;
+				fresh[i]++;
+				in_flight++;
+				more = 1;
+			}
+		}
+
+		// one wakeup for all slots just posted
+		for (i = 0; i < wp->num_workers; i++)
+		{
+			if (fresh[i] > 0)
+				signal_fd(wp->workers[i].work_fd);
+			fresh[i] = 0;
+		}
+
+		if (0 == in_flight)
+			break;
+
+		// wait for a slot to be done, at most until the
+		// oldest slot in flight runs out of time
+		double now = now_sec();
+		double wait = CHECK_EVERY;
+		for (i = 0; i < wp->num_workers; i++)
+		{
+			Worker* w = &wp->workers[i];
+
+			fds[i].fd = w->done_fd;
+			fds[i].events = POLLIN;
+			fds[i].revents = 0;
+
+			if (atomic_load_explicit(&w->ring->head, memory_order_relaxed) > w->collected)
+			{
+				double left = w->posted[w->collected & (WORKER_SLOTS - 1)] + wp->timeout - now;
+				if (left < wait)
+					wait = left;
+			}
+		}
+
+		poll(fds, wp->num_workers, wait > 0.0 ? (int)(wait * 1000.0) + 1 : 0);
+
+		now = now_sec();
+		for (i = 0; i < wp->num_workers; i++)
+		{
+			Worker* w = &wp->workers[i];
+
+			in_flight -= collect(wp, w, fitness);
+
+			uint64_t head = atomic_load_explicit(&w->ring->head, memory_order_relaxed);
+			if (head == w->collected)
+				continue;
+
+			int status;
+			int exited = w->pid == waitpid(w->pid, &status, WNOHANG);
+			if (!exited && now - w->posted[w->collected & (WORKER_SLOTS - 1)] <= wp->timeout)
+				continue;
+
+			// a command that cannot even score one batch
+			// will not do better when restarted
+			if (exited && 0 == w->collected)
+			{
+				fprintf(stderr, "worker \"%s\" exited before its first result\n", wp->command);
+				exit(3);
+			}
+
+			// the worker died or the slot is late: the batches
+			// left in its ring are lost
+			if (exited)
+				fprintf(stderr, "worker %d: exited, restarting it\n", (int)w->pid);
+			else
+				fprintf(stderr, "worker %d: no result within %.1f s, restarting it\n", (int)w->pid,
+					wp->timeout);
+			for (; w->collected < head; w->collected++)
+			{
+				WorkerSlot* slot = ring_slot(w->ring, w->collected);
+				int first = w->first[w->collected & (WORKER_SLOTS - 1)];
+
+				for (j = 0; j < slot->count; j++)
+				{
+					fitness[first + j] = WORKER_PENALTY;
+				}
+				in_flight--;
+				wp->lost++;
+			}
+
+			wp->timeouts++;
+			stop_worker(wp, w, 1);
+			if (0 != start_worker(wp, w))
+			{
+				fprintf(stderr, "cannot restart a worker of \"%s\"\n", wp->command);
+				exit(3);
+			}
+		}
+	}
+
+	free(fds);
+	free(fresh);
+}
+
+
+/*
+ * ask every worker to exit, wait for it and free
+ * memories
+ */
+void free_workers(WorkerPool* wp)
+{
+	int i;
+
+	for (i = 0; i < wp->num_workers; i++)
+	{
+		stop_worker(wp, &wp->workers[i], 0);
+	}
+
+	free(wp->workers);
+	free(wp->command);
+	free(wp->exec_line);
+	free(wp);
+}
+
+
+/*
+ * the loop of a worker process: score the batches of
+ * the ring inherited from the rank with score until the
+ * rank stops it or its parent exits; returns 0, or -1
+ * if there is no ring
+ */
+int worker_serve(WorkerScore score, void* arg)
+{
+	struct stat st;
+
+	if (0 != fstat(WORKER_FD_RING, &st) || (size_t)st.st_size < RING_HEAD)
+	{
+		fprintf(stderr, "worker: no ring on descriptor %d, start it with -X\n", WORKER_FD_RING);
+		return -1;
+	}
+
+	WorkerRing* ring = (WorkerRing*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		WORKER_FD_RING, 0);
+	if (MAP_FAILED == ring || WORKER_MAGIC != ring->magic)
+	{
+		fprintf(stderr, "worker: descriptor %d is not a ring\n", WORKER_FD_RING);
+		return -1;
+	}
+
+	// die with the parent, and find out if it already has;
+	// a parent other than the rank, e.g. a script, may
+	// exit without a signal, so an idle worker also checks
+	pid_t parent = getppid();
+	prctl(PR_SET_PDEATHSIG, SIGKILL);
+	struct pollfd pfd = {WORKER_FD_WORK, POLLIN, 0};
+
+	while (getppid() == parent)
+	{
+		uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+		if (tail == head)
+		{
+			if (atomic_load(&ring->stop))
+				break;
+
+			// sleep until the rank posts a slot or asks to stop
+			uint64_t posted;
+			if (0 == poll(&pfd, 1, WORKER_POLL_MS))
+				continue;
+			if (read(WORKER_FD_WORK, &posted, sizeof(posted)) < 0)
+				break;
+			continue;
+		}
+
+		WorkerSlot* slot = ring_slot(ring, tail);
+		score(ring->num_genes, slot->count, slot_genes(slot), slot_fitness(ring, slot), arg);
+
+		atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+		signal_fd(WORKER_FD_DONE);
+	}
+
+	munmap(ring, st.st_size);
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*=====================================================
+ * worker.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares a pool of evaluator
+ * processes: the fitness of a chromosome comes from an
+ * external program, e.g. a simulator, instead of a C
+ * function compiled into the code.
+ *
+ * A rank starts num_workers long-lived processes of a
+ * shell command and keeps a ring of WORKER_SLOTS batch
+ * slots with each of them in shared memory (memfd). A
+ * worker finds its ring on descriptor WORKER_FD_RING,
+ * and two eventfds on WORKER_FD_WORK and WORKER_FD_DONE:
+ * 1) the rank copies up to batch_cap genomes into the
+ *    next free slot, bumps head and writes the work fd;
+ * 2) the worker scores the slots from tail to head,
+ *    bumps tail after each one and writes the done fd.
+ * The rank keeps every ring full and polls the done fds,
+ * so all workers run at the same time and a process is
+ * never started per evaluation. A slot that is not done
+ * within the timeout kills the worker, and a worker may
+ * also die on its own; either way the batches left in
+ * its ring get WORKER_PENALTY as fitness and a new
+ * worker takes over.
+ *
+ * The worker side is worker_serve(), which loops over
+ * the batches of its ring, see onemax_worker.c. The
+ * shell execs the command, so the worker is a child of
+ * its rank and dies with it; a worker started further
+ * down, e.g. by a script, exits once its parent is gone.
+ *=====================================================*/
+
+
+#ifndef WORKER_H_
+#define WORKER_H_
+
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+
+#define WORKER_FD_RING 3			// ring of the worker, memfd
+#define WORKER_FD_WORK 4			// eventfd, written by the rank
+#define WORKER_FD_DONE 5			// eventfd, written by the worker
+#define WORKER_SLOTS 4				// # of batch slots of a ring, a power of 2
+#define WORKER_BATCH 64				// default # of genomes in a slot
+#define WORKER_MAGIC 0x50474157		// "PGAW", first word of a ring
+#define WORKER_PENALTY 0.0		// fitness of the genomes of a lost batch
+#define WORKER_POLL_MS 1000		// ms an idle worker waits before it checks its rank
+
+
+/*============ Type Definition ============*/
+/*
+ * head of a ring in shared memory, followed by its
+ * slots, each of them a WorkerSlot, the genes of
+ * batch_cap genomes and their batch_cap fitness values
+ */
+typedef struct
+{
+	uint32_t magic;					// WORKER_MAGIC
+	int32_t num_genes;			// # of gene segments of a genome
+	int32_t batch_cap;			// most genomes in a slot
+	int32_t slot_bytes;			// size of a slot, WorkerSlot included
+	_Atomic uint64_t head;	// # of batches posted, by the rank
+	_Atomic uint64_t tail;	// # of batches scored, by the worker
+	_Atomic int stop;				// set to ask the worker to exit
+}WorkerRing;
+
+
+/*
+ * head of a slot
+ */
+typedef struct
+{
+	int32_t count;					// # of genomes in the slot
+	int32_t reserved;
+}WorkerSlot;
+
+
+/*
+ * one worker process as seen by the rank
+ */
+typedef struct
+{
+	pid_t pid;							// process group of the worker
+	int ring_fd;						// memfd of the ring
+	int work_fd;						// eventfd the rank writes
+	int done_fd;						// eventfd the worker writes
+	WorkerRing* ring;				// ring, mapped
+	uint64_t collected;			// # of batches copied out of the ring
+	int first[WORKER_SLOTS];	// first genome of each slot in flight
+	double posted[WORKER_SLOTS];	// when each slot in flight was posted
+}Worker;
+
+
+/*
+ * the worker processes of a rank
+ */
+typedef struct
+{
+	char* command;					// shell command that starts a worker
+	char* exec_line;				// "exec " and the command, for sh -c
+	int num_workers;				// # of worker processes
+	int num_genes;					// # of gene segments of a genome
+	int batch_cap;					// most genomes in a slot
+	double timeout;					// seconds a slot may take
+	size_t ring_bytes;			// size of a ring
+	Worker* workers;				// the worker processes
+	long batches;						// # of batches scored
+	long timeouts;					// # of workers restarted, late or dead
+	long lost;							// # of batches lost with them
+}WorkerPool;
+
+
+/*
+ * scores n genomes of num_genes segments, back to back,
+ * into fitness; arg is passed through from worker_serve()
+ */
+typedef void (*WorkerScore)(int num_genes, int n, const unsigned char* genes, double* fitness,
+	void* arg);
+
+
+/*========== Function Prototype ==========*/
+/*
+ * start num_workers processes of command, each with a
+ * ring of batch_cap genomes of num_genes segments per
+ * slot; a slot that takes longer than timeout seconds
+ * kills its worker. Returns NULL if a worker cannot be
+ * started
+ */
+WorkerPool* init_workers(const char* command, int num_workers, int num_genes, int batch_cap,
+	double timeout);
+
+
+/*
+ * score n genomes, back to back, into fitness on the
+ * worker processes; returns once all are scored
+ */
+void evaluate_workers(WorkerPool* wp, int n, const unsigned char* genes, double* fitness);
+
+
+/*
+ * ask every worker to exit, wait for it and free
+ * memories
+ */
+void free_workers(WorkerPool* wp);
+
+
+/*
+ * the loop of a worker process: score the batches of
+ * the ring inherited from the rank with score until the
+ * rank stops it or its parent exits; returns 0, or -1
+ * if there is no ring
+ */
+int worker_serve(WorkerScore score, void* arg);
+
+
+#endif
@@ -0,0 +1,208 @@
+/*=====================================================
+ * alloc.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the alloc.h header file.
+ *=====================================================*/
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "alloc.h"
+
+
+#define HUGE_PAGE_SIZE (2UL << 20)	// size of a huge page
+#define MAX_NODES 1024							// max # of NUMA nodes in a mask
+#define MPOL_INTERLEAVE_MODE 3			// MPOL_INTERLEAVE of <numaif.h>
+
+
+/*========== Global Variable ==========*/
+static int numa_policy = NUMA_DEFAULT;	// policy of alloc_big()
+static int use_huge = 0;								// back alloc_big() with huge pages
+static AllocTouch first_touch = NULL;		// toucher under NUMA_LOCAL
+static void* touch_ctx = NULL;					// argument of first_touch
+
+
+/*========== Function Definition ==========*/
+/*
+ * round size up to a multiple of unit,
+ * only use this function inside this file
+ */
+static size_t round_up(size_t size, size_t unit)
+{
+	return (size + unit - 1) / unit * unit;
+}
+
+
+/*
+ * bytes actually mapped for an array of size bytes,
+ * only use this function inside this file
+ */
+static size_t mapped_size(size_t size)
+{
+	if (0 == size)
+		size = 1;
+
+	return round_up(size, use_huge ? HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE));
+}
+
+
+/*
+ * fill mask with the online NUMA nodes, as listed in
+ * sysfs like "0-3,6"; returns the highest node + 1,
+ * or 0 if it is unknown, only use this function inside
+ * this file
+ */
+static int online_nodes(unsigned long* mask)
+{
+	FILE* in = fopen("/sys/devices/system/node/online", "r");
+	int max_node = 0;
+	int lo, hi;
+	char sep;
+
+	memset(mask, 0, MAX_NODES / 8);
+	if (NULL == in)
+		return 0;
+
+	while (1 == fscanf(in, "%d", &lo))
+	{
+		hi = lo;
+		if (1 == fscanf(in, "%c", &sep) && '-' == sep)
+		{
+			if (1 != fscanf(in, "%d", &hi))
+				break;
+			if (1 != fscanf(in, "%c", &sep))
+				sep = '\n';
+		}
+
+		int node;
+		for (node = lo; node <= hi && node < MAX_NODES; node++)
+		{
+			mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+			if (node + 1 > max_node)
+				max_node = node + 1;
+		}
+
+		if (',' != sep)
+			break;
+	}
+
+	fclose(in);
+	return max_node;
+}
+
+
+/*
+ * choose the NUMA policy and whether to use huge pages
+ * for every later alloc_big()
+ */
+void init_alloc(int policy, int huge)
+{
+	numa_policy = policy;
+	use_huge = huge;
+}
+
+
+/*
+ * NUMA policy of the name "default", "local" or
+ * "interleave", or -1 if the name is unknown
+ */
+int parse_numa_policy(const char* name)
+{
+	if (0 == strcmp("default", name))
+		return NUMA_DEFAULT;
+	if (0 == strcmp("local", name))
+		return NUMA_LOCAL;
+	if (0 == strcmp("interleave", name))
+		return NUMA_INTERLEAVE;
+
+	return -1;
+}
+
+
+/*
+ * NUMA policy chosen by init_alloc()
+ */
+int alloc_policy(void)
+{
+	return numa_policy;
+}
+
+
+/*
+ * set how the pages of a new array are first touched
+ * under NUMA_LOCAL; without it the caller touches them
+ */
+void set_first_touch(AllocTouch touch, void* ctx)
+{
+	first_touch = touch;
+	touch_ctx = ctx;
+}
+
+
+/*
+ * alloc size bytes of zeroed memory, placed according
+ * to the policy; free it with free_big()
+ */
+void* alloc_big(size_t size)
+{
+	size_t len = mapped_size(size);
+	void* p = MAP_FAILED;
+
+	// the hugetlbfs pool is often empty, then fall back
+	// to normal pages and ask for transparent huge pages
+	if (use_huge)
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if (MAP_FAILED == p)
+	{
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == p)
+		{
+			perror("mmap");
+			exit(1);
+		}
+
+		if (use_huge)
+			madvise(p, len, MADV_HUGEPAGE);
+	}
+
+	if (NUMA_INTERLEAVE == numa_policy)
+	{
+		unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))];
+		int max_node = online_nodes(mask);
+
+		// a failed mbind only leaves the default placement
+		if (max_node > 1)
+			syscall(SYS_mbind, p, len, MPOL_INTERLEAVE_MODE, mask, (unsigned long)max_node + 1, 0);
+	}
+
+	// no page is touched yet; place them now under the
+	// local policy, where the processing threads touch them
+	if (NUMA_LOCAL == numa_policy)
+	{
+		if (NULL != first_touch)
+			first_touch(touch_ctx, (unsigned char*)p, len);
+		else
+			memset(p, 0, len);
+	}
+
+	return p;
+}
+
+
+/*
+ * free memory of size bytes got from alloc_big()
+ */
+void free_big(void* p, size_t size)
+{
+	if (NULL != p)
+		munmap(p, mapped_size(size));
+}
@@ -0,0 +1,86 @@
+/*=====================================================
+ * alloc.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the allocator of the big
+ * arrays of a group (genes, scratch, history), which
+ * maps them directly from the kernel so that their
+ * pages can be placed:
+ * 1) huge pages, 2 MB: from the hugetlbfs pool if it
+ *    has room, otherwise transparent huge pages
+ * 2) NUMA policy, chosen once at startup:
+ *    default     the kernel default
+ *    local       first touch, the pages of each part of
+ *                an array are touched by the thread that
+ *                processes that part (see set_first_touch)
+ *    interleave  pages spread round robin over all nodes
+ *
+ * Only system calls are used, so no NUMA library is
+ * needed; on a machine without NUMA the policies are
+ * harmless no-ops.
+ *=====================================================*/
+
+
+#ifndef ALLOC_H_
+#define ALLOC_H_
+
+
+#include <stddef.h>
+
+
+#define NUMA_DEFAULT 0			// kernel default placement
+#define NUMA_LOCAL 1				// first touch by the processing threads
+#define NUMA_INTERLEAVE 2		// interleave pages over all nodes
+
+
+/*============ Type Definition ============*/
+/*
+ * touches (writes) every page of [p, p + size), on the
+ * threads that will later process each part of it
+ */
+typedef void (*AllocTouch)(void* ctx, unsigned char* p, size_t size);
+
+
+/*========== Function Prototype ==========*/
+/*
+ * choose the NUMA policy and whether to use huge pages
+ * for every later alloc_big()
+ */
+void init_alloc(int policy, int huge);
+
+
+/*
+ * NUMA policy of the name "default", "local" or
+ * "interleave", or -1 if the name is unknown
+ */
+int parse_numa_policy(const char* name);
+
+
+/*
+ * NUMA policy chosen by init_alloc()
+ */
+int alloc_policy(void);
+
+
+/*
+ * set how the pages of a new array are first touched
+ * under NUMA_LOCAL; without it the caller touches them
+ */
+void set_first_touch(AllocTouch touch, void* ctx);
+
+
+/*
+ * alloc size bytes of zeroed memory, placed according
+ * to the policy; free it with free_big()
+ */
+void* alloc_big(size_t size);
+
+
+/*
+ * free memory of size bytes got from alloc_big()
+ */
+void free_big(void* p, size_t size);
+
+
+#endif
@@ -0,0 +1,351 @@
+/*=====================================================
+ * checkpoint.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the checkpoint.h header file.
+ *=====================================================*/
+
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * round a size up to a multiple of 8 bytes,
+ * only use this function inside this file
+ */
+static uint64_t align8(uint64_t size)
+{
+	return (size + 7) & ~(uint64_t)7;
+}
+
+
+/*
+ * FNV-1a hash of a block of bytes,
+ * only use this function inside this file
+ */
+static uint64_t fnv1a(const unsigned char* data, size_t size)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	size_t i;
+	for (i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+
+/*
+ * fill in the sizes and section offsets of a snapshot
+ * of the group, only use this function inside this file
+ */
+static void layout_header(const Group* grp, CkptHeader* hdr)
+{
+	uint64_t off = align8(sizeof(CkptHeader));
+
+	memset(hdr, 0, sizeof(CkptHeader));
+	memcpy(hdr->magic, CKPT_MAGIC, sizeof(CKPT_MAGIC));
+	hdr->version = CKPT_VERSION;
+	hdr->header_size = sizeof(CkptHeader);
+	hdr->num_genes = grp->num_genes;
+	hdr->num_chrs = grp->num_chrs;
+	hdr->num_rounds = grp->num_rounds;
+	hdr->memory = grp->memory;
+
+	hdr->genes_off = off;
+	off = align8(off + (uint64_t)grp->num_chrs * grp->num_genes);
+
+	hdr->fitness_off = off;
+	off = align8(off + (uint64_t)grp->num_chrs * sizeof(double));
+
+	hdr->rules_off = off;
+	off = align8(off + 2 * NUM_RULES * sizeof(double));
+
+	hdr->tactics_off = off;
+	off = align8(off + (uint64_t)grp->num_chrs);
+
+	hdr->history_off = off;
+	off = align8(off + (uint64_t)grp->num_rounds * sizeof(uint64_t));
+
+	hdr->file_size = off;
+}
+
+
+/*
+ * body of the writer thread, which waits for a staging
+ * image and writes it to a temporary file that is then
+ * renamed over the snapshot file, so that the snapshot
+ * file is always complete, only use this function
+ * inside this file
+ */
+static void* writer_main(void* arg)
+{
+	Checkpointer* ck = (Checkpointer*)arg;
+
+	pthread_mutex_lock(&ck->lock);
+
+	while (1)
+	{
+		while (CKPT_PENDING != ck->state && !ck->stop)
+		{
+			pthread_cond_wait(&ck->cond, &ck->lock);
+		}
+
+		if (CKPT_PENDING != ck->state)
+			break;
+
+		ck->state = CKPT_WRITING;
+		pthread_mutex_unlock(&ck->lock);
+
+		// the image is not touched by the evolution loop
+		// until the state goes back to idle
+		CkptHeader* hdr = (CkptHeader*)ck->image;
+		hdr->checksum = fnv1a(ck->image + hdr->header_size, ck->size - hdr->header_size);
+
+		int ok = 0;
+		int fd = open(ck->tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+		if (fd >= 0)
+		{
+			size_t done = 0;
+			while (done < ck->size)
+			{
+				ssize_t n = write(fd, ck->image + done, ck->size - done);
+				if (n <= 0)
+					break;
+				done += (size_t)n;
+			}
+
+			ok = (done == ck->size) && (0 == fsync(fd));
+			ok = (0 == close(fd)) && ok;
+			ok = ok && (0 == rename(ck->tmp_path, ck->path));
+		}
+
+		if (!ok)
+			perror("checkpoint");
+
+		pthread_mutex_lock(&ck->lock);
+		ck->num_written += ok;
+		ck->state = CKPT_IDLE;
+		pthread_cond_broadcast(&ck->cond);
+	}
+
+	pthread_mutex_unlock(&ck->lock);
+
+	return NULL;
+}
+
+
+/*
+ * allocate a staging image sized for the group and
+ * start the background writer for the given file
+ */
+Checkpointer* init_checkpointer(const char* path, const Group* grp)
+{
+	Checkpointer* ck = (Checkpointer*)malloc(sizeof(Checkpointer));
+	CkptHeader hdr;
+
+	layout_header(grp, &hdr);
+
+	ck->path = strdup(path);
+	ck->tmp_path = (char*)malloc(strlen(path) + 5);
+	sprintf(ck->tmp_path, "%s.tmp", path);
+	ck->size = hdr.file_size;
+	ck->image = (unsigned char*)calloc(ck->size, 1);
+	ck->state = CKPT_IDLE;
+	ck->stop = 0;
+	ck->num_written = 0;
+	ck->num_skipped = 0;
+	ck->saved_gen = -1;
+
+	pthread_mutex_init(&ck->lock, NULL);
+	pthread_cond_init(&ck->cond, NULL);
+	pthread_create(&ck->thread, NULL, writer_main, ck);
+
+	return ck;
+}
+
+
+/*
+ * copy the group into the staging image and hand it
+ * to the writer, return 0 if handed over, 1 if the
+ * writer was still busy and the snapshot was skipped
+ */
+int save_checkpoint(Checkpointer* ck, const Group* grp)
+{
+	pthread_mutex_lock(&ck->lock);
+	int idle = (CKPT_IDLE == ck->state);
+	if (!idle)
+		ck->num_skipped++;
+	pthread_mutex_unlock(&ck->lock);
+
+	// never wait for the disk inside the evolution loop
+	if (!idle)
+		return 1;
+
+	CkptHeader* hdr = (CkptHeader*)ck->image;
+	layout_header(grp, hdr);
+	hdr->generation = grp->generation;
+	hdr->cross_rate = grp->cross_rate;
+	hdr->mutate_rate = grp->mutate_rate;
+	memcpy(hdr->rng, grp->rng.s, sizeof(hdr->rng));
+
+	memcpy(ck->image + hdr->genes_off, grp->arena, (size_t)grp->num_chrs * grp->num_genes);
+
+	double* fitness = (double*)(ck->image + hdr->fitness_off);
+
+	int i;
+	for (i = 0; i < grp->num_chrs; i++)
+	{
+		fitness[i] = grp->chrs[i]->fitness;
+	}
+
+	memcpy(ck->image + hdr->rules_off, grp->rules, 2 * NUM_RULES * sizeof(double));
+	memcpy(ck->image + hdr->tactics_off, grp->tactics, grp->num_chrs);
+	memcpy(ck->image + hdr->history_off, grp->history, (size_t)grp->num_rounds * sizeof(uint64_t));
+
+	pthread_mutex_lock(&ck->lock);
+	ck->state = CKPT_PENDING;
+	pthread_cond_broadcast(&ck->cond);
+	pthread_mutex_unlock(&ck->lock);
+
+	ck->saved_gen = grp->generation;
+
+	return 0;
+}
+
+
+/*
+ * wait until the writer has put the last snapshot on
+ * the disk, so that the next save is not skipped
+ */
+void sync_checkpoint(Checkpointer* ck)
+{
+	pthread_mutex_lock(&ck->lock);
+	while (CKPT_IDLE != ck->state)
+	{
+		pthread_cond_wait(&ck->cond, &ck->lock);
+	}
+	pthread_mutex_unlock(&ck->lock);
+}
+
+
+/*
+ * wait for the last snapshot to reach the disk, stop
+ * the writer and free memories
+ */
+void free_checkpointer(Checkpointer* ck)
+{
+	sync_checkpoint(ck);
+
+	pthread_mutex_lock(&ck->lock);
+	ck->stop = 1;
+	pthread_cond_broadcast(&ck->cond);
+	pthread_mutex_unlock(&ck->lock);
+
+	pthread_join(ck->thread, NULL);
+	pthread_mutex_destroy(&ck->lock);
+	pthread_cond_destroy(&ck->cond);
+
+	free(ck->image);
+	free(ck->tmp_path);
+	free(ck->path);
+	free(ck);
+}
+
+
+/*
+ * map a snapshot file and restore the group from it,
+ * the group must have the same sizes as the snapshot,
+ * return 0 on success and -1 on failure
+ */
+int load_checkpoint(const char* path, Group* grp)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+
+	struct stat st;
+	if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(CkptHeader))
+	{
+		fprintf(stderr, "%s: not a snapshot file\n", path);
+		close(fd);
+		return -1;
+	}
+
+	unsigned char* map = (unsigned char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == map)
+	{
+		perror(path);
+		return -1;
+	}
+
+	// the sections are read front to back exactly once
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	const CkptHeader* hdr = (const CkptHeader*)map;
+	CkptHeader expect;
+	layout_header(grp, &expect);
+
+	int ok = 1;
+	if (0 != memcmp(hdr->magic, CKPT_MAGIC, sizeof(CKPT_MAGIC)) ||
+		CKPT_VERSION != hdr->version || sizeof(CkptHeader) != hdr->header_size)
+	{
+		fprintf(stderr, "%s: not a version %d snapshot file\n", path, CKPT_VERSION);
+		ok = 0;
+	}
+	else if (hdr->num_genes != grp->num_genes || hdr->num_chrs != grp->num_chrs ||
+		hdr->num_rounds != grp->num_rounds || hdr->memory != grp->memory ||
+		hdr->file_size != (uint64_t)st.st_size ||
+		hdr->history_off != expect.history_off)
+	{
+		fprintf(stderr, "%s: snapshot has %d genes x %d chromosomes remembering %d rounds, "
+			"run has %d x %d remembering %d\n", path, hdr->num_genes, hdr->num_chrs, hdr->memory,
+			grp->num_genes, grp->num_chrs, grp->memory);
+		ok = 0;
+	}
+	else if (hdr->checksum != fnv1a(map + hdr->header_size, hdr->file_size - hdr->header_size))
+	{
+		fprintf(stderr, "%s: snapshot is corrupted\n", path);
+		ok = 0;
+	}
+
+	if (ok)
+	{
+		grp->generation = hdr->generation;
+		memcpy(grp->rng.s, hdr->rng, sizeof(hdr->rng));
+		memcpy(grp->arena, map + hdr->genes_off, (size_t)grp->num_chrs * grp->num_genes);
+
+		const double* fitness = (const double*)(map + hdr->fitness_off);
+
+		int i;
+		for (i = 0; i < grp->num_chrs; i++)
+		{
+			grp->chrs[i]->fitness = fitness[i];
+		}
+
+		memcpy(grp->rules, map + hdr->rules_off, 2 * NUM_RULES * sizeof(double));
+		memcpy(grp->tactics, map + hdr->tactics_off, grp->num_chrs);
+		memcpy(grp->history, map + hdr->history_off, (size_t)grp->num_rounds * sizeof(uint64_t));
+	}
+
+	munmap(map, st.st_size);
+
+	return ok ? 0 : -1;
+}
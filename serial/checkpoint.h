@@ -0,0 +1,130 @@
+/*=====================================================
+ * checkpoint.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file defines a versioned binary snapshot
+ * format of the whole state of a group, so that a run
+ * that gets killed can be restarted where it stopped.
+ *
+ * A snapshot file is a fixed header followed by
+ * 8-byte aligned sections:
+ * 1) genes of all chromosomes, back to back
+ * 2) fitness of each chromosome
+ * 3) game rules
+ * 4) current tactics of each player
+ * 5) history tactics of each game
+ * Sections that a program does not have are recorded
+ * with offset 0.
+ *
+ * Snapshots are written by a background thread. The
+ * evolution loop only copies the group into a staging
+ * image and hands it over; if the writer is still busy
+ * with the previous image, the snapshot is skipped.
+ * Snapshots are read back with mmap().
+ *=====================================================*/
+
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+
+#include <stdint.h>
+#include <pthread.h>
+#include "group.h"
+
+
+#define CKPT_MAGIC "PGACKPT"	// first 8 bytes of a snapshot file
+#define CKPT_VERSION 2				// version of the snapshot format
+#define CKPT_IDLE 0						// writer waits for an image
+#define CKPT_PENDING 1				// image handed over, not yet taken
+#define CKPT_WRITING 2				// writer is writing the image
+
+
+/*============ Type Definition ============*/
+/*
+ * header at the start of every snapshot file
+ */
+typedef struct
+{
+	char magic[8];					// CKPT_MAGIC
+	uint32_t version;				// CKPT_VERSION
+	uint32_t header_size;		// sizeof(CkptHeader)
+	int32_t num_genes;			// # of gene segments
+	int32_t num_chrs;				// # of chromosomes
+	int32_t num_rounds;			// # of games in one iteration
+	int32_t generation;			// # of generations evolved so far
+	int32_t memory;					// # of rounds a player remembers
+	int32_t reserved;				// 0, keeps the doubles aligned
+	double cross_rate;			// crossover rate
+	double mutate_rate;			// mutation rate
+	uint64_t rng[4];				// state of the group random stream
+	uint64_t genes_off;			// offset of the genes section
+	uint64_t fitness_off;		// offset of the fitness section
+	uint64_t rules_off;			// offset of the rules section, or 0
+	uint64_t tactics_off;		// offset of the tactics section, or 0
+	uint64_t history_off;		// offset of the history section, or 0
+	uint64_t file_size;			// total size of the file in bytes
+	uint64_t checksum;			// FNV-1a of everything after the header
+}CkptHeader;
+
+
+/*
+ * background writer of snapshot files
+ */
+typedef struct
+{
+	char* path;							// snapshot file
+	char* tmp_path;					// file written before rename()
+	unsigned char* image;		// staging image of the snapshot
+	size_t size;						// size of the image in bytes
+	int state;							// CKPT_IDLE, CKPT_PENDING or CKPT_WRITING
+	int stop;								// set to ask the writer to exit
+	long num_written;				// # of snapshots written
+	long num_skipped;				// # of snapshots skipped while busy
+	int saved_gen;					// generation last handed to the writer, or -1
+	pthread_t thread;				// writer thread
+	pthread_mutex_t lock;		// guards state and stop
+	pthread_cond_t cond;		// signals a change of state
+}Checkpointer;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * allocate a staging image sized for the group and
+ * start the background writer for the given file
+ */
+Checkpointer* init_checkpointer(const char* path, const Group* grp);
+
+
+/*
+ * copy the group into the staging image and hand it
+ * to the writer, return 0 if handed over, 1 if the
+ * writer was still busy and the snapshot was skipped
+ */
+int save_checkpoint(Checkpointer* ck, const Group* grp);
+
+
+/*
+ * wait until the writer has put the last snapshot on
+ * the disk, so that the next save is not skipped
+ */
+void sync_checkpoint(Checkpointer* ck);
+
+
+/*
+ * wait for the last snapshot to reach the disk, stop
+ * the writer and free memories
+ */
+void free_checkpointer(Checkpointer* ck);
+
+
+/*
+ * map a snapshot file and restore the group from it,
+ * the group must have the same sizes as the snapshot,
+ * return 0 on success and -1 on failure
+ */
+int load_checkpoint(const char* path, Group* grp);
+
+
+#endif
@@ -8,8 +8,10 @@
  * 1) init_chromo() to allocate memory dynamically
  *    for the chromosome, and initialize genes with
  *    random values
- * 2) free_chromo() to free the memories
- * 3) print_chromo() to print the genes in binary form
+ * 2) bind_chromo() to set up a chromosome over
+ *    gene storage owned by the group
+ * 3) free_chromo() to free the memories
+ * 4) print_chromo() to print the genes in binary form
  *=====================================================*/
 
 
@@ -42,6 +44,18 @@ Chromo* init_chromo(int num_genes)
 }
 
 
+/*
+ * set up a chromosome over gene storage owned by
+ * someone else, e.g. a slot in the group gene arena
+ */
+void bind_chromo(Chromo* chr, int num_genes, unsigned char* genes)
+{
+	chr->fitness = 0.0;
+	chr->num_genes = num_genes;
+	chr->genes = genes;
+}
+
+
 /*
  * free memories allocated by malloc()
  */
@@ -0,0 +1,270 @@
+/*=====================================================
+ * coevolve.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the coevolve.h header file.
+ *=====================================================*/
+
+
+#include <string.h>
+#include "coevolve.h"
+#include "alloc.h"
+
+
+/*========== Function Definition ==========*/
+/*
+ * set up the co-evolution of side_a and side_b, made by
+ * init_rival_group() with the same memory and each with
+ * the other as rivals; every game has num_iters rounds a
+ * generation and each side runs on threads threads. The
+ * history of side B is made a copy of the one of side A
+ */
+Coevolution* init_coevolution(Group* side_a, Group* side_b, int num_iters, int threads)
+{
+	Coevolution* co = (Coevolution*)malloc(sizeof(Coevolution));
+	int n = side_a->num_chrs;
+	int m = side_b->num_chrs;
+	int s, a, b;
+
+	co->sides[0] = side_a;
+	co->sides[1] = side_b;
+	co->table_words = ((1 << (2 * side_a->memory)) + TABLE_BITS - 1) / TABLE_BITS;
+	co->num_iters = num_iters;
+	co->num_gen = 0;
+	co->threads = threads;
+	co->team = (CoevThread*)malloc(COEV_SIDES * threads * sizeof(CoevThread));
+
+	for (s = 0; s < COEV_SIDES; s++)
+	{
+		co->tables[s] = (uint64_t*)alloc_big((size_t)co->sides[s]->num_chrs * co->table_words *
+			sizeof(uint64_t));
+		decode_strategies(co->sides[s], co->tables[s], co->table_words);
+		co->sinks[s] = NULL;
+		co->reasons[s] = STOP_NONE;
+	}
+
+	// game (a, b) is word a * m + b of side A and word
+	// b * n + a of side B, A's view in the low half of
+	// both; side B starts from what side A drew
+	for (a = 0; a < n; a++)
+	{
+		for (b = 0; b < m; b++)
+		{
+			side_b->history[(size_t)b * n + a] = side_a->history[(size_t)a * m + b];
+		}
+	}
+
+	return co;
+}
+
+
+/*
+ * unpack the strategy bits of every player of grp into
+ * table_words words per player, state s in bit s % 64
+ * of word s / 64
+ */
+void decode_strategies(const Group* grp, uint64_t* tables, int table_words)
+{
+	int num_states = 1 << (2 * grp->memory);
+	int num_bytes = (num_states + CHAR_LENGTH - 1) / CHAR_LENGTH;
+	int i, j, bit;
+
+	for (i = 0; i < grp->num_chrs; i++)
+	{
+		const unsigned char* genes = grp->chrs[i]->genes;
+		uint64_t* table = tables + (size_t)i * table_words;
+
+		memset(table, 0, table_words * sizeof(uint64_t));
+
+		// state s is bit s % 8 of gene s / 8, counted from
+		// the highest bit as pick_tactics() reads it
+		for (j = 0; j < num_bytes; j++)
+		{
+			for (bit = 0; bit < CHAR_LENGTH; bit++)
+			{
+				int state = j * CHAR_LENGTH + bit;
+				uint64_t tactic = (genes[j] >> (CHAR_LENGTH - bit - 1)) & 1;
+
+				table[state / TABLE_BITS] |= tactic << (state % TABLE_BITS);
+			}
+		}
+	}
+}
+
+
+/*
+ * set the fitness of players [first, last) of a side to
+ * their score in the last round against every rival, as
+ * play_game() resets the fitness every iteration
+ */
+void play_rivals(Coevolution* co, int side, int first, int last)
+{
+	Group* grp = co->sides[side];
+	int num_rivals = co->sides[1 - side]->num_chrs;
+	int words = co->table_words;
+	int top = 2 * (grp->memory - 1);
+	uint64_t keep = grp->hist_keep;
+	const double* rules = grp->rules;
+	int i, j, r;
+
+	for (i = first; i < last; i++)
+	{
+		const uint64_t* own = co->tables[side] + (size_t)i * words;
+		uint64_t* history = grp->history + (size_t)i * num_rivals;
+		double score = 0.0;
+
+		for (j = 0; j < num_rivals; j++)
+		{
+			const uint64_t* rival = co->tables[1 - side] + (size_t)j * words;
+			const uint64_t* table_A = 0 == side ? own : rival;
+			const uint64_t* table_B = 0 == side ? rival : own;
+			uint64_t hist = history[j];
+			double payoff = 0.0;
+
+			for (r = 0; r < co->num_iters; r++)
+			{
+				// what each player remembers is the state of
+				// its strategy table, as in pick_tactics()
+				uint32_t state_A = (uint32_t)hist;
+				uint32_t state_B = (uint32_t)(hist >> HALF_SHIFT);
+				uint64_t tac_A = (table_A[state_A / TABLE_BITS] >> (state_A % TABLE_BITS)) & 1;
+				uint64_t tac_B = (table_B[state_B / TABLE_BITS] >> (state_B % TABLE_BITS)) & 1;
+
+				// the payoffs of this side, with its own tactic
+				// in the place of player A's
+				uint64_t mine = 0 == side ? tac_A : tac_B;
+				uint64_t theirs = 0 == side ? tac_B : tac_A;
+				payoff = rules[2 * ((mine << 1) + theirs)];
+
+				// the new round on top of each half, as in
+				// record_tactics()
+				hist = ((hist >> 2) & keep) | (((tac_A << 1) + tac_B) << top) |
+					(((tac_B << 1) + tac_A) << (HALF_SHIFT + top));
+			}
+
+			history[j] = hist;
+			score += payoff;
+		}
+
+		grp->chrs[i]->fitness = score;
+	}
+}
+
+
+/*
+ * the loop of one thread of a side, see coevolve.h,
+ * only use this function inside this file
+ */
+static void* side_main(void* arg)
+{
+	CoevThread* me = (CoevThread*)arg;
+	Coevolution* co = me->co;
+	Group* grp = co->sides[me->side];
+	int first = (int)((long)grp->num_chrs * me->index / co->threads);
+	int last = (int)((long)grp->num_chrs * (me->index + 1) / co->threads);
+
+	while (grp->generation < co->num_gen)
+	{
+		play_rivals(co, me->side, first, last);
+		pthread_barrier_wait(&co->barrier);
+
+		if (0 == me->index)
+		{
+			update_fit_rate(grp);
+
+			if (NULL != co->sinks[me->side])
+				push_stats(co->sinks[me->side], &grp->stats);
+
+			co->reasons[me->side] = check_stop(&co->rules[me->side], &grp->stats);
+		}
+		pthread_barrier_wait(&co->barrier);
+
+		// both sides stop at the same generation
+		if (STOP_NONE != co->reasons[0] || STOP_NONE != co->reasons[1])
+			break;
+
+		// nobody reads the tables of this side until the
+		// next barrier
+		if (0 == me->index)
+		{
+			evolve(grp);
+			decode_strategies(grp, co->tables[me->side], co->table_words);
+		}
+		pthread_barrier_wait(&co->barrier);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * evolve both sides for up to num_gen generations; the
+ * records of side A and B go to sinks[0] and sinks[1]
+ * unless NULL, and each side checks its own copy of
+ * rule. Returns STOP_NONE, or the rule that ended the
+ * run and in *side the side that hit it
+ */
+int run_coevolution(Coevolution* co, int num_gen, StatsSink** sinks, const StopRule* rule,
+	int* side)
+{
+	int num_threads = COEV_SIDES * co->threads;
+	int s, t;
+
+	co->num_gen = num_gen;
+	pthread_barrier_init(&co->barrier, NULL, num_threads);
+
+	for (s = 0; s < COEV_SIDES; s++)
+	{
+		co->sinks[s] = sinks[s];
+		co->rules[s] = *rule;
+		co->reasons[s] = STOP_NONE;
+
+		for (t = 0; t < co->threads; t++)
+		{
+			CoevThread* me = &co->team[s * co->threads + t];
+			me->co = co;
+			me->side = s;
+			me->index = t;
+		}
+	}
+
+	// the caller is the first thread of side A
+	for (t = 1; t < num_threads; t++)
+	{
+		pthread_create(&co->team[t].thread, NULL, side_main, &co->team[t]);
+	}
+
+	side_main(&co->team[0]);
+
+	for (t = 1; t < num_threads; t++)
+	{
+		pthread_join(co->team[t].thread, NULL);
+	}
+
+	pthread_barrier_destroy(&co->barrier);
+
+	*side = STOP_NONE != co->reasons[0] ? 0 : 1;
+
+	return co->reasons[*side];
+}
+
+
+/*
+ * free memories of the run, the groups are left to the
+ * caller
+ */
+void free_coevolution(Coevolution* co)
+{
+	int s;
+
+	for (s = 0; s < COEV_SIDES; s++)
+	{
+		free_big(co->tables[s], (size_t)co->sides[s]->num_chrs * co->table_words *
+			sizeof(uint64_t));
+	}
+
+	free(co->team);
+	free(co);
+}
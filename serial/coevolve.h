@@ -0,0 +1,133 @@
+/*=====================================================
+ * coevolve.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares the co-evolution of two
+ * groups of prisoners, side A and side B, e.g. two
+ * roles of an asymmetric game: each side has payoffs of
+ * its own (see set_payoffs()), and the fitness of a
+ * player is its score in the games against every
+ * player of the other side, a bipartite n x m tournament
+ * instead of the n(n-1)/2 games of play_game(); as
+ * there, only the last of the rounds of a generation
+ * counts.
+ *
+ * Each side evolves on a team of threads of its own.
+ * All that crosses from one side to the other is the
+ * decoded strategy tables: once a side has evolved, its
+ * first thread unpacks the 4^memory strategy bits of
+ * every player out of the genes into words, and the
+ * other side only reads those. Every generation runs in
+ * three steps, with a barrier of all threads after each:
+ * 1) every thread plays the games of its share of the
+ *    players of its side against all rivals;
+ * 2) the first thread of a side fills in its statistics
+ *    and checks the stopping rules;
+ * 3) it evolves the side and decodes its tables.
+ *
+ * Both sides play the same n x m games, each keeping
+ * its own copy of the history of the games in the order
+ * of its players, but only adds up the scores of its own
+ * players, so neither waits for the fitness of the other
+ * side. The copies start out equal and see the same
+ * tactics, so they stay equal.
+ *=====================================================*/
+
+
+#ifndef COEVOLVE_H_
+#define COEVOLVE_H_
+
+
+#include <stdint.h>
+#include <pthread.h>
+#include "group.h"
+#include "stats.h"
+#include "stop.h"
+
+
+#define COEV_SIDES 2			// side A and side B
+#define TABLE_BITS 64			// # of strategy bits in a table word
+
+
+/*============ Type Definition ============*/
+struct Coevolution;
+
+
+/*
+ * one thread of a side
+ */
+typedef struct
+{
+	struct Coevolution* co;	// the run
+	int side;								// 0 for side A, 1 for side B
+	int index;							// # of the thread within its side
+	pthread_t thread;				// the thread, unless it is the caller
+}CoevThread;
+
+
+/*
+ * state of a co-evolution run
+ */
+typedef struct Coevolution
+{
+	Group* sides[COEV_SIDES];			// players of side A and B
+	uint64_t* tables[COEV_SIDES];	// decoded strategies, table_words per player
+	int table_words;							// # of words of a strategy table
+	int num_iters;								// rounds of every game per generation
+	int num_gen;									// # of generations of the run
+	int threads;									// # of threads per side
+	StatsSink* sinks[COEV_SIDES];	// records of each side, or NULL
+	StopRule rules[COEV_SIDES];		// stopping rules of each side
+	int reasons[COEV_SIDES];			// STOP_* of each side
+	CoevThread* team;							// threads of both sides, side A first
+	pthread_barrier_t barrier;		// all threads of both sides
+}Coevolution;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * set up the co-evolution of side_a and side_b, made by
+ * init_rival_group() with the same memory and each with
+ * the other as rivals; every game has num_iters rounds a
+ * generation and each side runs on threads threads. The
+ * history of side B is made a copy of the one of side A
+ */
+Coevolution* init_coevolution(Group* side_a, Group* side_b, int num_iters, int threads);
+
+
+/*
+ * unpack the strategy bits of every player of grp into
+ * table_words words per player, state s in bit s % 64
+ * of word s / 64
+ */
+void decode_strategies(const Group* grp, uint64_t* tables, int table_words);
+
+
+/*
+ * set the fitness of players [first, last) of a side to
+ * their score in the last round against every rival, as
+ * play_game() resets the fitness every iteration
+ */
+void play_rivals(Coevolution* co, int side, int first, int last);
+
+
+/*
+ * evolve both sides for up to num_gen generations; the
+ * records of side A and B go to sinks[0] and sinks[1]
+ * unless NULL, and each side checks its own copy of
+ * rule. Returns STOP_NONE, or the rule that ended the
+ * run and in *side the side that hit it
+ */
+int run_coevolution(Coevolution* co, int num_gen, StatsSink** sinks, const StopRule* rule,
+	int* side);
+
+
+/*
+ * free memories of the run, the groups are left to the
+ * caller
+ */
+void free_coevolution(Coevolution* co);
+
+
+#endif
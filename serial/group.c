@@ -8,32 +8,64 @@
  *=====================================================*/
 
 
+#include <string.h>
 #include "group.h"
+#include "reduce.h"
+#include "prof.h"
 
 
 /*========== Function Definition ==========*/
- /*
- * alloc memories to the group struct and members, and
- * initialise history tactics records, and
- * initialise each chromosome in the group
+/*
+ * alloc a group with num_rounds games of history and
+ * initialise it, the players of the games are left to
+ * the caller, only use this function inside this file
  */
-Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate)
+static Group* make_players(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	int memory, int num_rounds, uint64_t seed)
 {
 	Group* grp = (Group*)malloc(sizeof(Group));
 
 	grp->num_genes = num_genes;
 	grp->num_chrs = num_chrs;
-	grp->num_rounds = num_chrs * (num_chrs-1) / 2;
+	grp->num_rounds = num_rounds;
+	grp->num_opponents = 0;
+	grp->fixed_schedule = 0;
+	grp->paired_gen = -1;
+	grp->pairs = NULL;
+	grp->order = NULL;
+	grp->grid_width = 0;
+	grp->memory = memory;
+
+	// a new round shifts each half of the word down by
+	// one tactic pair; keep the 2 * (memory - 1) bits of
+	// the older rounds in both halves
+	uint64_t older = (1ULL << (2 * (memory - 1))) - 1;
+	grp->hist_keep = older | (older << HALF_SHIFT);
+
+	grp->generation = 0;
 	grp->cross_rate = cross_rate;
 	grp->mutate_rate = mutate_rate;
 	grp->fit_total = 0.0;
-	grp->rules = (unsigned char*)malloc(2 * NUM_RULES * sizeof(unsigned char));
+	grp->rules = (double*)malloc(2 * NUM_RULES * sizeof(double));
 	grp->tactics = (unsigned char*)malloc(num_chrs * sizeof(unsigned char));
-	grp->history = (unsigned char**)malloc(grp->num_rounds * sizeof(unsigned char*));
 	grp->fit_rate = (double*)malloc(num_chrs * sizeof(double));
+	grp->fit_cum = (double*)malloc(num_chrs * sizeof(double));
+	grp->select_mode = SELECT_ROULETTE;
+	grp->select_param = 0.0;
+	grp->ranker = NULL;
+	grp->arena = (unsigned char*)alloc_big((size_t)num_chrs * num_genes * sizeof(unsigned char));
+	grp->scratch = (unsigned char*)alloc_big((size_t)num_chrs * num_genes * sizeof(unsigned char));
+	grp->history = (uint64_t*)alloc_big(grp->num_rounds * sizeof(uint64_t));
+	grp->chr_pool = (Chromo*)malloc(num_chrs * sizeof(Chromo));
 	grp->chrs = (Chromo**)malloc(num_chrs * sizeof(Chromo*));
+	grp->diversity_on = 0;
+	grp->bit_counts = (int*)malloc(num_genes * CHAR_LENGTH * sizeof(int));
+	grp->genome = NULL;
+	memset(&grp->stats, 0, sizeof(GenStats));
+
+	rng_seed(&grp->rng, seed, 0);
 
-	// hardcode the game rules
+	// the default game rules, set_payoffs() changes them
 	grp->rules[0] = 1;
 	grp->rules[1] = 1;
 	grp->rules[2] = 5;
@@ -43,22 +75,274 @@ Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_
 	grp->rules[6] = 3;
 	grp->rules[7] = 3;
 
-	int i, j;
+	int i;
 	for (i = 0; i < grp->num_rounds; i++)
 	{
-		grp->history[i] = (unsigned char*)malloc(2 * sizeof(unsigned char));
+		// initialise history tactic records
+		random_history(grp, i);
+	}
 
-		for (j = 0; j < 2; j++)
-		{
-			// initialise history tactic records
-			grp->history[i][j] = (unsigned char)rand() % NUM_COMBI;
-		}
+	for (i = 0; i < num_chrs; i++)
+	{
+		// initialise chromosomes over their slot in the arena
+		grp->chrs[i] = &grp->chr_pool[i];
+		bind_chromo(grp->chrs[i], num_genes, grp->arena + (size_t)i * num_genes);
+	}
+
+	fill_genes(grp);
+
+	return grp;
+}
+
+
+ /*
+ * alloc memories to the group struct and members, and
+ * initialise history tactics records, and
+ * initialise each chromosome in the group
+ */
+Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate)
+{
+	// the group draws from its own stream, seeded from
+	// rand() so that srand() still controls a run
+	uint64_t seed = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+
+	return init_group_seeded(num_genes, num_chrs, cross_rate, mutate_rate, seed);
+}
+
+
+/*
+ * as init_group(), but the random stream of the group
+ * starts from seed and rand() is not used, so groups can
+ * be created on any thread
+ */
+Group* init_group_seeded(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	uint64_t seed)
+{
+	return init_tournament_group(num_genes, num_chrs, cross_rate, mutate_rate, 0, 0, DEFAULT_MEMORY,
+		seed);
+}
+
+
+/*
+ * as init_group_seeded(), but for a fitness of its own
+ * instead of the games of play_game(): the group keeps
+ * no history, so it costs nothing per pair of players
+ */
+Group* init_plain_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	uint64_t seed)
+{
+	return make_players(num_genes, num_chrs, cross_rate, mutate_rate, DEFAULT_MEMORY, 0, seed);
+}
+
+
+/*
+ * as init_group_seeded(), but with num_opponents > 0
+ * every player only meets that many opponents per
+ * generation (see play_game()), drawn at random each
+ * generation or, with fixed_schedule set, the same ones
+ * every generation; history is only kept for those games.
+ * A player remembers the last memory rounds of a game,
+ * so its strategy is a table of 4^memory bits that must
+ * fit in the num_genes gene segments
+ */
+Group* init_tournament_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	int num_opponents, int fixed_schedule, int memory, uint64_t seed)
+{
+	// k perfect matchings of the players, or every pair
+	int num_rounds = num_chrs * (num_chrs-1) / 2;
+	if (num_opponents > 0)
+		num_rounds = num_chrs / 2 * num_opponents;
+
+	Group* grp = make_players(num_genes, num_chrs, cross_rate, mutate_rate, memory, num_rounds,
+		seed);
+
+	grp->num_opponents = num_opponents;
+	grp->fixed_schedule = fixed_schedule;
+
+	if (num_opponents > 0)
+	{
+		grp->pairs = (int*)malloc(2 * grp->num_rounds * sizeof(int));
+		grp->order = (int*)malloc(num_chrs * sizeof(int));
 	}
 
+	return grp;
+}
+
+
+/*
+ * as init_tournament_group(), but the players meet the
+ * num_rivals players of another group instead of each
+ * other (see coevolve.h); history is kept for those
+ * num_chrs * num_rivals games, the ones of player i
+ * from index i * num_rivals on, and play_game() does
+ * not apply
+ */
+Group* init_rival_group(int num_genes, int num_chrs, int num_rivals, double cross_rate,
+	double mutate_rate, int memory, uint64_t seed)
+{
+	return make_players(num_genes, num_chrs, cross_rate, mutate_rate, memory, num_chrs * num_rivals,
+		seed);
+}
+
+
+/*
+ * alloc a cellular group: the chromosomes are the cells
+ * of a torus grid_width wide, row after row. A player
+ * only plays its 4 neighbours, each of them once per
+ * iteration, and select_local() only picks parents in
+ * the neighbourhood of a cell. grid_width must be even,
+ * so the pairs of crossover() are neighbours too
+ */
+Group* init_cellular_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	int grid_width, int memory, uint64_t seed)
+{
+	// the games are the edges of the grid, which are
+	// 4 games per player and the same every generation
+	Group* grp = init_tournament_group(num_genes, num_chrs, cross_rate, mutate_rate, 4, 1, memory,
+		seed);
+
+	grp->grid_width = grid_width;
+
+	return grp;
+}
+
+
+/*
+ * index of the neighbour of cell in direction dir, one
+ * of GRID_SELF, GRID_NORTH, GRID_SOUTH, GRID_WEST or
+ * GRID_EAST, on the torus of a cellular group
+ */
+int grid_neighbour(const Group* grp, int cell, int dir)
+{
+	int width = grp->grid_width;
+	int height = grp->num_chrs / width;
+	int row = cell / width;
+	int col = cell % width;
+
+	// the edges of the grid wrap around
+	if (GRID_NORTH == dir)
+		row = (row + height - 1) % height;
+	else if (GRID_SOUTH == dir)
+		row = (row + 1) % height;
+	else if (GRID_WEST == dir)
+		col = (col + width - 1) % width;
+	else if (GRID_EAST == dir)
+		col = (col + 1) % width;
+
+	return row * width + col;
+}
+
+
+/*
+ * draw a random history for game index
+ */
+void random_history(Group* grp, int index)
+{
+	uint64_t states = (1ULL << (2 * grp->memory)) - 1;
+
+	// what player A and B remember are drawn apart, from
+	// the two halves of one draw
+	uint64_t bits = rng_next(&grp->rng);
+
+	grp->history[index] = (bits & states) | (((bits >> HALF_SHIFT) & states) << HALF_SHIFT);
+}
+
+
+/*
+ * fill block i of the genes of length size from the
+ * stream i of seed, only use this function inside this
+ * file
+ */
+static void fill_block(unsigned char* arena, size_t size, uint64_t seed, int i)
+{
+	size_t begin = (size_t)i * GENE_BLOCK;
+	size_t end = begin + GENE_BLOCK < size ? begin + GENE_BLOCK : size;
+	Rng rng;
+
+	rng_seed(&rng, seed, (uint64_t)i + 1);
+
+	for (; begin + sizeof(uint64_t) <= end; begin += sizeof(uint64_t))
+	{
+		uint64_t bits = rng_next(&rng);
+		memcpy(arena + begin, &bits, sizeof(bits));
+	}
+
+	if (begin < end)
+	{
+		uint64_t bits = rng_next(&rng);
+		memcpy(arena + begin, &bits, end - begin);
+	}
+}
+
+
+/*
+ * fill the genes with random values: the arena is cut
+ * into blocks of GENE_BLOCK bytes, each drawn 8 bytes at
+ * a time from a stream of its own seeded from the
+ * stream of the group, as in the parallel version
+ */
+void fill_genes(Group* grp)
+{
+	size_t size = (size_t)grp->num_chrs * grp->num_genes;
+	uint64_t seed = rng_next(&grp->rng);
+	int num_blocks = (int)((size + GENE_BLOCK - 1) / GENE_BLOCK);
+	int i;
+
+	for (i = 0; i < num_blocks; i++)
+	{
+		fill_block(grp->arena, size, seed, i);
+	}
+}
+
+
+/*
+ * read the genes of all chromosomes, one after another,
+ * from the raw bytes of the file at path, which must
+ * hold exactly num_chrs * num_genes bytes; returns 0, or
+ * -1 with a message if it does not
+ */
+int load_genes(Group* grp, const char* path)
+{
+	size_t size = (size_t)grp->num_chrs * grp->num_genes;
+
+	FILE* file = fopen(path, "rb");
+	if (NULL == file)
+	{
+		perror(path);
+		return -1;
+	}
+
+	// one more byte than needed tells a longer file
+	size_t got = fread(grp->arena, 1, size, file);
+	int extra = fgetc(file);
+	fclose(file);
+
+	if (got != size || EOF != extra)
+	{
+		fprintf(stderr, "%s: not %zu bytes of genes, %d chromosomes of %d segments\n", path, size,
+			grp->num_chrs, grp->num_genes);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * alloc a group whose genes are the typed values of
+ * genome (see numeric.h), drawn uniformly from its range;
+ * the group owns the genome from now on
+ */
+Group* init_numeric_group(Genome* genome, int num_chrs, double cross_rate, double mutate_rate,
+	uint64_t seed)
+{
+	Group* grp = init_plain_group(genome_bytes(genome), num_chrs, cross_rate, mutate_rate, seed);
+	int i;
+
+	grp->genome = genome;
 	for (i = 0; i < num_chrs; i++)
 	{
-		// initialise chromosomes
-		grp->chrs[i] = init_chromo(num_genes);
+		random_values(genome, &grp->rng, grp->chrs[i]->genes);
 	}
 
 	return grp;
@@ -66,25 +350,152 @@ Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_
 
 
 /*
- * update relative fitness of all chromosomes in the group
+ * read a selection like "roulette", "rank", "rank:1.8",
+ * "truncation" or "truncation:0.2"; returns 0 and sets
+ * mode and param, or -1 if the text is not one
+ */
+int parse_selection(const char* text, int* mode, double* param)
+{
+	const char* colon = strchr(text, ':');
+	size_t len = NULL != colon ? (size_t)(colon - text) : strlen(text);
+
+	if (8 == len && 0 == strncmp("roulette", text, len) && NULL == colon)
+	{
+		*mode = SELECT_ROULETTE;
+		*param = 0.0;
+		return 0;
+	}
+
+	if (4 == len && 0 == strncmp("rank", text, len))
+	{
+		*mode = SELECT_RANK;
+		*param = NULL != colon ? atof(colon + 1) : 1.5;
+		return *param >= 1.0 && *param <= 2.0 ? 0 : -1;
+	}
+
+	if (10 == len && 0 == strncmp("truncation", text, len))
+	{
+		*mode = SELECT_TRUNCATION;
+		*param = NULL != colon ? atof(colon + 1) : 0.5;
+		return *param > 0.0 && *param <= 1.0 ? 0 : -1;
+	}
+
+	return -1;
+}
+
+
+/*
+ * select parents with mode from now on: roulette
+ * (the default), linear ranking of pressure param in
+ * [1, 2] where the best gets param / n and the worst
+ * (2 - param) / n, or truncation where every parent is
+ * drawn uniformly from the fittest param share of the
+ * group. The last two only use the order of the fitness,
+ * so it may be 0 or negative
+ */
+void set_selection(Group* grp, int mode, double param)
+{
+	grp->select_mode = mode;
+	grp->select_param = param;
+
+	if (NULL != grp->ranker)
+		free_ranker(grp->ranker);
+	grp->ranker = NULL;
+
+	if (SELECT_ROULETTE != mode)
+		grp->ranker = init_ranker(grp->num_chrs);
+}
+
+
+/*
+ * update relative fitness of all chromosomes in the group,
+ * and fill in the statistics of the group in the same pass
  */
 void update_fit_rate(Group* grp)
 {
-	int i;
+	int i, j, bit;
+	int num_chrs = grp->num_chrs;
+	int num_bits = grp->num_genes * CHAR_LENGTH;
+	double best = grp->chrs[0]->fitness;
+	ExactSum total, sum_sq;
 
-	grp->fit_total = 0.0;
+	PROF_BEGIN(PROF_FIT_RATE);
 
-	// update total fitness of the group
-	for (i = 0; i < grp->num_chrs; i++)
+	// exact sums: the same bits in whatever order, or on
+	// however many threads and ranks, they are added up
+	exact_zero(&total);
+	exact_zero(&sum_sq);
+
+	if (grp->diversity_on)
+		memset(grp->bit_counts, 0, num_bits * sizeof(int));
+
+	// update total fitness of the group, and collect the
+	// statistics while each chromosome is in the cache
+	for (i = 0; i < num_chrs; i++)
 	{
-		grp->fit_total += grp->chrs[i]->fitness;
+		double fitness = grp->chrs[i]->fitness;
+
+		exact_add(&total, fitness);
+		exact_add(&sum_sq, fitness * fitness);
+		if (fitness > best)
+			best = fitness;
+
+		if (grp->diversity_on)
+		{
+			// count the 1's at each bit position
+			for (j = 0; j < grp->num_genes; j++)
+			{
+				unsigned char gene = grp->chrs[i]->genes[j];
+				int* count = grp->bit_counts + j * CHAR_LENGTH;
+
+				for (bit = 0; bit < CHAR_LENGTH; bit++)
+				{
+					count[bit] += (gene >> (CHAR_LENGTH - bit - 1)) & 1;
+				}
+			}
+		}
 	}
 
+	grp->fit_total = exact_value(&total);
+
 	// calculate relative fitness of each chromosome
-	for (i = 0; i < grp->num_chrs; i++)
+	for (i = 0; i < num_chrs; i++)
 	{
-		grp->fit_rate[i] = grp->chrs[i]->fitness / grp->fit_total;
+		// a group of zero fitness leaves every chromosome
+		// the same share instead of dividing by 0
+		if (grp->fit_total > 0.0)
+			grp->fit_rate[i] = grp->chrs[i]->fitness / grp->fit_total;
+		else
+			grp->fit_rate[i] = 1.0 / num_chrs;
 	}
+
+	double mean = grp->fit_total / num_chrs;
+	double variance = exact_value(&sum_sq) / num_chrs - mean * mean;
+
+	grp->stats.generation = grp->generation;
+	grp->stats.num_chrs = num_chrs;
+	grp->stats.best = best;
+	grp->stats.mean = mean;
+	grp->stats.variance = variance > 0.0 ? variance : 0.0;
+	grp->stats.diversity = 0.0;
+
+	if (grp->diversity_on)
+	{
+		// a bit position where a fraction p of the group
+		// has a 1 contributes 4p(1-p), which is 1 when
+		// half of the group has a 1 and 0 when all agree
+		ExactSum diversity;
+		exact_zero(&diversity);
+		for (bit = 0; bit < num_bits; bit++)
+		{
+			double p = (double)grp->bit_counts[bit] / num_chrs;
+			exact_add(&diversity, 4.0 * p * (1.0 - p));
+		}
+
+		grp->stats.diversity = exact_value(&diversity) / num_bits;
+	}
+
+	PROF_END(PROF_FIT_RATE);
 }
 
 
@@ -94,9 +505,44 @@ void update_fit_rate(Group* grp)
  */
 void evolve(Group* grp)
 {
-	select_parent(grp);
+	PROF_BEGIN(PROF_SELECT);
+	if (grp->grid_width > 0)
+		select_local(grp);
+	else
+		select_parent(grp);
+	PROF_END(PROF_SELECT);
+
+	PROF_BEGIN(PROF_CROSSOVER);
 	crossover(grp);
+	PROF_END(PROF_CROSSOVER);
+
+	PROF_BEGIN(PROF_MUTATE);
 	mutate(grp);
+	PROF_END(PROF_MUTATE);
+
+	grp->generation++;
+}
+
+
+/*
+ * slot of the wheel where rv falls: the first one whose
+ * running sum cum reaches it, else the last one, only
+ * use this function inside this file
+ */
+static int spin_wheel(const double* cum, int n, double rv)
+{
+	int lo = 0, hi = n - 1;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (rv > cum[mid])
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
 }
 
 
@@ -109,49 +555,101 @@ void select_parent(Group* grp)
 {
 	int num_genes = grp->num_genes;
 	int num_chrs = grp->num_chrs;
+	Ranker* rk = grp->ranker;
+	int num_top = 0;		// # of chromosomes truncation draws from
 
-	// tmp chromosome list to hold the old generation
-	Chromo* tmp = (Chromo*)malloc(num_chrs * sizeof(Chromo));
+	// the scratch arena holds the old generation
+	memcpy(grp->scratch, grp->arena, num_chrs * num_genes * sizeof(unsigned char));
 
-	int i, j;
-	for (i = 0; i < num_chrs; i++)
+	int i;
+
+	if (SELECT_ROULETTE == grp->select_mode)
+	{
+		// running sums of the relative fitness, added up in
+		// the order of a linear scan of the wheel
+		grp->fit_cum[0] = grp->fit_rate[0];
+		for (i = 1; i < num_chrs; i++)
+		{
+			grp->fit_cum[i] = grp->fit_cum[i-1] + grp->fit_rate[i];
+		}
+	}
+	else
+	{
+		for (i = 0; i < num_chrs; i++)
+		{
+			rk->fitness[i] = grp->chrs[i]->fitness;
+		}
+	}
+
+	if (SELECT_RANK == grp->select_mode)
 	{
-		tmp[i].genes = (unsigned char*)malloc(num_genes * sizeof(unsigned char));
+		// slot pos of the wheel belongs to the chromosome of
+		// rank pos from the worst, its share grows linearly
+		// from (2 - s) / n to s / n; these are running sums
+		double s = grp->select_param;
+		sort_fitness(rk);
 
-		for (j = 0; j < num_genes; j++)
+		for (i = 0; i < num_chrs; i++)
 		{
-			// copy the genes of the old generation
-			tmp[i].genes[j] = grp->chrs[i]->genes[j];
+			grp->fit_cum[i] = ((2.0 - s) * (i + 1) + (s - 1.0) * i * (i + 1.0) / (num_chrs - 1)) /
+				num_chrs;
 		}
 	}
+	else if (SELECT_TRUNCATION == grp->select_mode)
+	{
+		num_top = (int)(grp->select_param * num_chrs + 0.5);
+		if (num_top < 1)
+			num_top = 1;
+		select_top(rk, num_top);
+	}
 
-	// iterate through all chromosomes and select
-	// new ones using Roulette Wheel Selection
+	// iterate through all chromosomes and select new
+	// ones from the wheel, or from the fittest ones
 	for (i = 0; i < num_chrs; i++)
 	{
-		int k = 0;
-		double fit_rate_sum = grp->fit_rate[k];
-		double rv = (double)rand() / RAND_MAX;
+		int k;
 
-		// check which slot the RV falls
-		while (rv > fit_rate_sum)
+		if (SELECT_TRUNCATION == grp->select_mode)
 		{
-			k++;
-			fit_rate_sum += grp->fit_rate[k];
+			k = rk->order[num_chrs - num_top + rng_below(&grp->rng, num_top)];
 		}
-
-		// select a new chromosomes to replace old generation
-		for (j = 0; j < num_genes; j++)
+		else
 		{
-			grp->chrs[i]->genes[j] = tmp[k].genes[j];
+			k = spin_wheel(grp->fit_cum, num_chrs, rng_uniform(&grp->rng));
+			if (SELECT_RANK == grp->select_mode)
+				k = rk->order[k];
 		}
+
+		// select a new chromosomes to replace old generation
+		memcpy(grp->chrs[i]->genes, grp->scratch + k * num_genes, num_genes * sizeof(unsigned char));
 	}
+}
 
+
+/*
+ * select parent process of a cellular group: each cell
+ * gets the fitter of two cells drawn from its
+ * neighbourhood, so no global fitness is needed
+ */
+void select_local(Group* grp)
+{
+	int num_genes = grp->num_genes;
+	int num_chrs = grp->num_chrs;
+
+	// the scratch arena holds the old generation
+	memcpy(grp->scratch, grp->arena, num_chrs * num_genes * sizeof(unsigned char));
+
+	int i;
 	for (i = 0; i < num_chrs; i++)
 	{
-		free(tmp[i].genes);
+		// binary tournament in the neighbourhood, the first
+		// one drawn wins a tie
+		int a = grid_neighbour(grp, i, rng_below(&grp->rng, NUM_NEIGHBOURS));
+		int b = grid_neighbour(grp, i, rng_below(&grp->rng, NUM_NEIGHBOURS));
+		int k = grp->chrs[b]->fitness > grp->chrs[a]->fitness ? b : a;
+
+		memcpy(grp->chrs[i]->genes, grp->scratch + k * num_genes, num_genes * sizeof(unsigned char));
 	}
-	free(tmp);
 }
 
 
@@ -162,44 +660,62 @@ void select_parent(Group* grp)
  */
 void crossover(Group* grp)
 {
-	int num_chrs = grp->num_chrs;
-	int num_genes = grp->num_genes;
-
-	int i, j;
+	int i;
 
 	// iterate through chromosomes in pairs
-	for (i = 0; i < num_chrs; i += 2)
+	for (i = 0; i < grp->num_chrs; i += 2)
 	{
-		double rv = (double)rand() / RAND_MAX;
+		crossover_pair(grp, i);
+	}
+}
+
 
-		// if RV is less than crossover rate, do crossover
+/*
+ * crossover of chromosomes i and i+1, the step of
+ * crossover() for a single pair
+ */
+void crossover_pair(Group* grp, int i)
+{
+	int num_genes = grp->num_genes;
+	int j;
+
+	double rv = rng_uniform(&grp->rng);
+
+	// typed values are blended as a whole
+	if (NULL != grp->genome)
+	{
 		if (rv <= grp->cross_rate)
-		{
-			int gene_pos;		// index of gene segment
-			int bit_pos;		// bit position of gene segment
+			cross_values(grp->genome, &grp->rng, grp->chrs[i]->genes, grp->chrs[i+1]->genes);
+		return;
+	}
 
-			// randomly select a gene segment and the bit position
-			select_bit(grp->num_genes, &gene_pos, &bit_pos);
+	// if RV is less than crossover rate, do crossover
+	if (rv <= grp->cross_rate)
+	{
+		int gene_pos;		// index of gene segment
+		int bit_pos;		// bit position of gene segment
 
-			// exchange bits after bit_pos in the same gene segment
-			unsigned char gene1 = grp->chrs[i]->genes[gene_pos];
-			unsigned char gene2 = grp->chrs[i+1]->genes[gene_pos];
+		// randomly select a gene segment and the bit position
+		select_bit(&grp->rng, grp->num_genes, &gene_pos, &bit_pos);
 
-			unsigned char mask1 = CHAR_MAX << (CHAR_LENGTH - bit_pos + 1);
-			unsigned char mask2 = CHAR_MAX >> (bit_pos - 1);
+		// exchange bits after bit_pos in the same gene segment
+		unsigned char gene1 = grp->chrs[i]->genes[gene_pos];
+		unsigned char gene2 = grp->chrs[i+1]->genes[gene_pos];
 
-			grp->chrs[i]->genes[gene_pos] = (gene1 & mask1) + (gene2 & mask2);
-			grp->chrs[i+1]->genes[gene_pos] = (gene2 & mask1) + (gene1 & mask2);
-			
-			// exchage gene segments after gene_pos
-			for (j = gene_pos + 1; j < num_genes; j++)
-			{
-				unsigned char tmp = grp->chrs[i]->genes[j];
-				grp->chrs[i]->genes[j] = grp->chrs[i+1]->genes[j];
-				grp->chrs[i+1]->genes[j] = tmp;
-			}
-		}	// end of if()
-	}	// end of i-for()
+		unsigned char mask1 = CHAR_MAX << (CHAR_LENGTH - bit_pos + 1);
+		unsigned char mask2 = CHAR_MAX >> (bit_pos - 1);
+
+		grp->chrs[i]->genes[gene_pos] = (gene1 & mask1) + (gene2 & mask2);
+		grp->chrs[i+1]->genes[gene_pos] = (gene2 & mask1) + (gene1 & mask2);
+
+		// exchage gene segments after gene_pos
+		for (j = gene_pos + 1; j < num_genes; j++)
+		{
+			unsigned char tmp = grp->chrs[i]->genes[j];
+			grp->chrs[i]->genes[j] = grp->chrs[i+1]->genes[j];
+			grp->chrs[i+1]->genes[j] = tmp;
+		}
+	}	// end of if()
 }
 
 
@@ -207,10 +723,10 @@ void crossover(Group* grp)
  * select a bit from a gene segment of a chromosome
  * for the crossover process
  */
-void select_bit(int num_genes, int* gene_pos, int* bit_pos)
+void select_bit(Rng* rng, int num_genes, int* gene_pos, int* bit_pos)
 {
 	int bit_total = num_genes * CHAR_LENGTH;
-	int rv = rand() % bit_total;
+	int rv = rng_below(rng, bit_total);
 
 	*gene_pos = rv / CHAR_LENGTH;			// index of gene segment
 	*bit_pos = rv % CHAR_LENGTH + 1;	// bit position of gene segment
@@ -224,52 +740,73 @@ void select_bit(int num_genes, int* gene_pos, int* bit_pos)
  */
 void mutate(Group* grp)
 {
-	int i, j, bit;
+	int i;
 
 	// iterate through every chromosome
 	for (i = 0; i < grp->num_chrs; i++)
 	{
-		// iterate through every gene segment
-		for (j = 0; j < grp->num_genes; j++)
-		{
-			// iterate through every bit in the gene segment
-			for (bit = 0; bit < CHAR_LENGTH; bit++)
-			{
-				double rv = (double)rand() / RAND_MAX;
-
-				// if RV is less than mutation rate, execute mutation
-				if (rv < grp->mutate_rate)
-				{
-					unsigned char mask = 1 << (CHAR_LENGTH - bit - 1);
-					grp->chrs[i]->genes[j] ^= mask;
-				}
-			}	// end bit-for()
-		}	// end j-for()
-	}	// end i-for()
+		mutate_chromo(grp, i);
+	}
 }
 
 
 /*
- * free memories of the group and members
+ * mutation of every bit of chromosome i, the step of
+ * mutate() for a single chromosome
  */
-void free_group(Group* grp)
+void mutate_chromo(Group* grp, int i)
 {
-	int i;
-	for (i = 0; i < grp->num_chrs; i++)
+	int j, bit;
+
+	// typed values get a step each instead of bit flips
+	if (NULL != grp->genome)
 	{
-		free_chromo(grp->chrs[i]);
+		mutate_values(grp->genome, &grp->rng, grp->mutate_rate, grp->chrs[i]->genes);
+		return;
 	}
 
-	for (i = 0; i < grp->num_rounds; i++)
+	// iterate through every gene segment
+	for (j = 0; j < grp->num_genes; j++)
 	{
-		free(grp->history[i]);
-	}
+		// iterate through every bit in the gene segment
+		for (bit = 0; bit < CHAR_LENGTH; bit++)
+		{
+			double rv = rng_uniform(&grp->rng);
+
+			// if RV is less than mutation rate, execute mutation
+			if (rv < grp->mutate_rate)
+			{
+				unsigned char mask = 1 << (CHAR_LENGTH - bit - 1);
+				grp->chrs[i]->genes[j] ^= mask;
+			}
+		}	// end bit-for()
+	}	// end j-for()
+}
+
+
+/*
+ * free memories of the group and members
+ */
+void free_group(Group* grp)
+{
+	size_t size = (size_t)grp->num_chrs * grp->num_genes * sizeof(unsigned char);
 
 	free(grp->chrs);
+	free(grp->chr_pool);
+	free_big(grp->arena, size);
+	free_big(grp->scratch, size);
+	free_big(grp->history, grp->num_rounds * sizeof(uint64_t));
+	free(grp->bit_counts);
+	if (NULL != grp->genome)
+		free_genome(grp->genome);
 	free(grp->rules);
 	free(grp->tactics);
-	free(grp->history);
+	free(grp->pairs);
+	free(grp->order);
 	free(grp->fit_rate);
+	free(grp->fit_cum);
+	if (NULL != grp->ranker)
+		free_ranker(grp->ranker);
 	free(grp);
 }
 
@@ -19,12 +19,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "chromo.h"
+#include "rng.h"
+#include "stats.h"
+#include "alloc.h"
+#include "rank.h"
+#include "numeric.h"
 
 
 #define CHAR_MAX 255		// max value of unsigned char
 #define CHAR_LENGTH 8		// # of bits of unsigned char
 #define NUM_RULES 4			// # of game rules
-#define NUM_COMBI 16		// # of tactic combinations
+#define DEFAULT_MEMORY 2	// # of rounds a player remembers
+#define MAX_MEMORY 12			// most rounds a player can remember
+#define HALF_SHIFT 32			// bit of the history word where B's view starts
+#define NUM_NEIGHBOURS 5	// a cell and its N, S, W and E neighbours
+#define GRID_SELF 0				// directions of grid_neighbour()
+#define GRID_NORTH 1
+#define GRID_SOUTH 2
+#define GRID_WEST 3
+#define GRID_EAST 4
+#define SELECT_ROULETTE 0		// fitness-proportional selection
+#define SELECT_RANK 1				// linear ranking selection
+#define SELECT_TRUNCATION 2	// uniform among the fittest
+#define GENE_BLOCK 65536		// bytes of genes drawn from one stream
 
 
 /*============ Type Definition ============*/
@@ -33,14 +50,35 @@ typedef struct
 	int num_genes;			// # of gene segments
 	int num_chrs;				// # of chromosomes
 	int num_rounds;			// # of games in one iteration
+	int num_opponents;	// # of games of a player, 0 = every pair plays
+	int fixed_schedule;	// the same opponents every generation
+	int* pairs;					// players of each game, unless every pair plays
+	int paired_gen;			// generation the pairs were drawn for
+	int* order;					// players in random order, to draw the pairs
+	int grid_width;			// width of the torus of a cellular group, else 0
+	int memory;					// # of rounds a player remembers
+	uint64_t hist_keep;	// bits of a history word kept by a new round
+	int generation;			// # of generations evolved so far
 	double cross_rate;	// crossover rate
 	double mutate_rate;	// mutation rate
 	double fit_total;		// total fitness of the group
-	unsigned char* rules;			// game rules
+	double* rules;			// payoffs of both players for each tactic pair
 	unsigned char* tactics;		// current tactics
-	unsigned char** history;	// history tactics
+	uint64_t* history;	// history tactics of each game, one word per game
 	double* fit_rate;		// relative fitness of each chromosome
+	double* fit_cum;		// running sums of the selection wheel
+	int select_mode;		// SELECT_ROULETTE, SELECT_RANK or SELECT_TRUNCATION
+	double select_param;	// pressure of SELECT_RANK, share of SELECT_TRUNCATION
+	Ranker* ranker;			// ranks the group, unless SELECT_ROULETTE
+	unsigned char* arena;		// genes of all chromosomes, back to back
+	unsigned char* scratch;	// copy of the arena used by select_parent()
+	Chromo* chr_pool;		// chromosome structs bound to the arena
 	Chromo** chrs;			// a list of chromosomes
+	Rng rng;						// random number stream of the group
+	GenStats stats;			// statistics filled by update_fit_rate()
+	int diversity_on;		// also count bits for the diversity stat
+	int* bit_counts;		// # of 1's at each bit position
+	Genome* genome;			// typed values of the genes, or NULL for bits
 }Group;
 
 
@@ -54,7 +92,125 @@ Group* init_group(int num_genes, int num_chrs, double cross_rate, double mutate_
 
 
 /*
- * update relative fitness of all chromosomes in the group
+ * as init_group(), but the random stream of the group
+ * starts from seed and rand() is not used, so groups can
+ * be created on any thread
+ */
+Group* init_group_seeded(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	uint64_t seed);
+
+
+/*
+ * as init_group_seeded(), but for a fitness of its own
+ * instead of the games of play_game(): the group keeps
+ * no history, so it costs nothing per pair of players
+ */
+Group* init_plain_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	uint64_t seed);
+
+
+/*
+ * as init_group_seeded(), but with num_opponents > 0
+ * every player only meets that many opponents per
+ * generation (see play_game()), drawn at random each
+ * generation or, with fixed_schedule set, the same ones
+ * every generation; history is only kept for those games.
+ * A player remembers the last memory rounds of a game,
+ * so its strategy is a table of 4^memory bits that must
+ * fit in the num_genes gene segments
+ */
+Group* init_tournament_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	int num_opponents, int fixed_schedule, int memory, uint64_t seed);
+
+
+/*
+ * as init_tournament_group(), but the players meet the
+ * num_rivals players of another group instead of each
+ * other (see coevolve.h); history is kept for those
+ * num_chrs * num_rivals games, the ones of player i
+ * from index i * num_rivals on, and play_game() does
+ * not apply
+ */
+Group* init_rival_group(int num_genes, int num_chrs, int num_rivals, double cross_rate,
+	double mutate_rate, int memory, uint64_t seed);
+
+
+/*
+ * alloc a cellular group: the chromosomes are the cells
+ * of a torus grid_width wide, row after row. A player
+ * only plays its 4 neighbours, each of them once per
+ * iteration, and select_local() only picks parents in
+ * the neighbourhood of a cell. grid_width must be even,
+ * so the pairs of crossover() are neighbours too
+ */
+Group* init_cellular_group(int num_genes, int num_chrs, double cross_rate, double mutate_rate,
+	int grid_width, int memory, uint64_t seed);
+
+
+/*
+ * index of the neighbour of cell in direction dir, one
+ * of GRID_SELF, GRID_NORTH, GRID_SOUTH, GRID_WEST or
+ * GRID_EAST, on the torus of a cellular group
+ */
+int grid_neighbour(const Group* grp, int cell, int dir);
+
+
+/*
+ * draw a random history for game index
+ */
+void random_history(Group* grp, int index);
+
+
+/*
+ * fill the genes with random values: the arena is cut
+ * into blocks of GENE_BLOCK bytes, each drawn 8 bytes at
+ * a time from a stream of its own seeded from the
+ * stream of the group, as in the parallel version
+ */
+void fill_genes(Group* grp);
+
+
+/*
+ * read the genes of all chromosomes, one after another,
+ * from the raw bytes of the file at path, which must
+ * hold exactly num_chrs * num_genes bytes; returns 0, or
+ * -1 with a message if it does not
+ */
+int load_genes(Group* grp, const char* path);
+
+
+/*
+ * alloc a group whose genes are the typed values of
+ * genome (see numeric.h), drawn uniformly from its range;
+ * the group owns the genome from now on
+ */
+Group* init_numeric_group(Genome* genome, int num_chrs, double cross_rate, double mutate_rate,
+	uint64_t seed);
+
+
+/*
+ * read a selection like "roulette", "rank", "rank:1.8",
+ * "truncation" or "truncation:0.2"; returns 0 and sets
+ * mode and param, or -1 if the text is not one
+ */
+int parse_selection(const char* text, int* mode, double* param);
+
+
+/*
+ * select parents with mode from now on: roulette
+ * (the default), linear ranking of pressure param in
+ * [1, 2] where the best gets param / n and the worst
+ * (2 - param) / n, or truncation where every parent is
+ * drawn uniformly from the fittest param share of the
+ * group. The last two only use the order of the fitness,
+ * so it may be 0 or negative
+ */
+void set_selection(Group* grp, int mode, double param);
+
+
+/*
+ * update relative fitness of all chromosomes in the group,
+ * and fill in the statistics of the group in the same pass
  */
 void update_fit_rate(Group* grp);
 
@@ -68,12 +224,21 @@ void evolve(Group* grp);
 
 /*
  * select parent process that chooses new chromosomes
- * based on relative fitness. The chromosomes with
- * higher fitness rate have bigger chances to be chosen
+ * based on relative fitness, or on the rank of the
+ * fitness (see set_selection()). The chromosomes with
+ * higher fitness have bigger chances to be chosen
  */
 void select_parent(Group* grp);
 
 
+/*
+ * select parent process of a cellular group: each cell
+ * gets the fitter of two cells drawn from its
+ * neighbourhood, so no global fitness is needed
+ */
+void select_local(Group* grp);
+
+
 /*
  * crossover process that executes crossover of two
  * chromosomes after a randomly chosen bit position
@@ -82,11 +247,18 @@ void select_parent(Group* grp);
 void crossover(Group* grp);
 
 
+/*
+ * crossover of chromosomes i and i+1, the step of
+ * crossover() for a single pair
+ */
+void crossover_pair(Group* grp, int i);
+
+
 /*
  * select a bit from a gene segment of a chromosome
  * for the crossover process
  */
-void select_bit(int num_genes, int* gene_pos, int* bit_pos);
+void select_bit(Rng* rng, int num_genes, int* gene_pos, int* bit_pos);
 
 
 /*
@@ -97,6 +269,13 @@ void select_bit(int num_genes, int* gene_pos, int* bit_pos);
 void mutate(Group* grp);
 
 
+/*
+ * mutation of every bit of chromosome i, the step of
+ * mutate() for a single chromosome
+ */
+void mutate_chromo(Group* grp, int i);
+
+
 /*
  * free memories of the group and members
  */
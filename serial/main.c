@@ -5,13 +5,24 @@
  *
  * This file is for testing Prisoner's Dilemma game
  * using serial genetic algorithm.
+ *
+ * With -b the players are side A of a co-evolution
+ * with -b players of side B, see coevolve.h.
  *=====================================================*/
 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "alloc.h"
 #include "group.h"
 #include "prisoner_dilemma.h"
+#include "checkpoint.h"
+#include "stats.h"
+#include "prof.h"
+#include "stop.h"
+#include "coevolve.h"
 
 
 /*========== Function Prototype ==========*/
@@ -29,23 +40,50 @@ int main(int argc, char* argv[])
 	/* check arguments length */
 	int numArgv = 13;
 
-	if (numArgv != argc)
+	if (argc < numArgv || 0 == argc % 2)
 	{
 		print_usage();  // print usage and help info
 		exit (1);
 	}
 
 	/* get values from command line */
-	int num_genes;				// # of gene segments
-	int num_players;			// # of chromosomes/prisoners
-	int num_gen;					// # of generations
-	int num_iters;				// # of game iterations
-	double cross_rate;		// crossover rate
-	double mutate_rate;		// mutation rate
+	int num_genes = 0;		// # of gene segments
+	int num_players = 0;	// # of chromosomes/prisoners
+	int num_gen = 0;			// # of generations
+	int num_iters = 0;		// # of game iterations
+	double cross_rate = -1.0;		// crossover rate
+	double mutate_rate = -1.0;	// mutation rate
+	char* ckpt_path = NULL;			// snapshot file to write
+	char* restart_path = NULL;	// snapshot file to restart from
+	char* genes_path = NULL;		// genes of the first generation
+	int ckpt_every = 10;				// # of generations between snapshots
+	char* stats_path = NULL;		// file of per-generation statistics
+	int stats_format = STATS_CSV;	// format of the statistics file
+	char* prof_prefix = NULL;		// prefix of the timing report files
+	int numa_policy = NUMA_DEFAULT;	// placement of the big arrays
+	int huge_pages = 0;					// back the big arrays with huge pages
+	int num_opponents = 0;			// games per player, 0 = every pair
+	int fixed_schedule = 0;			// the same opponents every generation
+	int memory = DEFAULT_MEMORY;	// # of rounds a player remembers
+	int grid_width = 0;					// width of the torus, 0 = no grid
+	int select_mode = SELECT_ROULETTE;	// how parents are selected
+	double select_param = 0.0;	// pressure or share of the selection
+	int select_ok = 1;					// the selection could be read
+	char* payoff_text = NULL;		// payoffs R,S,T,P of the game
+	double payoffs[NUM_RULES];	// payoffs read from payoff_text
+	int num_rivals = 0;					// # of players of side B, 0 = no co-evolution
+	char* rival_text = NULL;		// payoffs R,S,T,P of side B
+	double rival_payoffs[NUM_RULES];	// payoffs read from rival_text
+	char* rival_stats = NULL;		// file of per-generation statistics of side B
+	int threads = 1;						// # of threads per side of a co-evolution
+	StopRule rule;							// when to end the run early
+	int reason = STOP_NONE;			// why the run ended
+
+	init_stop_rule(&rule);
 
 	// the order of arguments is arbitrary
 	int i, j;
-	for (i = 1; i < numArgv; i+=2)
+	for (i = 1; i < argc; i+=2)
 	{
 		if (0 == strcmp("-s",argv[i]))
 			num_genes = atoi(argv[i+1]);
@@ -59,6 +97,55 @@ int main(int argc, char* argv[])
 			cross_rate = atof(argv[i+1]);
 		else if (0 == strcmp("-m",argv[i]))
 			mutate_rate = atof(argv[i+1]);
+		else if (0 == strcmp("-k",argv[i]))
+			ckpt_path = argv[i+1];
+		else if (0 == strcmp("-n",argv[i]))
+			ckpt_every = atoi(argv[i+1]);
+		else if (0 == strcmp("-r",argv[i]))
+			restart_path = argv[i+1];
+		else if (0 == strcmp("-I",argv[i]))
+			genes_path = argv[i+1];
+		else if (0 == strcmp("-o",argv[i]))
+			stats_path = argv[i+1];
+		else if (0 == strcmp("-f",argv[i]) && 0 == strcmp("csv",argv[i+1]))
+			stats_format = STATS_CSV;
+		else if (0 == strcmp("-f",argv[i]) && 0 == strcmp("bin",argv[i+1]))
+			stats_format = STATS_BINARY;
+		else if (0 == strcmp("-P",argv[i]))
+			prof_prefix = argv[i+1];
+		else if (0 == strcmp("-N",argv[i]))
+			numa_policy = parse_numa_policy(argv[i+1]);
+		else if (0 == strcmp("-H",argv[i]))
+			huge_pages = atoi(argv[i+1]);
+		else if (0 == strcmp("-K",argv[i]))
+			num_opponents = atoi(argv[i+1]);
+		else if (0 == strcmp("-F",argv[i]))
+			fixed_schedule = atoi(argv[i+1]);
+		else if (0 == strcmp("-L",argv[i]))
+			select_ok = 0 == parse_selection(argv[i+1], &select_mode, &select_param);
+		else if (0 == strcmp("-C",argv[i]))
+			grid_width = atoi(argv[i+1]);
+		else if (0 == strcmp("-M",argv[i]))
+			memory = atoi(argv[i+1]);
+		else if (0 == strcmp("-R",argv[i]))
+			payoff_text = argv[i+1];
+		else if (0 == strcmp("-b",argv[i]))
+			num_rivals = atoi(argv[i+1]);
+		else if (0 == strcmp("-Q",argv[i]))
+			rival_text = argv[i+1];
+		else if (0 == strcmp("-O",argv[i]))
+			rival_stats = argv[i+1];
+		else if (0 == strcmp("-t",argv[i]))
+			threads = atoi(argv[i+1]);
+		else if (0 == strcmp("-T",argv[i]))
+		{
+			rule.use_target = 1;
+			rule.target = atof(argv[i+1]);
+		}
+		else if (0 == strcmp("-W",argv[i]))
+			rule.stall = atoi(argv[i+1]);
+		else if (0 == strcmp("-D",argv[i]))
+			rule.floor = atof(argv[i+1]);
 		else
 		{
 			print_usage();  // print usage and help info
@@ -66,11 +153,157 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	// all of the six game settings must be given
+	if (num_genes <= 0 || num_players <= 0 || num_gen <= 0 || num_iters <= 0 ||
+		cross_rate < 0.0 || mutate_rate < 0.0 || ckpt_every <= 0 || numa_policy < 0 ||
+		rule.stall < 0 || rule.floor < 0.0 || num_opponents < 0 ||
+		(num_opponents > 0 && 0 != num_players % 2) ||
+		(fixed_schedule && num_opponents >= num_players) ||
+		memory < 1 || memory > MAX_MEMORY || grid_width < 0 || !select_ok ||
+		(NULL != genes_path && NULL != restart_path) ||
+		(grid_width > 0 && SELECT_ROULETTE != select_mode) ||
+		(grid_width > 0 && (num_opponents > 0 || 0 != grid_width % 2 || grid_width < 4 ||
+		0 != num_players % grid_width || num_players / grid_width < 3)) ||
+		(NULL != payoff_text && 0 != parse_payoffs(payoff_text, payoffs)) ||
+		num_rivals < 0 || threads < 1 ||
+		(num_rivals > 0 && (0 != num_rivals % 2 || 0 != num_players % 2 || grid_width > 0 ||
+		num_opponents > 0 || NULL != genes_path || NULL != ckpt_path || NULL != restart_path)) ||
+		(NULL != rival_text && 0 != parse_payoffs(rival_text, rival_payoffs)))
+	{
+		print_usage();  // print usage and help info
+		exit (2);
+	}
+
+#ifndef PGA_PROF
+	if (NULL != prof_prefix)
+		fprintf(stderr, "-P ignored, timers are not compiled in (make PROF=1)\n");
+#endif
+
+	PROF_INIT(0);
+
+	init_alloc(numa_policy, huge_pages);
+
+	// the strategy table of 4^memory bits must fit
+	if ((long)num_genes * CHAR_LENGTH < 1L << (2 * memory))
+	{
+		fprintf(stderr, "-M %d needs -s %d or more\n", memory,
+			(int)((1L << (2 * memory)) + CHAR_LENGTH - 1) / CHAR_LENGTH);
+		exit (2);
+	}
+
 	/* Prisoner's Dilemma Game */
-	Group* players = init_group(num_genes, num_players, cross_rate, mutate_rate);
+	// seeded from rand() like init_group()
+	uint64_t seed = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
 
-	// run for num_gen generations
-	for (i = 0; i < num_gen; i++)
+	/* Co-evolution of two sides */
+	if (num_rivals > 0)
+	{
+		uint64_t rival_seed = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+		Group* sides[COEV_SIDES];
+		StatsSink* sinks[COEV_SIDES] = {NULL, NULL};
+		const char* paths[COEV_SIDES] = {stats_path, rival_stats};
+		int side;
+
+		sides[0] = init_rival_group(num_genes, num_players, num_rivals, cross_rate, mutate_rate,
+			memory, seed);
+		sides[1] = init_rival_group(num_genes, num_rivals, num_players, cross_rate, mutate_rate,
+			memory, rival_seed);
+
+		// side B plays by -R too unless -Q is given
+		if (NULL != payoff_text)
+			set_payoffs(sides[0], payoffs);
+		if (NULL != rival_text)
+			set_payoffs(sides[1], rival_payoffs);
+		else if (NULL != payoff_text)
+			set_payoffs(sides[1], payoffs);
+
+		for (side = 0; side < COEV_SIDES; side++)
+		{
+			if (SELECT_ROULETTE != select_mode)
+				set_selection(sides[side], select_mode, select_param);
+
+			if (NULL != paths[side])
+			{
+				sinks[side] = init_stats_sink(paths[side], stats_format);
+				if (NULL == sinks[side])
+					exit (3);
+			}
+
+			// the diversity floor needs the bit counts
+			sides[side]->diversity_on = NULL != paths[side] || rule.floor > 0.0;
+		}
+
+		Coevolution* co = init_coevolution(sides[0], sides[1], num_iters, threads);
+
+		reason = run_coevolution(co, num_gen, sinks, &rule, &side);
+		if (STOP_NONE != reason)
+			fprintf(stderr, "stopped at generation %d: %s of side %c\n", sides[side]->generation,
+				stop_name(reason), 'A' + side);
+
+		free_coevolution(co);
+
+		for (side = 0; side < COEV_SIDES; side++)
+		{
+			if (NULL != sinks[side])
+				free_stats_sink(sinks[side]);
+			free_group(sides[side]);
+		}
+
+		if (NULL != prof_prefix)
+			PROF_REPORT(prof_prefix);
+
+		return 0;
+	}
+
+	Group* players;
+	if (grid_width > 0)
+		players = init_cellular_group(num_genes, num_players, cross_rate, mutate_rate, grid_width,
+			memory, seed);
+	else
+		players = init_tournament_group(num_genes, num_players, cross_rate, mutate_rate,
+			num_opponents, fixed_schedule, memory, seed);
+
+	// the genes of the first generation from a file
+	if (NULL != genes_path && 0 != load_genes(players, genes_path))
+	{
+		free_group(players);
+		exit (3);
+	}
+
+	if (NULL != payoff_text)
+		set_payoffs(players, payoffs);
+
+	if (SELECT_ROULETTE != select_mode)
+		set_selection(players, select_mode, select_param);
+	Checkpointer* ckpt = NULL;
+	StatsSink* sink = NULL;
+
+	// continue from the generation stored in the snapshot
+	if (NULL != restart_path && 0 != load_checkpoint(restart_path, players))
+	{
+		free_group(players);
+		exit (3);
+	}
+
+	if (NULL != ckpt_path)
+		ckpt = init_checkpointer(ckpt_path, players);
+
+	if (NULL != stats_path)
+	{
+		sink = init_stats_sink(stats_path, stats_format);
+		if (NULL == sink)
+			exit (3);
+
+		players->diversity_on = 1;
+	}
+
+	// the diversity floor needs the bit counts
+	if (rule.floor > 0.0)
+		players->diversity_on = 1;
+
+	// run until num_gen generations have been evolved or
+	// a stopping rule ends the run
+	while (players->generation < num_gen)
 	{
 		// play PD game for num_iters times
 		for (j = 0; j < num_iters; j++)
@@ -79,9 +312,50 @@ int main(int argc, char* argv[])
 		}
 
 		update_fit_rate(players);
+
+		if (NULL != sink)
+			push_stats(sink, &players->stats);
+
+		reason = check_stop(&rule, &players->stats);
+		if (STOP_NONE != reason)
+			break;
+
 		evolve(players);
+
+		if (NULL != ckpt && 0 == players->generation % ckpt_every)
+		{
+			PROF_BEGIN(PROF_CHECKPOINT);
+			save_checkpoint(ckpt, players);
+			PROF_END(PROF_CHECKPOINT);
+		}
 	}
 
+	if (STOP_NONE != reason)
+		fprintf(stderr, "stopped at generation %d: %s\n", players->generation, stop_name(reason));
+
+	if (NULL != ckpt)
+	{
+		// always leave a snapshot of the final generation,
+		// also when its save was skipped while busy
+		if (ckpt->saved_gen != players->generation)
+		{
+			sync_checkpoint(ckpt);
+			save_checkpoint(ckpt, players);
+		}
+
+		if (ckpt->num_skipped > 0)
+			fprintf(stderr, "%ld snapshots skipped while the writer was busy\n",
+				ckpt->num_skipped);
+
+		free_checkpointer(ckpt);
+	}
+
+	if (NULL != sink)
+		free_stats_sink(sink);
+
+	if (NULL != prof_prefix)
+		PROF_REPORT(prof_prefix);
+
 	free_group(players);
 
 	return 0;
@@ -101,5 +375,41 @@ void print_usage(void)
 	printf("    -i  # of iterations, e.g. 50\n");
 	printf("    -c  crossover rate, very high, e.g. >=0.95\n");
 	printf("    -m  mutation rate, very low, e.g. <=0.001\n");
+	printf("    -k  optional snapshot file written during the run\n");
+	printf("    -n  optional # of generations between snapshots, default 10\n");
+	printf("    -r  optional snapshot file to restart the run from\n");
+	printf("    -I  optional file of the genes of the first generation,\n");
+	printf("        -p times -s raw bytes, one player after another\n");
+	printf("    -o  optional file of per-generation statistics\n");
+	printf("    -f  optional format of the statistics file, csv or bin\n");
+	printf("    -P  optional prefix of the timing report, needs make PROF=1\n");
+	printf("    -N  optional NUMA placement of the population and history,\n");
+	printf("        default, local or interleave; default is default\n");
+	printf("    -H  optional 1 to back them with 2 MB huge pages, default 0\n");
+	printf("    -K  optional # of games of a player per generation against\n");
+	printf("        sampled opponents, default 0 (every pair plays)\n");
+	printf("    -F  optional 1 to meet the same -K opponents every generation\n");
+	printf("    -L  optional selection: roulette, rank[:s] with pressure\n");
+	printf("        s in [1, 2], default 1.5, or truncation[:f] from the\n");
+	printf("        fittest share f, default 0.5; default roulette\n");
+	printf("    -C  optional width of a torus grid of the players, who\n");
+	printf("        only play and breed with their 4 neighbours; even,\n");
+	printf("        at least 4, and -p a multiple with 3 rows or more\n");
+	printf("    -M  optional # of rounds a player remembers, 1 to %d, default %d;\n",
+		MAX_MEMORY, DEFAULT_MEMORY);
+	printf("        needs 4^M bits of genes, e.g. -M 3 -s 8\n");
+	printf("    -R  optional payoffs R,S,T,P of the game, default 3,0,5,1\n");
+	printf("    -b  optional # of players of side B; co-evolve the -p players\n");
+	printf("        as side A with them, each side scored against every player\n");
+	printf("        of the other; both even, not with -C, -K, -I, -k or -r\n");
+	printf("    -Q  optional payoffs R,S,T,P of side B, default those of -R\n");
+	printf("    -O  optional file of per-generation statistics of side B,\n");
+	printf("        -o is the one of side A\n");
+	printf("    -t  optional # of threads per side of -b, default 1\n");
+	printf("    -T  optional target fitness, stop once the best reaches it\n");
+	printf("    -W  optional stall window, stop after that many generations\n");
+	printf("        without a better best fitness, default 0 (off)\n");
+	printf("    -D  optional diversity floor in [0, 1], stop once the mean\n");
+	printf("        per-bit diversity is below it, default 0 (off)\n");
 }
 
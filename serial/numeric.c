@@ -0,0 +1,303 @@
+/*=====================================================
+ * numeric.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the numeric.h header file.
+ *
+ * Every operator copies the values into double arrays,
+ * works on the arrays and writes them back clamped to
+ * the range, so the loops are the same for all three
+ * encodings and have no branches in their bodies.
+ *=====================================================*/
+
+
+#include <stdlib.h>
+#include <math.h>
+#include "numeric.h"
+
+
+#define TWO_PI 6.283185307179586	// 2 * pi
+
+
+/*========== Function Definition ==========*/
+/*
+ * alloc a genome of num_dims values in [lower, upper],
+ * with BLX-0.5 and Gaussian mutation of sigma 0.1;
+ * returns NULL on a bad encoding or range
+ */
+Genome* init_genome(int encoding, int num_dims, double lower, double upper)
+{
+	if (encoding < GENOME_F32 || encoding > GENOME_INT || num_dims <= 0 || !(lower < upper))
+		return NULL;
+
+	Genome* genome = (Genome*)malloc(sizeof(Genome));
+
+	genome->encoding = encoding;
+	genome->num_dims = num_dims;
+	genome->value_size = GENOME_F64 == encoding ? sizeof(double) :
+		GENOME_F32 == encoding ? sizeof(float) : sizeof(int32_t);
+	genome->lower = lower;
+	genome->upper = upper;
+	genome->cross_op = CROSS_BLX;
+	genome->cross_param = 0.5;
+	genome->mutate_op = MUTATE_GAUSS;
+	genome->mutate_param = 0.1;
+	genome->x = (double*)malloc(num_dims * sizeof(double));
+	genome->y = (double*)malloc(num_dims * sizeof(double));
+	genome->u = (double*)malloc(3 * num_dims * sizeof(double));
+
+	return genome;
+}
+
+
+/*
+ * # of gene bytes of a chromosome of the genome
+ */
+int genome_bytes(const Genome* genome)
+{
+	return genome->num_dims * genome->value_size;
+}
+
+
+/*
+ * copy the values of genes to out, only use this
+ * function inside this file
+ */
+static void load_values(const Genome* genome, const unsigned char* genes, double* restrict out)
+{
+	int d, n = genome->num_dims;
+
+	if (GENOME_F32 == genome->encoding)
+	{
+		const float* v = (const float*)genes;
+		for (d = 0; d < n; d++)
+			out[d] = v[d];
+	}
+	else if (GENOME_F64 == genome->encoding)
+	{
+		const double* v = (const double*)genes;
+		for (d = 0; d < n; d++)
+			out[d] = v[d];
+	}
+	else
+	{
+		const int32_t* v = (const int32_t*)genes;
+		for (d = 0; d < n; d++)
+			out[d] = v[d];
+	}
+}
+
+
+/*
+ * write in back to genes, clamped to the range and
+ * rounded for integers, only use this function inside
+ * this file
+ */
+static void store_values(const Genome* genome, double* restrict in, unsigned char* genes)
+{
+	int d, n = genome->num_dims;
+	double lower = genome->lower;
+	double upper = genome->upper;
+
+	for (d = 0; d < n; d++)
+		in[d] = fmin(fmax(in[d], lower), upper);
+
+	if (GENOME_F32 == genome->encoding)
+	{
+		float* v = (float*)genes;
+		for (d = 0; d < n; d++)
+			v[d] = (float)in[d];
+	}
+	else if (GENOME_F64 == genome->encoding)
+	{
+		double* v = (double*)genes;
+		for (d = 0; d < n; d++)
+			v[d] = in[d];
+	}
+	else
+	{
+		int32_t* v = (int32_t*)genes;
+		for (d = 0; d < n; d++)
+			v[d] = (int32_t)floor(in[d] + 0.5);
+	}
+}
+
+
+/*
+ * fill the first n uniform draws in [0, 1), only use
+ * this function inside this file
+ */
+static void draw_uniforms(Genome* genome, Rng* rng, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		genome->u[i] = rng_uniform(rng);
+	}
+}
+
+
+/*
+ * fill genes with values drawn uniformly from the range
+ */
+void random_values(Genome* genome, Rng* rng, unsigned char* genes)
+{
+	int d, n = genome->num_dims;
+	double* restrict x = genome->x;
+	const double* restrict u = genome->u;
+
+	// integers take each of the upper - lower + 1 values
+	double lower = genome->lower;
+	double width = genome->upper - lower;
+	if (GENOME_INT == genome->encoding)
+	{
+		lower -= 0.5;
+		width += 1.0;
+	}
+
+	draw_uniforms(genome, rng, n);
+	for (d = 0; d < n; d++)
+		x[d] = lower + u[d] * width;
+
+	store_values(genome, x, genes);
+}
+
+
+/*
+ * crossover of the values of two chromosomes
+ */
+void cross_values(Genome* genome, Rng* rng, unsigned char* genes1, unsigned char* genes2)
+{
+	int d, n = genome->num_dims;
+	double* restrict x = genome->x;
+	double* restrict y = genome->y;
+	const double* restrict u = genome->u;
+
+	load_values(genome, genes1, x);
+	load_values(genome, genes2, y);
+	draw_uniforms(genome, rng, 2 * n);
+
+	if (CROSS_BLX == genome->cross_op)
+	{
+		// each child value is uniform in the interval of
+		// the parents, widened by alpha of its width
+		double alpha = genome->cross_param;
+		for (d = 0; d < n; d++)
+		{
+			double lo = x[d] < y[d] ? x[d] : y[d];
+			double width = fabs(x[d] - y[d]);
+			double base = lo - alpha * width;
+			double span = (1.0 + 2.0 * alpha) * width;
+
+			x[d] = base + u[d] * span;
+			y[d] = base + u[n + d] * span;
+		}
+	}
+	else
+	{
+		// the spread beta has the polynomial density of
+		// SBX, the children keep the mean of the parents
+		double power = 1.0 / (genome->cross_param + 1.0);
+		for (d = 0; d < n; d++)
+		{
+			double v = u[d];
+			double low = pow(2.0 * v, power);
+			double high = pow(1.0 / (2.0 * (1.0 - v)), power);
+			double beta = v <= 0.5 ? low : high;
+			double a = x[d];
+			double b = y[d];
+
+			x[d] = 0.5 * ((1.0 + beta) * a + (1.0 - beta) * b);
+			y[d] = 0.5 * ((1.0 - beta) * a + (1.0 + beta) * b);
+		}
+	}
+
+	store_values(genome, x, genes1);
+	store_values(genome, y, genes2);
+}
+
+
+/*
+ * mutation of the values of a chromosome, each one with
+ * probability rate
+ */
+void mutate_values(Genome* genome, Rng* rng, double rate, unsigned char* genes)
+{
+	int d, n = genome->num_dims;
+	double* restrict x = genome->x;
+	const double* restrict u = genome->u;
+	double width = genome->upper - genome->lower;
+
+	// nothing is picked, and the loops below need no
+	// guard against it
+	if (rate <= 0.0)
+		return;
+
+	load_values(genome, genes, x);
+
+	if (MUTATE_GAUSS == genome->mutate_op)
+	{
+		// u[d] picks the values to mutate, u[n + d] and
+		// u[2n + d] give the radius and angle of the step;
+		// every value gets a step and the ones not picked
+		// get a step of 0
+		draw_uniforms(genome, rng, 3 * n);
+
+		double sigma = genome->mutate_param * width;
+		for (d = 0; d < n; d++)
+		{
+			double pick = u[d] < rate;
+			double radius = sqrt(-2.0 * log(1.0 - u[n + d]));
+			double z = radius * cos(TWO_PI * u[2 * n + d]);
+
+			x[d] += pick * sigma * z;
+		}
+	}
+	else
+	{
+		// u[d] picks, u[n + d] gives the size of the step
+		draw_uniforms(genome, rng, 2 * n);
+
+		double power = 1.0 / (genome->mutate_param + 1.0);
+		for (d = 0; d < n; d++)
+		{
+			double pick = u[d] < rate;
+			double v = u[n + d];
+			double low = pow(2.0 * v, power) - 1.0;
+			double high = 1.0 - pow(2.0 * (1.0 - v), power);
+			double delta = v < 0.5 ? low : high;
+
+			x[d] += pick * delta * width;
+		}
+	}
+
+	store_values(genome, x, genes);
+}
+
+
+/*
+ * value d of a chromosome as a double
+ */
+double genome_value(const Genome* genome, const unsigned char* genes, int d)
+{
+	if (GENOME_F32 == genome->encoding)
+		return ((const float*)genes)[d];
+	if (GENOME_F64 == genome->encoding)
+		return ((const double*)genes)[d];
+
+	return ((const int32_t*)genes)[d];
+}
+
+
+/*
+ * free memories of the genome
+ */
+void free_genome(Genome* genome)
+{
+	free(genome->x);
+	free(genome->y);
+	free(genome->u);
+	free(genome);
+}
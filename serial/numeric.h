@@ -0,0 +1,113 @@
+/*=====================================================
+ * numeric.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares typed genomes: vectors of
+ * float32, float64 or bounded int32 values stored in the
+ * gene bytes of a chromosome, so the genes of a group
+ * stay one contiguous arena and a fitness function reads
+ * them in place (cast the genes to float*, double* or
+ * int32_t*) instead of decoding bits.
+ *
+ * Operators:
+ * 1) crossover  BLX-alpha (blend) or SBX (simulated
+ *               binary) over every value of a pair
+ * 2) mutation   Gaussian or polynomial, each value with
+ *               the probability of the mutation rate
+ * Every value is kept in [lower, upper].
+ *
+ * An operator draws all of its random numbers for a
+ * chromosome first, then works on whole chromosomes
+ * with branch-free loops over arrays, which the compiler
+ * turns into SIMD code.
+ *=====================================================*/
+
+
+#ifndef NUMERIC_H_
+#define NUMERIC_H_
+
+
+#include <stdint.h>
+#include "rng.h"
+
+
+#define GENOME_F32 1			// float values
+#define GENOME_F64 2			// double values
+#define GENOME_INT 3			// int32_t values
+
+#define CROSS_BLX 0				// blend crossover, BLX-alpha
+#define CROSS_SBX 1				// simulated binary crossover
+#define MUTATE_GAUSS 0		// add Gaussian noise
+#define MUTATE_POLY 1			// polynomial mutation
+
+
+/*============ Type Definition ============*/
+/*
+ * encoding and operators of a typed genome
+ */
+typedef struct
+{
+	int encoding;				// GENOME_F32, GENOME_F64 or GENOME_INT
+	int num_dims;				// # of values of a genome
+	int value_size;			// bytes of a value
+	double lower;				// lowest value
+	double upper;				// highest value
+	int cross_op;				// CROSS_BLX or CROSS_SBX
+	double cross_param;	// alpha of BLX, eta of SBX
+	int mutate_op;			// MUTATE_GAUSS or MUTATE_POLY
+	double mutate_param;	// sigma of Gauss as a fraction of
+											// upper - lower, eta of the polynomial
+	double* x;					// values of the first chromosome
+	double* y;					// values of the second chromosome
+	double* u;					// uniform draws, up to 3 per value
+}Genome;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * alloc a genome of num_dims values in [lower, upper],
+ * with BLX-0.5 and Gaussian mutation of sigma 0.1;
+ * returns NULL on a bad encoding or range
+ */
+Genome* init_genome(int encoding, int num_dims, double lower, double upper);
+
+
+/*
+ * # of gene bytes of a chromosome of the genome
+ */
+int genome_bytes(const Genome* genome);
+
+
+/*
+ * fill genes with values drawn uniformly from the range
+ */
+void random_values(Genome* genome, Rng* rng, unsigned char* genes);
+
+
+/*
+ * crossover of the values of two chromosomes
+ */
+void cross_values(Genome* genome, Rng* rng, unsigned char* genes1, unsigned char* genes2);
+
+
+/*
+ * mutation of the values of a chromosome, each one with
+ * probability rate
+ */
+void mutate_values(Genome* genome, Rng* rng, double rate, unsigned char* genes);
+
+
+/*
+ * value d of a chromosome as a double
+ */
+double genome_value(const Genome* genome, const unsigned char* genes, int d);
+
+
+/*
+ * free memories of the genome
+ */
+void free_genome(Genome* genome);
+
+
+#endif
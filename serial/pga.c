@@ -0,0 +1,312 @@
+/*=====================================================
+ * pga.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the pga.h header file.
+ *=====================================================*/
+
+
+#include <string.h>
+#include "pga.h"
+#include "group.h"
+#include "stop.h"
+
+
+#define PGA_MAX_BYTES 2147483647LL	// most gene bytes of a group, its offsets are ints
+
+
+/*============ Type Definition ============*/
+/*
+ * state of an engine
+ */
+struct PgaEngine
+{
+	Group* grp;							// population and random stream
+	PgaFitness fitness;			// fitness function, NULL for OneMax
+	void* ctx;							// argument of fitness
+	StopRule rule;					// when pga_step() ends early
+	int stopped;						// a stopping rule has fired
+	int evaluated;					// the group has fitness values
+	int has_best;						// best_genes is filled in
+	double best;						// best fitness evaluated so far
+	unsigned char* best_genes;	// genome of the best
+};
+
+
+/*========== Function Definition ==========*/
+/*
+ * # of 1 bits of a genome, the default fitness, only use
+ * this function inside this file
+ */
+static double count_ones(void* ctx, const unsigned char* genes, int num_genes)
+{
+	int i, ones = 0;
+
+	(void)ctx;
+
+	for (i = 0; i < num_genes; i++)
+	{
+		ones += __builtin_popcount(genes[i]);
+	}
+
+	return (double)ones;
+}
+
+
+/*
+ * evaluate every chromosome, update the statistics and
+ * keep the best genome, only use this function inside
+ * this file
+ */
+static void evaluate_group(PgaEngine* engine)
+{
+	Group* grp = engine->grp;
+	PgaFitness fitness = NULL != engine->fitness ? engine->fitness : count_ones;
+	int i;
+
+	for (i = 0; i < grp->num_chrs; i++)
+	{
+		Chromo* chr = grp->chrs[i];
+
+		chr->fitness = fitness(engine->ctx, chr->genes, grp->num_genes);
+		if (!engine->has_best || chr->fitness > engine->best)
+		{
+			engine->has_best = 1;
+			engine->best = chr->fitness;
+			memcpy(engine->best_genes, chr->genes, grp->num_genes);
+		}
+	}
+
+	update_fit_rate(grp);
+	engine->evaluated = 1;
+}
+
+
+/*
+ * wrap a group in an engine, only use this function
+ * inside this file
+ */
+static PgaEngine* new_engine(Group* grp)
+{
+	PgaEngine* engine = (PgaEngine*)malloc(sizeof(PgaEngine));
+
+	engine->grp = grp;
+	engine->fitness = NULL;
+	engine->ctx = NULL;
+	init_stop_rule(&engine->rule);
+	engine->stopped = 0;
+	engine->evaluated = 0;
+	engine->has_best = 0;
+	engine->best = 0.0;
+	engine->best_genes = (unsigned char*)malloc(grp->num_genes * sizeof(unsigned char));
+
+	return engine;
+}
+
+
+/*
+ * create an engine of num_chrs random genomes (even,
+ * >= 2) of num_genes bytes each, drawing from the random
+ * stream seed; it counts 1 bits (OneMax) until a fitness
+ * is set. Returns NULL on bad arguments, also if the
+ * genes would take 2 GB or more
+ */
+PgaEngine* pga_create(int num_genes, int num_chrs, uint64_t seed)
+{
+	if (num_genes <= 0 || num_chrs < 2 || 0 != num_chrs % 2 ||
+		(long long)num_chrs * num_genes > PGA_MAX_BYTES)
+		return NULL;
+
+	return new_engine(init_plain_group(num_genes, num_chrs, 0.95, 0.001, seed));
+}
+
+
+/*
+ * create an engine of num_chrs random vectors of
+ * num_dims values of encoding (GENOME_F32, GENOME_F64
+ * or GENOME_INT) in [lower, upper]; its mutation rate is
+ * per value. Returns NULL on bad arguments, also if the
+ * genes would take 2 GB or more
+ */
+PgaEngine* pga_create_numeric(int encoding, int num_dims, double lower, double upper,
+	int num_chrs, uint64_t seed)
+{
+	// the genome keeps 3 doubles of scratch per value
+	if (num_chrs < 2 || 0 != num_chrs % 2 ||
+		(long long)num_dims * 3 * sizeof(double) > PGA_MAX_BYTES)
+		return NULL;
+
+	Genome* genome = init_genome(encoding, num_dims, lower, upper);
+	if (NULL == genome)
+		return NULL;
+
+	if ((long long)num_chrs * genome_bytes(genome) > PGA_MAX_BYTES)
+	{
+		free_genome(genome);
+		return NULL;
+	}
+
+	return new_engine(init_numeric_group(genome, num_chrs, 0.95, 0.1, seed));
+}
+
+
+/*
+ * choose the operators of a numeric engine: cross_op
+ * CROSS_BLX (param alpha) or CROSS_SBX (param eta),
+ * mutate_op MUTATE_GAUSS (param sigma as a fraction of
+ * the range) or MUTATE_POLY (param eta); returns 1 if
+ * the engine is not numeric
+ */
+int pga_set_numeric_operators(PgaEngine* engine, int cross_op, double cross_param,
+	int mutate_op, double mutate_param)
+{
+	Genome* genome = engine->grp->genome;
+
+	if (NULL == genome)
+		return 1;
+
+	genome->cross_op = cross_op;
+	genome->cross_param = cross_param;
+	genome->mutate_op = mutate_op;
+	genome->mutate_param = mutate_param;
+
+	return 0;
+}
+
+
+/*
+ * set the crossover and mutation rates of the
+ * operators, 0.95 and 0.001 by default
+ */
+void pga_set_operators(PgaEngine* engine, double cross_rate, double mutate_rate)
+{
+	engine->grp->cross_rate = cross_rate;
+	engine->grp->mutate_rate = mutate_rate;
+}
+
+
+/*
+ * select parents by linear ranking of pressure param in
+ * [1, 2] (PGA_SELECT_RANK), uniformly from the fittest
+ * param share (PGA_SELECT_TRUNCATION), or by roulette
+ * (PGA_SELECT_ROULETTE, the default); returns 0, or -1
+ * on a bad mode or param
+ */
+int pga_set_selection(PgaEngine* engine, int mode, double param)
+{
+	if (PGA_SELECT_RANK == mode ? !(param >= 1.0 && param <= 2.0) :
+		PGA_SELECT_TRUNCATION == mode ? !(param > 0.0 && param <= 1.0) :
+		PGA_SELECT_ROULETTE != mode)
+		return -1;
+
+	set_selection(engine->grp, mode, param);
+	return 0;
+}
+
+
+/*
+ * set the fitness function and its context
+ */
+void pga_set_fitness(PgaEngine* engine, PgaFitness fitness, void* ctx)
+{
+	engine->fitness = fitness;
+	engine->ctx = ctx;
+	engine->evaluated = 0;
+	engine->has_best = 0;
+}
+
+
+/*
+ * end pga_step() early once the best fitness reaches
+ * target (use_target set), after stall generations
+ * without improvement (> 0), or once the diversity is
+ * below floor (> 0); see stop.h
+ */
+void pga_set_stop(PgaEngine* engine, int use_target, double target, int stall, double floor)
+{
+	init_stop_rule(&engine->rule);
+	engine->rule.use_target = use_target;
+	engine->rule.target = target;
+	engine->rule.stall = stall;
+	engine->rule.floor = floor;
+	engine->stopped = 0;
+
+	// the diversity floor needs the bit counts
+	engine->grp->diversity_on = floor > 0.0;
+}
+
+
+/*
+ * evaluate and evolve up to n generations, return the
+ * # of generations evolved, less than n if a stopping
+ * rule ended the run
+ */
+int pga_step(PgaEngine* engine, int n)
+{
+	int i;
+
+	for (i = 0; i < n && !engine->stopped; i++)
+	{
+		if (!engine->evaluated)
+			evaluate_group(engine);
+
+		if (STOP_NONE != check_stop(&engine->rule, &engine->grp->stats))
+		{
+			engine->stopped = 1;
+			break;
+		}
+
+		evolve(engine->grp);
+		engine->evaluated = 0;
+	}
+
+	// leave the statistics of the newest generation
+	if (!engine->evaluated)
+		evaluate_group(engine);
+
+	return i;
+}
+
+
+/*
+ * best fitness evaluated so far, its genome is copied to
+ * genes (num_genes bytes) unless NULL
+ */
+double pga_best(const PgaEngine* engine, unsigned char* genes)
+{
+	if (NULL != genes)
+		memcpy(genes, engine->best_genes, engine->grp->num_genes);
+
+	return engine->best;
+}
+
+
+/*
+ * statistics of the last generation evaluated
+ */
+const GenStats* pga_stats(const PgaEngine* engine)
+{
+	return &engine->grp->stats;
+}
+
+
+/*
+ * # of generations evolved so far
+ */
+int pga_generation(const PgaEngine* engine)
+{
+	return engine->grp->generation;
+}
+
+
+/*
+ * free the engine and everything it owns
+ */
+void pga_destroy(PgaEngine* engine)
+{
+	free_group(engine->grp);
+	free(engine->best_genes);
+	free(engine);
+}
@@ -0,0 +1,163 @@
+/*=====================================================
+ * pga.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file is the C API of libpga, the genetic
+ * algorithm of this folder as a library ("make lib"
+ * builds libpga.a and libpga.so).
+ *
+ * An engine owns everything a run needs: its group,
+ * random stream, buffers, statistics and stopping rules.
+ * No engine touches global state, so engines can be
+ * created, stepped and freed on any threads at the
+ * same time without locks; a single engine must only be
+ * used by one thread at a time.
+ *
+ *     PgaEngine* e = pga_create(4, 64, 42);
+ *     pga_set_fitness(e, my_fitness, my_ctx);
+ *     pga_step(e, 100);
+ *     double best = pga_best(e, genes);
+ *     pga_destroy(e);
+ *
+ * pga_create_numeric() makes an engine of float, double
+ * or bounded integer vectors instead (see numeric.h);
+ * its fitness function casts the genes to the type.
+ *
+ * The numeric operators call the vector math of glibc,
+ * so a program links either library with its math and
+ * thread libraries, e.g.
+ *
+ *     gcc -o app app.c libpga.a -lm -lmvec -lpthread
+ *     gcc -o app app.c -L. -lpga -lm -lmvec -lpthread
+ *=====================================================*/
+
+
+#ifndef PGA_H_
+#define PGA_H_
+
+
+#include <stdint.h>
+#include "stats.h"
+#include "numeric.h"
+
+
+#define PGA_SELECT_ROULETTE 0		// fitness-proportional selection
+#define PGA_SELECT_RANK 1				// linear ranking selection
+#define PGA_SELECT_TRUNCATION 2	// uniform among the fittest
+
+
+/*============ Type Definition ============*/
+/*
+ * fitness of a genome of num_genes bytes, must be >= 0
+ * unless the selection is by rank or truncation;
+ * ctx is the pointer given to pga_set_fitness()
+ */
+typedef double (*PgaFitness)(void* ctx, const unsigned char* genes, int num_genes);
+
+
+/*
+ * an engine, only used through the functions below
+ */
+typedef struct PgaEngine PgaEngine;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * create an engine of num_chrs random genomes (even,
+ * >= 2) of num_genes bytes each, drawing from the random
+ * stream seed; it counts 1 bits (OneMax) until a fitness
+ * is set. Returns NULL on bad arguments, also if the
+ * genes would take 2 GB or more
+ */
+PgaEngine* pga_create(int num_genes, int num_chrs, uint64_t seed);
+
+
+/*
+ * create an engine of num_chrs random vectors of
+ * num_dims values of encoding (GENOME_F32, GENOME_F64
+ * or GENOME_INT) in [lower, upper]; its mutation rate is
+ * per value. Returns NULL on bad arguments, also if the
+ * genes would take 2 GB or more
+ */
+PgaEngine* pga_create_numeric(int encoding, int num_dims, double lower, double upper,
+	int num_chrs, uint64_t seed);
+
+
+/*
+ * choose the operators of a numeric engine: cross_op
+ * CROSS_BLX (param alpha) or CROSS_SBX (param eta),
+ * mutate_op MUTATE_GAUSS (param sigma as a fraction of
+ * the range) or MUTATE_POLY (param eta); returns 1 if
+ * the engine is not numeric
+ */
+int pga_set_numeric_operators(PgaEngine* engine, int cross_op, double cross_param,
+	int mutate_op, double mutate_param);
+
+
+/*
+ * set the crossover and mutation rates of the
+ * operators, 0.95 and 0.001 by default
+ */
+void pga_set_operators(PgaEngine* engine, double cross_rate, double mutate_rate);
+
+
+/*
+ * select parents by linear ranking of pressure param in
+ * [1, 2] (PGA_SELECT_RANK), uniformly from the fittest
+ * param share (PGA_SELECT_TRUNCATION), or by roulette
+ * (PGA_SELECT_ROULETTE, the default); returns 0, or -1
+ * on a bad mode or param
+ */
+int pga_set_selection(PgaEngine* engine, int mode, double param);
+
+
+/*
+ * set the fitness function and its context
+ */
+void pga_set_fitness(PgaEngine* engine, PgaFitness fitness, void* ctx);
+
+
+/*
+ * end pga_step() early once the best fitness reaches
+ * target (use_target set), after stall generations
+ * without improvement (> 0), or once the diversity is
+ * below floor (> 0); see stop.h
+ */
+void pga_set_stop(PgaEngine* engine, int use_target, double target, int stall, double floor);
+
+
+/*
+ * evaluate and evolve up to n generations, return the
+ * # of generations evolved, less than n if a stopping
+ * rule ended the run
+ */
+int pga_step(PgaEngine* engine, int n);
+
+
+/*
+ * best fitness evaluated so far, its genome is copied to
+ * genes (num_genes bytes) unless NULL
+ */
+double pga_best(const PgaEngine* engine, unsigned char* genes);
+
+
+/*
+ * statistics of the last generation evaluated
+ */
+const GenStats* pga_stats(const PgaEngine* engine);
+
+
+/*
+ * # of generations evolved so far
+ */
+int pga_generation(const PgaEngine* engine);
+
+
+/*
+ * free the engine and everything it owns
+ */
+void pga_destroy(PgaEngine* engine);
+
+
+#endif
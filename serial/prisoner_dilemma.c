@@ -9,69 +9,182 @@
 
 
 #include "prisoner_dilemma.h"
+#include "prof.h"
 
 
 /*========== Function Definition ==========*/
 /*
- * every two prisoners play against each other
+ * draw the pairs of the games of a tournament: k
+ * perfect matchings of the players, only use this
+ * function inside this file
+ *
+ * In a cellular group they are the edges of the grid.
+ * With a fixed schedule they are the first k rounds of
+ * the circle method, so every player meets k different
+ * opponents and the same ones every generation. Else
+ * each matching pairs up a random order of the players,
+ * and the new games start from a random history.
+ */
+static void draw_pairs(Group* grp)
+{
+	int n = grp->num_chrs;
+	int half = n / 2;
+	int r, j, p = 0;
+
+	// a cellular group plays the edges of its grid, the
+	// east and the south one of every cell
+	if (grp->grid_width > 0)
+	{
+		for (j = 0; j < n; j++)
+		{
+			grp->pairs[2 * p] = j;
+			grp->pairs[2 * p + 1] = grid_neighbour(grp, j, GRID_EAST);
+			p++;
+			grp->pairs[2 * p] = j;
+			grp->pairs[2 * p + 1] = grid_neighbour(grp, j, GRID_SOUTH);
+			p++;
+		}
+
+		grp->paired_gen = grp->generation;
+		return;
+	}
+
+	for (r = 0; r < grp->num_opponents; r++)
+	{
+		if (grp->fixed_schedule)
+		{
+			// player n-1 stays, the others turn around it
+			int m = n - 1;
+			grp->pairs[2 * p] = r;
+			grp->pairs[2 * p + 1] = m;
+			p++;
+
+			for (j = 1; j < half; j++)
+			{
+				grp->pairs[2 * p] = (r + j) % m;
+				grp->pairs[2 * p + 1] = (r - j + m) % m;
+				p++;
+			}
+			continue;
+		}
+
+		// Fisher-Yates shuffle, then pair neighbours
+		for (j = 0; j < n; j++)
+		{
+			grp->order[j] = j;
+		}
+		for (j = n - 1; j > 0; j--)
+		{
+			int k = rng_below(&grp->rng, j + 1);
+			int tmp = grp->order[j];
+			grp->order[j] = grp->order[k];
+			grp->order[k] = tmp;
+		}
+		for (j = 0; j < half; j++)
+		{
+			grp->pairs[2 * p] = grp->order[2 * j];
+			grp->pairs[2 * p + 1] = grp->order[2 * j + 1];
+			p++;
+		}
+	}
+
+	if (!grp->fixed_schedule)
+	{
+		for (p = 0; p < grp->num_rounds; p++)
+		{
+			random_history(grp, p);
+		}
+	}
+
+	grp->paired_gen = grp->generation;
+}
+
+
+/*
+ * every two prisoners play against each other, or with
+ * a tournament group (see init_tournament_group()) every
+ * prisoner plays its k games and its fitness is the mean
+ * score of a game
  */
 void play_game(Group* grp)
 {
 	int A, B;		// indexes of player A and B
 	int num_players = grp->num_chrs;
 
+	PROF_BEGIN(PROF_GAME);
+
 	// reset fitness to 0 before every iteration
 	reset_fitness(grp);
 
-	for (A = 0; A < num_players; A++)
+	if (grp->num_opponents > 0)
 	{
-		for (B = A + 1; B < num_players; B++)
+		// the same pairs for all iterations of a generation
+		if (grp->paired_gen < 0 || (!grp->fixed_schedule && grp->paired_gen != grp->generation))
+			draw_pairs(grp);
+
+		int p;
+		for (p = 0; p < grp->num_rounds; p++)
 		{
-			select_tactics(grp, A, B);
+			A = grp->pairs[2 * p];
+			B = grp->pairs[2 * p + 1];
+			pick_tactics(grp, p, A, B);
 			update_fitness(grp, A, B);
-			update_history(grp, A, B);
+			record_tactics(grp, p, A, B);
+		}
+
+		for (A = 0; A < num_players; A++)
+		{
+			grp->chrs[A]->fitness /= grp->num_opponents;
+		}
+	}
+	else
+	{
+		for (A = 0; A < num_players; A++)
+		{
+			for (B = A + 1; B < num_players; B++)
+			{
+				select_tactics(grp, A, B);
+				update_fitness(grp, A, B);
+				update_history(grp, A, B);
+			}
 		}
 	}
+
+	PROF_COUNT(PROF_EVALS, grp->num_rounds);
+	PROF_END(PROF_GAME);
 }
 
 
 /*
- * select a new tactic for each player
- * based on last two history tactics records
+ * select a new tactic for player A and B from the
+ * history records of game index
  */
-void select_tactics(Group* grp, int A, int B)
+void pick_tactics(Group* grp, int index, int A, int B)
 {
-	int i;
+	uint64_t hist = grp->history[index];
 
-	// get the index of the storage of history tactics
-	// by the indexes of player A and B
-	int index = transform_index(grp->num_chrs, A, B);
+	// what each player remembers is the position of its
+	// tactic in the strategy table/chromosome
+	uint32_t state_A = (uint32_t)hist;
+	uint32_t state_B = (uint32_t)(hist >> HALF_SHIFT);
 
-	for (i = 0; i < 2; i++)
-	{
-		// get the value of history tactics
-		unsigned char hist = grp->history[index][i];
+	const unsigned char* genes_A = grp->chrs[A]->genes;
+	const unsigned char* genes_B = grp->chrs[B]->genes;
 
-		// get position of the tactic to be chosen
-		// in the strategy list/chromosome
-		int gene_pos = hist / CHAR_LENGTH;
-		int bit_pos = hist % CHAR_LENGTH;
+	grp->tactics[A] = (genes_A[state_A / CHAR_LENGTH] >> (CHAR_LENGTH - state_A % CHAR_LENGTH - 1)) & 1;
+	grp->tactics[B] = (genes_B[state_B / CHAR_LENGTH] >> (CHAR_LENGTH - state_B % CHAR_LENGTH - 1)) & 1;
+}
 
-		unsigned char mask = 1 << (CHAR_LENGTH - bit_pos - 1);
 
-		if (0 == i)
-		{
-			// set tactic for player A
-			mask &= grp->chrs[A]->genes[gene_pos];
-			grp->tactics[A] = mask >> (CHAR_LENGTH - bit_pos - 1);
-		}
-		else
-		{
-			// set tactic for player B
-			mask &= grp->chrs[B]->genes[gene_pos];
-			grp->tactics[B] = mask >> (CHAR_LENGTH - bit_pos - 1);
-		}
-	}
+/*
+ * select a new tactic for each player
+ * based on the last history tactics records
+ */
+void select_tactics(Group* grp, int A, int B)
+{
+	// get the index of the storage of history tactics
+	// by the indexes of player A and B
+	pick_tactics(grp, transform_index(grp->num_chrs, A, B), A, B);
 }
 
 
@@ -86,37 +199,35 @@ int transform_index(int num_chrs, int A, int B)
 
 
 /*
- * update history tactics for player A and B
+ * add the current tactics of player A and B to the
+ * history records of game index
  */
-void update_history(Group* grp, int A, int B)
+void record_tactics(Group* grp, int index, int A, int B)
 {
-	unsigned char tac_A = grp->tactics[A];	// current tactic
-	unsigned char tac_B = grp->tactics[B];	// current tactic
-	unsigned char mask;
+	uint64_t tac_A = grp->tactics[A];	// current tactic
+	uint64_t tac_B = grp->tactics[B];	// current tactic
 
-	int i;
+	// the new tactics as seen by each player, its own first
+	uint64_t round_A = (tac_A << 1) + tac_B;
+	uint64_t round_B = (tac_B << 1) + tac_A;
 
-	// get the index of the storage of history tactics
-	// by the indexes of player A and B
-	int index = transform_index(grp->num_chrs, A, B);
-	
-	// copy bits 3&4 to bits 1&2, copy new tactics to bits 3&4
-	for (i = 0; i < 2; i++)
-	{
-		// make new tactics
-		if (0 == i)
-			mask = (tac_A << 1) + tac_B;
-		else
-			mask = (tac_B << 1) + tac_A;
+	// every round moves down by one pair, the oldest one
+	// drops out, and the new one goes on top of each half
+	int top = 2 * (grp->memory - 1);
 
-		mask <<= 2;
+	grp->history[index] = ((grp->history[index] >> 2) & grp->hist_keep) |
+		(round_A << top) | (round_B << (HALF_SHIFT + top));
+}
 
-		// the last tactics become the second last tactics
-		grp->history[index][i] >>= 2;
 
-		// add new tactics to the position of last tactics
-		grp->history[index][i] += mask;
-	}
+/*
+ * update history tactics for player A and B
+ */
+void update_history(Group* grp, int A, int B)
+{
+	// get the index of the storage of history tactics
+	// by the indexes of player A and B
+	record_tactics(grp, transform_index(grp->num_chrs, A, B), A, B);
 }
 
 
@@ -135,6 +246,57 @@ void update_fitness(Group* grp, int A, int B)
 }
 
 
+/*
+ * set the payoffs of the game from the four values
+ * R, S, T and P: reward for mutual cooperation, sucker's
+ * payoff, temptation to defect and punishment for mutual
+ * defection; 3, 0, 5 and 1 by default
+ */
+void set_payoffs(Group* grp, const double* payoffs)
+{
+	double reward = payoffs[0];
+	double sucker = payoffs[1];
+	double temptation = payoffs[2];
+	double punish = payoffs[3];
+
+	// indexed by (tactic of A << 1) + tactic of B, where
+	// 1 is to cooperate, both payoffs of A and B
+	grp->rules[0] = punish;
+	grp->rules[1] = punish;
+	grp->rules[2] = temptation;
+	grp->rules[3] = sucker;
+	grp->rules[4] = sucker;
+	grp->rules[5] = temptation;
+	grp->rules[6] = reward;
+	grp->rules[7] = reward;
+}
+
+
+/*
+ * read the payoffs R,S,T,P from text like "3,0,5,1";
+ * returns 0 if there are four values that are not
+ * negative, else -1
+ */
+int parse_payoffs(const char* text, double* payoffs)
+{
+	char extra;
+
+	if (NUM_RULES != sscanf(text, "%lf,%lf,%lf,%lf%c", &payoffs[0], &payoffs[1], &payoffs[2],
+		&payoffs[3], &extra))
+		return -1;
+
+	// a fitness is a share of the roulette wheel
+	int i;
+	for (i = 0; i < NUM_RULES; i++)
+	{
+		if (!(payoffs[i] >= 0.0))
+			return -1;
+	}
+
+	return 0;
+}
+
+
 /*
  * reset fitnesses to 0's before every iteration,
  * only use this function inside this file
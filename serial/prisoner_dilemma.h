@@ -5,6 +5,16 @@
  *
  * This header file declares function prototypes to
  * play the Prisoner Dilemma game.
+ *
+ * A player remembers the last grp->memory rounds of a
+ * game, each round as two bits (its own tactic, then the
+ * opponent's), the newest round on top. The number
+ * they make is the bit of its chromosome that holds its
+ * next tactic, so a strategy is a table of 4^memory
+ * bits. The history word of a game keeps what player A
+ * remembers in its low half and what player B remembers
+ * in its high half, and the payoffs are looked up in
+ * grp->rules, so a round has no branches at any depth.
  *=====================================================*/
 
 
@@ -20,19 +30,35 @@
 #define CHAR_MAX 255		// max value of unsigned char
 #define CHAR_LENGTH 8		// # of bits of unsigned char
 #define NUM_RULES 4			// # of game rules
-#define NUM_COMBI 16		// # of tactic combinations
 
 
 /*========== Function Prototype ==========*/
 /*
- * every two prisoners play against each other
+ * every two prisoners play against each other, or with
+ * a tournament group (see init_tournament_group()) every
+ * prisoner plays its k games and its fitness is the mean
+ * score of a game
  */
 void play_game(Group* grp);
 
 
+/*
+ * select a new tactic for player A and B from the
+ * history records of game index
+ */
+void pick_tactics(Group* grp, int index, int A, int B);
+
+
+/*
+ * add the current tactics of player A and B to the
+ * history records of game index
+ */
+void record_tactics(Group* grp, int index, int A, int B);
+
+
 /*
  * select a new tactic for each player
- * based on last two history tactics records
+ * based on the last history tactics records
  */
 void select_tactics(Group* grp, int A, int B);
 
@@ -59,6 +85,23 @@ int transform_index(int num_chrs, int A, int B);
 void update_fitness(Group* grp, int A, int B);
 
 
+/*
+ * set the payoffs of the game from the four values
+ * R, S, T and P: reward for mutual cooperation, sucker's
+ * payoff, temptation to defect and punishment for mutual
+ * defection; 3, 0, 5 and 1 by default
+ */
+void set_payoffs(Group* grp, const double* payoffs);
+
+
+/*
+ * read the payoffs R,S,T,P from text like "3,0,5,1";
+ * returns 0 if there are four values that are not
+ * negative, else -1
+ */
+int parse_payoffs(const char* text, double* payoffs);
+
+
 /*
  * reset fitnesses to 0's before every iteration,
  * only use this function inside this file
@@ -0,0 +1,178 @@
+/*=====================================================
+ * reduce.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the reduce.h header file.
+ *=====================================================*/
+
+
+#include <math.h>
+#include <string.h>
+#include "reduce.h"
+
+
+#define LIMB_BITS 32
+#define LIMB_MASK 0xffffffffULL
+#define MIN_EXP 1074				// the lowest bit is worth 2^-1074
+
+
+/*========== Function Definition ==========*/
+/*
+ * set the sum to 0
+ */
+void exact_zero(ExactSum* acc)
+{
+	memset(acc->limbs, 0, sizeof(acc->limbs));
+	acc->num_terms = 0;
+	acc->special = 0.0;
+}
+
+
+/*
+ * carry every limb into the next one, so all but the
+ * last limb are in [0, 2^32)
+ */
+void exact_carry(ExactSum* acc)
+{
+	int i;
+
+	for (i = 0; i < EXACT_LIMBS - 1; i++)
+	{
+		// floor division, a negative limb borrows
+		int64_t carry = acc->limbs[i] >> LIMB_BITS;
+
+		acc->limbs[i] -= carry * (1LL << LIMB_BITS);
+		acc->limbs[i + 1] += carry;
+	}
+
+	acc->num_terms = 0;
+}
+
+
+/*
+ * add x to the sum
+ */
+void exact_add(ExactSum* acc, double x)
+{
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+
+	int exponent = (int)((bits >> 52) & 0x7ff);
+	uint64_t mantissa = bits & ((1ULL << 52) - 1);
+
+	if (0x7ff == exponent)
+	{
+		acc->special += x;
+		return;
+	}
+
+	// x = mantissa * 2^(pos - 1074), subnormals have no
+	// hidden bit and the exponent of the lowest normals
+	int pos = 0;
+	if (exponent > 0)
+	{
+		mantissa |= 1ULL << 52;
+		pos = exponent - 1;
+	}
+
+	if (0 == mantissa)
+		return;
+
+	if (acc->num_terms >= EXACT_CARRY_EVERY)
+		exact_carry(acc);
+	acc->num_terms++;
+
+	// the 53 bits shifted into their limb span 3 limbs,
+	// each part added is below 2^32
+	int limb = pos / LIMB_BITS;
+	int shift = pos % LIMB_BITS;
+	uint64_t low = (mantissa & LIMB_MASK) << shift;
+	uint64_t high = ((mantissa >> LIMB_BITS) << shift) + (low >> LIMB_BITS);
+	int64_t part0 = (int64_t)(low & LIMB_MASK);
+	int64_t part1 = (int64_t)(high & LIMB_MASK);
+	int64_t part2 = (int64_t)(high >> LIMB_BITS);
+
+	if (bits >> 63)
+	{
+		acc->limbs[limb] -= part0;
+		acc->limbs[limb + 1] -= part1;
+		acc->limbs[limb + 2] -= part2;
+	}
+	else
+	{
+		acc->limbs[limb] += part0;
+		acc->limbs[limb + 1] += part1;
+		acc->limbs[limb + 2] += part2;
+	}
+}
+
+
+/*
+ * the sum rounded to the nearest double
+ */
+double exact_value(const ExactSum* acc)
+{
+	if (0.0 != acc->special)
+		return acc->special;
+
+	ExactSum sum = *acc;
+	double sign = 1.0;
+	int i;
+
+	exact_carry(&sum);
+
+	// only the last limb holds the sign, take the
+	// magnitude of a negative sum
+	if (sum.limbs[EXACT_LIMBS - 1] < 0)
+	{
+		sign = -1.0;
+		for (i = 0; i < EXACT_LIMBS; i++)
+		{
+			sum.limbs[i] = -sum.limbs[i];
+		}
+		exact_carry(&sum);
+	}
+
+	int top = EXACT_LIMBS - 1;
+	while (top >= 0 && 0 == sum.limbs[top])
+		top--;
+
+	if (top < 0)
+		return 0.0;
+
+	// the 64 bits from the highest 1 down, then a sticky
+	// bit for anything below them, so the conversion to
+	// double rounds once and to nearest
+	uint64_t high = (uint64_t)sum.limbs[top];
+	uint64_t mid = top >= 1 ? (uint64_t)sum.limbs[top - 1] : 0;
+	uint64_t low = top >= 2 ? (uint64_t)sum.limbs[top - 2] : 0;
+	int zeros = 0;
+	while (0 == (high & (1ULL << (LIMB_BITS - 1 - zeros))))
+		zeros++;
+
+	uint64_t bits = (high << (LIMB_BITS + zeros)) | (mid << zeros);
+	int sticky = 0;
+	if (zeros > 0)
+	{
+		bits |= low >> (LIMB_BITS - zeros);
+		sticky = 0 != (low & ((1ULL << (LIMB_BITS - zeros)) - 1));
+	}
+	else
+	{
+		sticky = 0 != low;
+	}
+	for (i = top - 3; i >= 0 && !sticky; i--)
+	{
+		sticky = 0 != sum.limbs[i];
+	}
+
+	if (sticky)
+		bits |= 1;
+
+	// bit 63 of bits is bit (32 top + 31 - zeros) of the sum
+	int exponent = LIMB_BITS * top + LIMB_BITS - 1 - zeros - 63 - MIN_EXP;
+
+	return sign * ldexp((double)bits, exponent);
+}
@@ -0,0 +1,91 @@
+/*=====================================================
+ * stats.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file defines a per-generation statistics
+ * record and a sink that streams the records to a file.
+ *
+ * The records are filled in by update_fit_rate() in the
+ * same pass that sums up the fitness of the group. The
+ * evolution loop pushes each record into a lock-free
+ * single-producer/single-consumer ring buffer, and a
+ * background thread drains the ring to a CSV file or
+ * to a compact binary file. The loop never waits for
+ * the writer: if the ring is full the record is dropped
+ * and counted.
+ *=====================================================*/
+
+
+#ifndef STATS_H_
+#define STATS_H_
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+
+#define STATS_CSV 0					// write records as CSV rows
+#define STATS_BINARY 1			// write records as raw structs
+#define STATS_MAGIC "PGASTAT"	// first 8 bytes of a binary file
+#define STATS_VERSION 1			// version of the binary format
+#define STATS_RING_SIZE 1024	// # of slots, must be a power of 2
+
+
+/*============ Type Definition ============*/
+/*
+ * statistics of one generation
+ */
+typedef struct
+{
+	int32_t generation;		// generation the record belongs to
+	int32_t num_chrs;			// # of chromosomes
+	double best;					// highest fitness
+	double mean;					// mean fitness
+	double variance;			// variance of fitness
+	double diversity;			// mean per-bit diversity in [0, 1],
+												// 0 when all chromosomes are equal
+}GenStats;
+
+
+/*
+ * lock-free ring buffer of records and its writer
+ */
+typedef struct
+{
+	GenStats ring[STATS_RING_SIZE];	// slots of the ring
+	_Atomic uint64_t head;		// # of records pushed
+	_Atomic uint64_t tail;		// # of records written
+	_Atomic int stop;					// set to ask the writer to exit
+	long num_dropped;					// # of records dropped when full
+	int format;								// STATS_CSV or STATS_BINARY
+	FILE* out;								// output file
+	pthread_t thread;					// writer thread
+}StatsSink;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * open the output file and start the background writer,
+ * return NULL if the file cannot be opened
+ */
+StatsSink* init_stats_sink(const char* path, int format);
+
+
+/*
+ * push a record into the ring without blocking,
+ * return 0 if pushed and 1 if dropped
+ */
+int push_stats(StatsSink* sink, const GenStats* rec);
+
+
+/*
+ * drain the ring, stop the writer, close the output
+ * file and free memories
+ */
+void free_stats_sink(StatsSink* sink);
+
+
+#endif
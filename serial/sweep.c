@@ -0,0 +1,478 @@
+/*=====================================================
+ * sweep.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This file runs a parameter sweep of the Prisoner's
+ * Dilemma game in one process: every configuration of
+ * a grid (comma lists of -s -p -i -c -m) or of a list
+ * file (-l) is run -r times, each run with its own
+ * group and random stream.
+ *
+ * The runs are multiplexed on a work-stealing pool of
+ * threads (see tasks.h): a task evolves one run by -b
+ * generations and then pushes the next step of that
+ * run, so small groups keep every thread busy. One CSV
+ * row per run is streamed to a single file as runs
+ * finish, so the rows are in finishing order; the run
+ * column gives the order of the grid.
+ *=====================================================*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "group.h"
+#include "prisoner_dilemma.h"
+#include "stop.h"
+#include "tasks.h"
+
+
+#define MAX_VALUES 64		// max # of values in a comma list
+
+
+/*============ Type Definition ============*/
+/*
+ * one run of the sweep
+ */
+typedef struct
+{
+	int id;									// index in the grid
+	int num_genes;					// # of gene segments
+	int num_players;				// # of chromosomes/prisoners
+	int num_iters;					// # of game iterations
+	double cross_rate;			// crossover rate
+	double mutate_rate;			// mutation rate
+	uint64_t seed;					// seed of the group
+	Group* grp;							// group, only while the run is active
+	StopRule rule;					// when to end the run early
+	double start;						// clock when the run started
+}SweepRun;
+
+
+/*
+ * settings shared by all runs
+ */
+typedef struct
+{
+	int num_gen;						// # of generations of every run
+	int step;								// # of generations per task
+	int num_opponents;			// games per player, 0 = every pair
+	int fixed_schedule;			// the same opponents every generation
+	int memory;							// # of rounds a player remembers
+	int grid_width;					// width of the torus, 0 = no grid
+	int select_mode;				// how parents are selected
+	double select_param;		// pressure or share of the selection
+	int set_payoffs;				// the payoffs were given
+	double payoffs[NUM_RULES];	// payoffs R,S,T,P of the game
+	StopRule rule;					// stopping rules of every run
+	FILE* out;							// file of CSV rows
+	pthread_mutex_t lock;		// guards out
+	SweepRun* runs;					// all runs
+}Sweep;
+
+
+/*========== Global Variable ==========*/
+static Sweep sweep;				// the sweep, read by the tasks
+
+
+/*========== Function Prototype ==========*/
+/*
+ * print usage and help info
+ */
+void print_usage(void);
+
+
+/*
+ * parse a comma list into values, return the # of
+ * values or 0 on a bad list
+ */
+int parse_list(const char* text, double* values);
+
+
+/*
+ * read configurations "s p i c m" from a file, one per
+ * line, return the # of them or -1 if it cannot be read
+ */
+int read_list(const char* path, double (**configs)[5]);
+
+
+/*
+ * task evolving one run by a step
+ */
+void step_run(TaskPool* pool, int worker, void* arg);
+
+
+/*============== main() =================*/
+int main(int argc, char* argv[])
+{
+	double genes_list[MAX_VALUES] = {2};	// values of -s
+	double players_list[MAX_VALUES] = {8};	// values of -p
+	double iters_list[MAX_VALUES] = {50};		// values of -i
+	double cross_list[MAX_VALUES] = {0.95};	// values of -c
+	double mutate_list[MAX_VALUES] = {0.001};	// values of -m
+	int num_values[5] = {1, 1, 1, 1, 1};	// # of values of each list
+	char* list_path = NULL;			// file of configurations
+	int reps = 1;								// # of runs of each configuration
+	int threads = 1;						// # of threads of the pool
+	uint64_t seed = (uint64_t)time(NULL);	// seed of the first run
+	char* out_path = NULL;			// file of CSV rows
+
+	sweep.num_gen = 100;
+	sweep.step = 1;
+	sweep.num_opponents = 0;
+	sweep.fixed_schedule = 0;
+	sweep.memory = DEFAULT_MEMORY;
+	sweep.grid_width = 0;
+	sweep.select_mode = SELECT_ROULETTE;
+	sweep.select_param = 0.0;
+	sweep.set_payoffs = 0;
+	init_stop_rule(&sweep.rule);
+
+	int i, ok = 1;
+	for (i = 1; i + 1 < argc && ok; i+=2)
+	{
+		if (0 == strcmp("-s",argv[i]))
+			ok = 0 != (num_values[0] = parse_list(argv[i+1], genes_list));
+		else if (0 == strcmp("-p",argv[i]))
+			ok = 0 != (num_values[1] = parse_list(argv[i+1], players_list));
+		else if (0 == strcmp("-i",argv[i]))
+			ok = 0 != (num_values[2] = parse_list(argv[i+1], iters_list));
+		else if (0 == strcmp("-c",argv[i]))
+			ok = 0 != (num_values[3] = parse_list(argv[i+1], cross_list));
+		else if (0 == strcmp("-m",argv[i]))
+			ok = 0 != (num_values[4] = parse_list(argv[i+1], mutate_list));
+		else if (0 == strcmp("-l",argv[i]))
+			list_path = argv[i+1];
+		else if (0 == strcmp("-g",argv[i]))
+			sweep.num_gen = atoi(argv[i+1]);
+		else if (0 == strcmp("-r",argv[i]))
+			reps = atoi(argv[i+1]);
+		else if (0 == strcmp("-t",argv[i]))
+			threads = atoi(argv[i+1]);
+		else if (0 == strcmp("-b",argv[i]))
+			sweep.step = atoi(argv[i+1]);
+		else if (0 == strcmp("-S",argv[i]))
+			seed = strtoull(argv[i+1], NULL, 10);
+		else if (0 == strcmp("-o",argv[i]))
+			out_path = argv[i+1];
+		else if (0 == strcmp("-K",argv[i]))
+			sweep.num_opponents = atoi(argv[i+1]);
+		else if (0 == strcmp("-F",argv[i]))
+			sweep.fixed_schedule = atoi(argv[i+1]);
+		else if (0 == strcmp("-L",argv[i]))
+			ok = 0 == parse_selection(argv[i+1], &sweep.select_mode, &sweep.select_param);
+		else if (0 == strcmp("-C",argv[i]))
+			sweep.grid_width = atoi(argv[i+1]);
+		else if (0 == strcmp("-M",argv[i]))
+			sweep.memory = atoi(argv[i+1]);
+		else if (0 == strcmp("-R",argv[i]))
+			ok = sweep.set_payoffs = 0 == parse_payoffs(argv[i+1], sweep.payoffs);
+		else if (0 == strcmp("-T",argv[i]))
+		{
+			sweep.rule.use_target = 1;
+			sweep.rule.target = atof(argv[i+1]);
+		}
+		else if (0 == strcmp("-W",argv[i]))
+			sweep.rule.stall = atoi(argv[i+1]);
+		else if (0 == strcmp("-D",argv[i]))
+			sweep.rule.floor = atof(argv[i+1]);
+		else
+			ok = 0;
+	}
+
+	if (!ok || i < argc || sweep.num_gen <= 0 || reps <= 0 || threads <= 0 || sweep.step <= 0 ||
+		sweep.rule.stall < 0 || sweep.rule.floor < 0.0 || sweep.num_opponents < 0 ||
+		sweep.memory < 1 || sweep.memory > MAX_MEMORY || sweep.grid_width < 0 ||
+		(sweep.grid_width > 0 && (sweep.num_opponents > 0 || 0 != sweep.grid_width % 2 ||
+		SELECT_ROULETTE != sweep.select_mode ||
+		sweep.grid_width < 4)))
+	{
+		print_usage();  // print usage and help info
+		exit (1);
+	}
+
+	// the configurations, from the list file or the grid
+	double (*configs)[5] = NULL;
+	int num_configs;
+	if (NULL != list_path)
+	{
+		num_configs = read_list(list_path, &configs);
+		if (num_configs <= 0)
+		{
+			fprintf(stderr, "cannot read configurations from %s\n", list_path);
+			exit (3);
+		}
+	}
+	else
+	{
+		num_configs = num_values[0] * num_values[1] * num_values[2] * num_values[3] *
+			num_values[4];
+		configs = (double(*)[5])malloc(num_configs * sizeof(*configs));
+
+		// the last list varies fastest
+		int k;
+		for (k = 0; k < num_configs; k++)
+		{
+			int rest = k;
+			configs[k][4] = mutate_list[rest % num_values[4]];
+			rest /= num_values[4];
+			configs[k][3] = cross_list[rest % num_values[3]];
+			rest /= num_values[3];
+			configs[k][2] = iters_list[rest % num_values[2]];
+			rest /= num_values[2];
+			configs[k][1] = players_list[rest % num_values[1]];
+			rest /= num_values[1];
+			configs[k][0] = genes_list[rest];
+		}
+	}
+
+	int num_runs = num_configs * reps;
+	sweep.runs = (SweepRun*)malloc(num_runs * sizeof(SweepRun));
+	for (i = 0; i < num_runs; i++)
+	{
+		SweepRun* run = &sweep.runs[i];
+		double* config = configs[i / reps];
+
+		run->id = i;
+		run->num_genes = (int)config[0];
+		run->num_players = (int)config[1];
+		run->num_iters = (int)config[2];
+		run->cross_rate = config[3];
+		run->mutate_rate = config[4];
+		run->seed = seed + i;
+		run->grp = NULL;
+		run->rule = sweep.rule;
+
+		if (run->num_genes <= 0 || run->num_players < 2 || 0 != run->num_players % 2 ||
+			run->num_iters <= 0 || run->cross_rate < 0.0 || run->mutate_rate < 0.0 ||
+			(sweep.fixed_schedule && sweep.num_opponents >= run->num_players) ||
+			(long)run->num_genes * CHAR_LENGTH < 1L << (2 * sweep.memory) ||
+			(sweep.grid_width > 0 && (0 != run->num_players % sweep.grid_width ||
+			run->num_players / sweep.grid_width < 3)))
+		{
+			fprintf(stderr, "bad configuration %d: -s %d -p %d -i %d -c %g -m %g\n", i / reps,
+				run->num_genes, run->num_players, run->num_iters, run->cross_rate,
+				run->mutate_rate);
+			exit (2);
+		}
+	}
+	free(configs);
+
+	sweep.out = stdout;
+	if (NULL != out_path)
+	{
+		sweep.out = fopen(out_path, "w");
+		if (NULL == sweep.out)
+		{
+			perror(out_path);
+			exit (3);
+		}
+	}
+	pthread_mutex_init(&sweep.lock, NULL);
+
+	fprintf(sweep.out, "run,num_genes,num_players,num_iters,cross_rate,mutate_rate,seed,"
+		"generation,best,mean,variance,diversity,stop,seconds\n");
+
+	// deal the runs out round robin, each thread then
+	// steps its newest run until it is done
+	TaskPool* pool = init_task_pool(threads);
+	for (i = num_runs - 1; i >= 0; i--)
+	{
+		push_task(pool, i % threads, step_run, &sweep.runs[i]);
+	}
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	run_tasks(pool);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	fprintf(stderr, "%d runs on %d threads in %.3f s, %ld steps stolen\n", num_runs, threads,
+		wall, (long)atomic_load(&pool->steals));
+
+	free_task_pool(pool);
+	pthread_mutex_destroy(&sweep.lock);
+	if (stdout != sweep.out)
+		fclose(sweep.out);
+	free(sweep.runs);
+
+	return 0;
+}
+
+
+/*========== Function Definition ==========*/
+/*
+ * print usage and help info
+ */
+void print_usage(void)
+{
+	printf("=== Usage: ./sweep -p 8,16,32 -c 0.6,0.95 -m 0.001,0.01 -r 4 -t 8 -o sweep.csv\n");
+	printf("    -s  # of gene segments, a comma list, default 2\n");
+	printf("    -p  # of players, a comma list, default 8\n");
+	printf("    -i  # of iterations, a comma list, default 50\n");
+	printf("    -c  crossover rate, a comma list, default 0.95\n");
+	printf("    -m  mutation rate, a comma list, default 0.001\n");
+	printf("    -l  file of configurations \"s p i c m\", one per line,\n");
+	printf("        instead of the grid of the lists above\n");
+	printf("    -g  # of generations of every run, default 100\n");
+	printf("    -r  # of runs of each configuration, default 1\n");
+	printf("    -t  # of threads, default 1\n");
+	printf("    -b  # of generations per task, default 1\n");
+	printf("    -S  seed of the first run, run k uses seed + k, default the time\n");
+	printf("    -o  file of CSV rows, one per run, default stdout\n");
+	printf("    -K  # of games of a player per generation against sampled\n");
+	printf("        opponents, default 0 (every pair plays)\n");
+	printf("    -F  1 to meet the same -K opponents every generation\n");
+	printf("    -L  selection: roulette, rank[:s] of pressure s, default\n");
+	printf("        1.5, or truncation[:f] of share f, default 0.5\n");
+	printf("    -C  width of a torus grid of the players, who only play\n");
+	printf("        and breed with their 4 neighbours, default 0 (off)\n");
+	printf("    -M  # of rounds a player remembers, default %d; every\n", DEFAULT_MEMORY);
+	printf("        -s must hold 4^M bits, e.g. -M 3 -s 8\n");
+	printf("    -R  payoffs R,S,T,P of the game, default 3,0,5,1\n");
+	printf("    -T  target fitness, a run stops once its best reaches it\n");
+	printf("    -W  stall window, a run stops after that many generations\n");
+	printf("        without a better best fitness, default 0 (off)\n");
+	printf("    -D  diversity floor, a run stops below it, default 0 (off)\n");
+}
+
+
+/*
+ * parse a comma list into values, return the # of
+ * values or 0 on a bad list
+ */
+int parse_list(const char* text, double* values)
+{
+	int n = 0;
+	char* end;
+
+	while (n < MAX_VALUES)
+	{
+		values[n++] = strtod(text, &end);
+		if (end == text)
+			return 0;
+		if ('\0' == *end)
+			return n;
+		if (',' != *end)
+			return 0;
+		text = end + 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * read configurations "s p i c m" from a file, one per
+ * line, return the # of them or -1 if it cannot be read
+ */
+int read_list(const char* path, double (**configs)[5])
+{
+	FILE* in = fopen(path, "r");
+	if (NULL == in)
+		return -1;
+
+	int n = 0, cap = 16;
+	double c[5];
+	*configs = (double(*)[5])malloc(cap * sizeof(**configs));
+
+	while (5 == fscanf(in, "%lf %lf %lf %lf %lf", &c[0], &c[1], &c[2], &c[3], &c[4]))
+	{
+		if (n == cap)
+		{
+			cap *= 2;
+			*configs = (double(*)[5])realloc(*configs, cap * sizeof(**configs));
+		}
+
+		memcpy((*configs)[n++], c, sizeof(c));
+	}
+
+	fclose(in);
+	return n;
+}
+
+
+/*
+ * read the monotonic clock in seconds,
+ * only use this function inside this file
+ */
+static double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*
+ * write the row of a finished run and free its group,
+ * only use this function inside this file
+ */
+static void finish_run(SweepRun* run, int reason)
+{
+	Group* grp = run->grp;
+
+	pthread_mutex_lock(&sweep.lock);
+	fprintf(sweep.out, "%d,%d,%d,%d,%g,%g,%llu,%d,%g,%g,%g,%g,%d,%.6f\n", run->id,
+		run->num_genes, run->num_players, run->num_iters, run->cross_rate, run->mutate_rate,
+		(unsigned long long)run->seed, grp->generation, grp->stats.best, grp->stats.mean,
+		grp->stats.variance, grp->stats.diversity, reason, now_sec() - run->start);
+	pthread_mutex_unlock(&sweep.lock);
+
+	free_group(grp);
+	run->grp = NULL;
+}
+
+
+/*
+ * task evolving one run by a step
+ */
+void step_run(TaskPool* pool, int worker, void* arg)
+{
+	SweepRun* run = (SweepRun*)arg;
+	int i, j;
+
+	// the group only exists while the run is active
+	if (NULL == run->grp)
+	{
+		if (sweep.grid_width > 0)
+			run->grp = init_cellular_group(run->num_genes, run->num_players, run->cross_rate,
+				run->mutate_rate, sweep.grid_width, sweep.memory, run->seed);
+		else
+			run->grp = init_tournament_group(run->num_genes, run->num_players, run->cross_rate,
+				run->mutate_rate, sweep.num_opponents, sweep.fixed_schedule, sweep.memory, run->seed);
+		if (sweep.set_payoffs)
+			set_payoffs(run->grp, sweep.payoffs);
+		if (SELECT_ROULETTE != sweep.select_mode)
+			set_selection(run->grp, sweep.select_mode, sweep.select_param);
+		run->grp->diversity_on = 1;
+		run->start = now_sec();
+	}
+
+	Group* grp = run->grp;
+	for (i = 0; i < sweep.step; i++)
+	{
+		// same loop as main.c
+		for (j = 0; j < run->num_iters; j++)
+		{
+			play_game(grp);
+		}
+
+		update_fit_rate(grp);
+
+		int reason = check_stop(&run->rule, &grp->stats);
+		if (STOP_NONE != reason || grp->generation + 1 == sweep.num_gen)
+		{
+			finish_run(run, reason);
+			return;
+		}
+
+		evolve(grp);
+	}
+
+	push_task(pool, worker, step_run, run);
+}
@@ -0,0 +1,217 @@
+/*=====================================================
+ * tasks.c
+ *
+ * @Author: Wenchong Chen
+ *
+ * This definition file defines functions as declared
+ * in the tasks.h header file.
+ *=====================================================*/
+
+
+#include <stdlib.h>
+#include <sched.h>
+#include "tasks.h"
+
+
+/*============ Type Definition ============*/
+/*
+ * argument of a thread, only use this type inside this
+ * file
+ */
+typedef struct
+{
+	TaskPool* pool;					// pool of the thread
+	int worker;							// index of the thread
+}TaskWorker;
+
+
+/*========== Function Definition ==========*/
+/*
+ * take the newest task of the own deque, return 0 if it
+ * is empty, only use this function inside this file
+ */
+static int pop_task(TaskDeque* deque, Task* task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->bottom > deque->top)
+	{
+		deque->bottom--;
+		*task = deque->ring[deque->bottom & (deque->cap - 1)];
+		found = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+
+/*
+ * take the oldest task of another deque, return 0 if
+ * it is empty, only use this function inside this file
+ */
+static int steal_task(TaskDeque* deque, Task* task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->bottom > deque->top)
+	{
+		*task = deque->ring[deque->top & (deque->cap - 1)];
+		deque->top++;
+		found = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+
+/*
+ * run tasks until every pushed task has finished, only
+ * use this function inside this file
+ */
+static void* worker_main(void* arg)
+{
+	TaskWorker* self = (TaskWorker*)arg;
+	TaskPool* pool = self->pool;
+	int worker = self->worker;
+	unsigned int victim = (unsigned int)worker;
+	Task task;
+
+	while (atomic_load(&pool->pending) > 0)
+	{
+		int found = pop_task(&pool->deques[worker], &task);
+
+		// visit the other deques once, from a moving start
+		int i;
+		for (i = 1; !found && i < pool->num_threads; i++)
+		{
+			victim = (victim + 1) % pool->num_threads;
+			if (victim != (unsigned int)worker)
+				found = steal_task(&pool->deques[victim], &task);
+			if (found)
+				atomic_fetch_add(&pool->steals, 1);
+		}
+
+		if (!found)
+		{
+			// the last tasks are running elsewhere
+			sched_yield();
+			continue;
+		}
+
+		task.func(pool, worker, task.arg);
+		atomic_fetch_sub(&pool->pending, 1);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * make a pool of num_threads threads, the caller
+ * included; the threads only exist inside run_tasks()
+ */
+TaskPool* init_task_pool(int num_threads)
+{
+	TaskPool* pool = (TaskPool*)malloc(sizeof(TaskPool));
+
+	pool->num_threads = num_threads;
+	pool->deques = (TaskDeque*)malloc(num_threads * sizeof(TaskDeque));
+	atomic_init(&pool->pending, 0);
+	atomic_init(&pool->steals, 0);
+
+	int i;
+	for (i = 0; i < num_threads; i++)
+	{
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+		pool->deques[i].cap = 64;
+		pool->deques[i].ring = (Task*)malloc(pool->deques[i].cap * sizeof(Task));
+		pool->deques[i].top = 0;
+		pool->deques[i].bottom = 0;
+	}
+
+	return pool;
+}
+
+
+/*
+ * push a task onto the deque of thread worker
+ */
+void push_task(TaskPool* pool, int worker, TaskFunc func, void* arg)
+{
+	TaskDeque* deque = &pool->deques[worker];
+
+	// count it before anyone can take it
+	atomic_fetch_add(&pool->pending, 1);
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->bottom - deque->top == deque->cap)
+	{
+		// double the ring, keeping the tasks in order
+		Task* ring = (Task*)malloc(2 * deque->cap * sizeof(Task));
+		long i;
+		for (i = deque->top; i < deque->bottom; i++)
+		{
+			ring[i & (2 * deque->cap - 1)] = deque->ring[i & (deque->cap - 1)];
+		}
+
+		free(deque->ring);
+		deque->ring = ring;
+		deque->cap *= 2;
+	}
+
+	deque->ring[deque->bottom & (deque->cap - 1)].func = func;
+	deque->ring[deque->bottom & (deque->cap - 1)].arg = arg;
+	deque->bottom++;
+	pthread_mutex_unlock(&deque->lock);
+}
+
+
+/*
+ * run the pushed tasks, and the tasks they push, on all
+ * threads and return when none is left
+ */
+void run_tasks(TaskPool* pool)
+{
+	pthread_t* threads = (pthread_t*)malloc(pool->num_threads * sizeof(pthread_t));
+	TaskWorker* workers = (TaskWorker*)malloc(pool->num_threads * sizeof(TaskWorker));
+
+	int i;
+	for (i = 0; i < pool->num_threads; i++)
+	{
+		workers[i].pool = pool;
+		workers[i].worker = i;
+		if (i > 0)
+			pthread_create(&threads[i], NULL, worker_main, &workers[i]);
+	}
+
+	worker_main(&workers[0]);
+
+	for (i = 1; i < pool->num_threads; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	free(threads);
+	free(workers);
+}
+
+
+/*
+ * free memories of the pool
+ */
+void free_task_pool(TaskPool* pool)
+{
+	int i;
+	for (i = 0; i < pool->num_threads; i++)
+	{
+		pthread_mutex_destroy(&pool->deques[i].lock);
+		free(pool->deques[i].ring);
+	}
+
+	free(pool->deques);
+	free(pool);
+}
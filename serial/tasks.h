@@ -0,0 +1,99 @@
+/*=====================================================
+ * tasks.h
+ *
+ * @Author: Wenchong Chen
+ *
+ * This header file declares a work-stealing pool of
+ * threads that runs small tasks, e.g. one generation
+ * step of one of many independent groups.
+ *
+ * Every thread has its own deque of tasks. A thread
+ * takes its newest task first (the group it just
+ * stepped is still in its cache); a thread whose deque
+ * is empty steals the oldest task of another thread.
+ * A task may push follow-up tasks, and run_tasks()
+ * returns once every pushed task has run.
+ *=====================================================*/
+
+
+#ifndef TASKS_H_
+#define TASKS_H_
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+
+/*============ Type Definition ============*/
+struct TaskPool;
+
+
+/*
+ * body of a task, run by thread worker of the pool
+ */
+typedef void (*TaskFunc)(struct TaskPool* pool, int worker, void* arg);
+
+
+/*
+ * a task and its argument
+ */
+typedef struct
+{
+	TaskFunc func;					// body of the task
+	void* arg;							// argument of the task
+}Task;
+
+
+/*
+ * deque of tasks of one thread, a ring of cap slots
+ */
+typedef struct
+{
+	pthread_mutex_t lock;		// guards the fields below it
+	Task* ring;							// slots of the ring
+	int cap;								// # of slots, a power of 2
+	long top;								// index of the oldest task
+	long bottom;						// index past the newest task
+}TaskDeque;
+
+
+/*
+ * state of the pool
+ */
+typedef struct TaskPool
+{
+	int num_threads;				// # of threads, the caller included
+	TaskDeque* deques;			// deque of each thread
+	atomic_long pending;		// # of tasks pushed but not finished
+	atomic_long steals;			// # of tasks stolen
+}TaskPool;
+
+
+/*========== Function Prototype ==========*/
+/*
+ * make a pool of num_threads threads, the caller
+ * included; the threads only exist inside run_tasks()
+ */
+TaskPool* init_task_pool(int num_threads);
+
+
+/*
+ * push a task onto the deque of thread worker
+ */
+void push_task(TaskPool* pool, int worker, TaskFunc func, void* arg);
+
+
+/*
+ * run the pushed tasks, and the tasks they push, on all
+ * threads and return when none is left
+ */
+void run_tasks(TaskPool* pool);
+
+
+/*
+ * free memories of the pool
+ */
+void free_task_pool(TaskPool* pool);
+
+
+#endif